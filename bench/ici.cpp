@@ -0,0 +1,92 @@
+#include <banshee/banshee.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Builds a configuration from an ICI document depending on an environment, first parsing and
+// evaluating the document every time, then evaluating a plan compiled once, and reports the
+// time per evaluation of each.
+// usage: banshee-bench-ici [services] [iterations]
+
+namespace {
+
+std::string make_document(std::size_t services) {
+    std::string text = "defaults { port = 8000, replicas = 1, tags = ['base'] }\n";
+    for(std::size_t i = 0; i < services; i++) {
+        const std::string n = std::to_string(i);
+        text += "service_" + n + " {\n"
+                "    name = 'service-" + n + "'\n"
+                "    port = defaults.port port += " + n + "\n"
+                "    replicas = defaults.replicas\n"
+                "    if production and not_empty or force {\n"
+                "        replicas *= 3\n"
+                "        tags = defaults.tags tags += ['production']\n"
+                "    } else if staging { tags = ['staging'] } else { debug = true }\n"
+                "    foreach region : regions { endpoints += [region] }\n"
+                "}\n";
+    }
+    return text;
+}
+
+banshee::property make_environment(std::size_t i) {
+    banshee::property::array_t regions;
+    for(std::size_t r = 0; r < 1 + i % 4; r++)
+        regions.push_back("region-" + std::to_string(r));
+    return banshee::property::dict{"production", i % 3 == 0, "staging", i % 3 == 1,
+                                   "not_empty", true, "force", false, "regions",
+                                   std::move(regions)};
+}
+
+std::optional<banshee::ici_document<banshee::property>> parse(const std::string& text) {
+    std::u32string codepoints;
+    if(!banshee::decode_utf8(text.data(), text.data() + text.size(), codepoints))
+        return {};
+    auto tokens = banshee::ici_token_view<std::u32string>(std::move(codepoints));
+    banshee::ici_parser<decltype(tokens)> parser(tokens);
+    return parser.parse();
+}
+
+template<typename F>
+double measure(const char* name, std::size_t iterations, F&& f) {
+    std::size_t failures = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; i++)
+        failures += !f(i);
+    const auto end = std::chrono::steady_clock::now();
+    const double us = std::chrono::duration<double, std::micro>(end - start).count() /
+                      double(iterations);
+    std::cout << name << (failures ? " (failed)" : "") << ": " << us << " us per evaluation\n";
+    return us;
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t services = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+    const std::size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000;
+    const std::string text = make_document(services);
+    std::vector<banshee::property> environments;
+    for(std::size_t i = 0; i < 16; i++)
+        environments.push_back(make_environment(i));
+
+    const double full = measure("parse + evaluate", iterations, [&](std::size_t i) {
+        auto document = parse(text);
+        return document && banshee::evaluate(*document, environments[i % environments.size()]);
+    });
+
+    const auto document = parse(text);
+    if(!document)
+        return 1;
+    const auto plan = banshee::ici_plan<banshee::property>::compile(*document);
+    if(!plan)
+        return 1;
+    std::cout << plan->size() << " instructions\n";
+    banshee::property result;
+    const double planned = measure("plan evaluate", iterations, [&](std::size_t i) {
+        return plan->evaluate(environments[i % environments.size()], result);
+    });
+    std::cout << "re-evaluation costs " << 100 * planned / full << "% of a full parse\n";
+}
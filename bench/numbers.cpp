@@ -0,0 +1,72 @@
+#include <banshee/banshee.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+// Parses a number heavy document (a time series of prices and ids) and writes it back, with
+// property, which converts every number while parsing, and with raw_property, which keeps
+// the source text of the numbers, and reports the throughput of each.
+// usage: banshee-bench-numbers [records]
+
+namespace {
+
+std::string make_document(std::size_t records) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<long> cents(0, 100000000);
+    std::string text = "[";
+    for(std::size_t i = 0; i < records; i++) {
+        if(i)
+            text += ",\n";
+        const long price = cents(rng);
+        text += "{\"id\": " + std::to_string(rng() >> 1) +
+                ", \"ts\": " + std::to_string(1500000000123 + i) +
+                ", \"price\": " + std::to_string(price / 100) + "." +
+                std::to_string(100 + price % 100).substr(1) + ", \"series\": [";
+        for(int j = 0; j < 8; j++)
+            text += (j ? ", " : "") + std::to_string(double(cents(rng)) / 1e6);
+        text += "]}";
+    }
+    return text + "]";
+}
+
+template<typename Property>
+void measure(const char* name, const std::string& text) {
+    std::string output;
+    output.reserve(text.size());
+    const auto start = std::chrono::steady_clock::now();
+
+    std::u32string codepoints;
+    bool ok = banshee::decode_utf8(text.data(), text.data() + text.size(), codepoints);
+    auto tokens = banshee::json_token_view<std::u32string, Property>(std::move(codepoints));
+    auto parser = banshee::json_parser(tokens);
+    const auto value = parser.parse();
+    const auto parsed = std::chrono::steady_clock::now();
+
+    auto sink = [&](const char* data, std::size_t size) {
+        output.append(data, size);
+        return true;
+    };
+    banshee::basic_json_writer<banshee::function_sink<decltype(sink)>> writer{
+        banshee::function_sink(sink)};
+    ok = ok && value && writer.value(*value) && writer.flush();
+    const auto written = std::chrono::steady_clock::now();
+
+    const double megabytes = double(text.size()) / (1024 * 1024);
+    const double parse = std::chrono::duration<double>(parsed - start).count();
+    const double write = std::chrono::duration<double>(written - parsed).count();
+    std::cout << name << (ok ? "" : " (failed)") << ": parse " << megabytes / parse
+              << " MiB/s, write " << megabytes / write << " MiB/s\n";
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const auto text = make_document(records);
+    std::cout << text.size() / (1024 * 1024) << " MiB\n";
+
+    measure<banshee::property>("property", text);
+    measure<banshee::raw_property>("raw_property", text);
+}
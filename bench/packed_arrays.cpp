@@ -0,0 +1,121 @@
+#include <banshee/banshee.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+
+// Parses a document made of embeddings and integer time series with property and with
+// packed_property, and reports for each the memory held by the parsed document and the time
+// taken to sum every number of the document.
+// usage: banshee-bench-packed-arrays [records] [dimensions]
+
+// Live heap bytes, each allocation records its size in front of the block
+namespace {
+std::size_t allocated = 0;
+constexpr std::size_t header = alignof(std::max_align_t);
+}    // namespace
+
+void* operator new(std::size_t size) {
+    auto* p = static_cast<char*>(std::malloc(size + header));
+    if(!p)
+        std::abort();
+    *reinterpret_cast<std::size_t*>(p) = size;
+    allocated += size;
+    return p + header;
+}
+void operator delete(void* p) noexcept {
+    if(!p)
+        return;
+    auto* block = static_cast<char*>(p) - header;
+    allocated -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+namespace {
+
+std::string make_document(std::size_t records, std::size_t dimensions) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> component(-1, 1);
+    std::uniform_int_distribution<long> sample(0, 1 << 20);
+    std::string text = "[";
+    for(std::size_t i = 0; i < records; i++) {
+        text += i ? ",\n{" : "{";
+        text += "\"id\": " + std::to_string(i) + ", \"embedding\": [";
+        for(std::size_t j = 0; j < dimensions; j++)
+            text += (j ? ", " : "") + std::to_string(component(rng));
+        text += "], \"samples\": [";
+        for(std::size_t j = 0; j < dimensions; j++)
+            text += (j ? ", " : "") + std::to_string(sample(rng));
+        text += "]}";
+    }
+    return text + "]";
+}
+
+template<typename Property>
+double sum(const Property& p) {
+    if constexpr(std::is_same_v<Property, banshee::packed_property>) {
+        if(p.is_array()) {
+            const auto& array = std::get<typename Property::array_t>(p.value);
+            double total = 0;
+            for(const auto d : array.doubles())
+                total += d;
+            for(const auto i : array.integers())
+                total += double(i);
+            if(!array.doubles().empty() || !array.integers().empty())
+                return total;
+        }
+    }
+    if(p.is_number())
+        return double(p);
+    double total = 0;
+    if(p.is_array()) {
+        for(const auto& e : std::get<typename Property::array_t>(p.value))
+            total += sum(e);
+    } else if(p.is_object()) {
+        for(const auto& member : std::get<typename Property::object_t>(p.value))
+            total += sum(member.second);
+    }
+    return total;
+}
+
+template<typename Property>
+void measure(const char* name, const std::string& text) {
+    std::u32string codepoints;
+    banshee::decode_utf8(text.data(), text.data() + text.size(), codepoints);
+    auto tokens = banshee::json_token_view<std::u32string, Property>(std::move(codepoints));
+    auto parser = banshee::json_parser(tokens);
+
+    const std::size_t before = allocated;
+    const auto start = std::chrono::steady_clock::now();
+    const auto value = parser.parse();
+    const auto parsed = std::chrono::steady_clock::now();
+    const std::size_t bytes = allocated - before;
+    if(!value) {
+        std::cout << name << ": failed\n";
+        return;
+    }
+    const double total = sum(*value);
+    const auto summed = std::chrono::steady_clock::now();
+
+    std::cout << name << ": " << bytes / (1024 * 1024) << " MiB, parse "
+              << std::chrono::duration<double>(parsed - start).count() << " s, sum "
+              << std::chrono::duration<double, std::milli>(summed - parsed).count() << " ms ("
+              << total << ")\n";
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000;
+    const std::size_t dimensions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 768;
+    const auto text = make_document(records, dimensions);
+    std::cout << text.size() / (1024 * 1024) << " MiB\n";
+
+    measure<banshee::property>("property", text);
+    measure<banshee::packed_property>("packed_property", text);
+}
@@ -0,0 +1,81 @@
+#include <banshee/banshee.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+// Serializes a large document to a file with operator<<, the json writer and the json writer
+// over an async_file_sink, and reports the throughput of each.
+// usage: banshee-bench-serialize [records] [output file]
+
+namespace {
+
+banshee::property make_document(std::size_t records) {
+    banshee::property::array_t rows;
+    rows.reserve(records);
+    for(std::size_t i = 0; i < records; i++) {
+        banshee::property row = banshee::property::dict{
+            "ts", long(1500000000 + i), "val", double(i) * 0.25, "host",
+            "host-" + std::to_string(i % 64), "tags", banshee::property::list{"a", "b", long(i % 3)}};
+        rows.push_back(std::move(row));
+    }
+    return banshee::property(std::move(rows));
+}
+
+template<typename F>
+void measure(const char* name, const std::string& path, F&& f) {
+    const auto start = std::chrono::steady_clock::now();
+    const bool ok = f();
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    const double megabytes = double(file.tellg()) / (1024 * 1024);
+    std::cout << name << (ok ? "" : " (failed)") << ": " << megabytes << " MiB in " << seconds
+              << " s, " << megabytes / seconds << " MiB/s\n";
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t records = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::string path = argc > 2 ? argv[2] : "banshee-bench-serialize.json";
+    const auto document = make_document(records);
+
+    measure("operator<<", path, [&] {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << document;
+        out.flush();
+        return bool(out);
+    });
+
+    measure("json_writer", path, [&] {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        bool ok;
+        {
+            banshee::json_writer writer{banshee::fd_sink(fd)};
+            ok = writer.value(document) && writer.finish();
+        }
+        ::close(fd);
+        return ok;
+    });
+
+    for(std::size_t buffers : {2, 4}) {
+        const std::string name = "json_writer + async_file_sink, " + std::to_string(buffers) +
+                                 " buffers";
+        measure(name.c_str(), path, [&] {
+            const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            bool ok;
+            {
+                banshee::basic_json_writer<banshee::async_file_sink> writer{
+                    banshee::async_file_sink(fd, buffers)};
+                ok = writer.value(document) && writer.finish();
+            }
+            ::close(fd);
+            return ok;
+        });
+    }
+    ::unlink(path.c_str());
+}
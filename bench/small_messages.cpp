@@ -0,0 +1,87 @@
+#include <banshee/banshee.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Parses small json messages, between 200 bytes and 2 KB, one at a time, with a token view
+// and a parser constructed per message and with a long lived parse_context, and reports the
+// latency percentiles of each.
+// usage: banshee-bench-small-messages [messages] [rounds]
+
+namespace {
+
+std::string make_message(std::mt19937& rng) {
+    std::uniform_int_distribution<int> fields(2, 30);
+    std::uniform_int_distribution<long> numbers(-1000000, 1000000);
+    std::string text = "{\"id\": " + std::to_string(numbers(rng)) +
+                       ", \"method\": \"orders.update\", \"params\": {";
+    const int n = fields(rng);
+    for(int i = 0; i < n; i++) {
+        if(i)
+            text += ", ";
+        text += "\"field_" + std::to_string(i) + "\": ";
+        switch(i % 4) {
+            case 0: text += std::to_string(numbers(rng)); break;
+            case 1: text += std::to_string(double(numbers(rng)) / 64); break;
+            case 2: text += "\"value \\\"" + std::to_string(numbers(rng)) + "\\\"\""; break;
+            case 3: text += "[true, null, " + std::to_string(numbers(rng)) + "]"; break;
+        }
+    }
+    return text + "}}";
+}
+
+template<typename F>
+void measure(const char* name, const std::vector<std::string>& messages, std::size_t rounds,
+             F&& f) {
+    std::vector<double> samples;
+    samples.reserve(messages.size() * rounds);
+    std::size_t failures = 0;
+    for(std::size_t round = 0; round < rounds; round++) {
+        for(const auto& message : messages) {
+            const auto start = std::chrono::steady_clock::now();
+            failures += !f(message);
+            const auto end = std::chrono::steady_clock::now();
+            samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+        }
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) { return samples[std::size_t(p * (samples.size() - 1))]; };
+    std::cout << name << (failures ? " (failed)" : "") << ": p50 " << percentile(0.5)
+              << " ns, p99 " << percentile(0.99) << " ns\n";
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    const std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const std::size_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+    std::mt19937 rng(42);
+    std::vector<std::string> messages;
+    std::size_t bytes = 0;
+    while(messages.size() < count) {
+        auto message = make_message(rng);
+        if(message.size() < 200 || message.size() > 2048)
+            continue;
+        bytes += message.size();
+        messages.push_back(std::move(message));
+    }
+    std::cout << messages.size() << " messages, " << bytes / messages.size()
+              << " bytes on average\n";
+
+    measure("json_token_view + json_parser", messages, rounds, [](const std::string& message) {
+        std::u32string codepoints;
+        if(!banshee::decode_utf8(message.data(), message.data() + message.size(), codepoints))
+            return false;
+        auto tokens = banshee::json_token_view<std::u32string>(std::move(codepoints));
+        auto parser = banshee::json_parser(tokens);
+        return parser.parse().has_value();
+    });
+
+    banshee::parse_context context;
+    measure("parse_context", messages, rounds,
+            [&](const std::string& message) { return context.parse(message); });
+}
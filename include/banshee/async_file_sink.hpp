@@ -0,0 +1,309 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#ifdef BANSHEE_USE_IO_URING
+#include <liburing.h>
+#endif
+
+namespace banshee {
+
+// A sink writing to a file descriptor without blocking the thread producing the output.
+// Writers hand over whole buffers (see exchange) and immediately get an empty one back to keep
+// formatting into while the full ones are written. With 2 buffers, this is double buffering;
+// more buffers absorb bursts, and when several are waiting they are written with a single
+// writev.
+// Writes happen on a background thread, or, when built with BANSHEE_USE_IO_URING and fd is
+// seekable, are queued to io_uring at explicit offsets.
+// The sink does not own fd. The destructor waits until everything is written.
+class async_file_sink {
+public:
+    explicit async_file_sink(int fd, std::size_t buffer_count = 2) :
+        m_state(std::make_unique<state>(fd, buffer_count < 2 ? 2 : buffer_count)) {}
+    async_file_sink(async_file_sink&&) noexcept = default;
+    async_file_sink& operator=(async_file_sink&&) noexcept = default;
+
+    // Queues size bytes of buffer for writing and replaces buffer by an empty buffer of the same
+    // capacity. Waits only when all the buffers are queued.
+    // Returns false if a previous write failed.
+    bool exchange(std::unique_ptr<char[]>& buffer, std::size_t size, std::size_t capacity) {
+        return m_state->exchange(buffer, size, capacity);
+    }
+
+    // Writes data synchronously, after the queued buffers
+    bool write(const char* data, std::size_t size) {
+        return m_state->wait() && m_state->write(data, size);
+    }
+
+    // Waits until the queued buffers are written, returns false if a write failed
+    bool wait() {
+        return m_state->wait();
+    }
+
+private:
+    static bool write_all(int fd, const char* data, std::size_t size) noexcept {
+        while(size) {
+            const ssize_t written = ::write(fd, data, size);
+            if(written < 0) {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += written;
+            size -= std::size_t(written);
+        }
+        return true;
+    }
+
+    struct chunk {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+    // Writes the chunks in order with as few writev calls as possible
+    static bool write_chunks(int fd, std::vector<chunk>& chunks) noexcept {
+        std::size_t first = 0, offset = 0;
+        while(first < chunks.size()) {
+            iovec iov[16];
+            int count = 0;
+            for(std::size_t i = first; i < chunks.size() && count < 16; i++, count++) {
+                const std::size_t skip = i == first ? offset : 0;
+                iov[count].iov_base = chunks[i].data.get() + skip;
+                iov[count].iov_len = chunks[i].size - skip;
+            }
+            ssize_t written = ::writev(fd, iov, count);
+            if(written < 0) {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            while(written > 0) {
+                const std::size_t left = chunks[first].size - offset;
+                if(std::size_t(written) < left) {
+                    offset += std::size_t(written);
+                    break;
+                }
+                written -= ssize_t(left);
+                first++;
+                offset = 0;
+            }
+        }
+        return true;
+    }
+
+    struct state {
+        state(int fd, std::size_t buffer_count) : fd(fd), buffer_count(buffer_count) {
+#ifdef BANSHEE_USE_IO_URING
+            const off_t position = ::lseek(fd, 0, SEEK_CUR);
+            if(position >= 0 && io_uring_queue_init(unsigned(buffer_count), &ring, 0) == 0) {
+                uring = true;
+                offset = std::uint64_t(position);
+                return;
+            }
+#endif
+            worker = std::thread([this] { run(); });
+        }
+
+        ~state() {
+            wait();
+#ifdef BANSHEE_USE_IO_URING
+            if(uring) {
+                // Leave the file position after the data, as a synchronous writer would
+                ::lseek(fd, off_t(offset), SEEK_SET);
+                io_uring_queue_exit(&ring);
+                return;
+            }
+#endif
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            work.notify_one();
+            worker.join();
+        }
+
+        bool exchange(std::unique_ptr<char[]>& buffer, std::size_t size, std::size_t capacity) {
+#ifdef BANSHEE_USE_IO_URING
+            if(uring)
+                return uring_exchange(buffer, size, capacity);
+#endif
+            std::unique_lock<std::mutex> lock(mutex);
+            if(failed)
+                return false;
+            queue.push_back(chunk{std::move(buffer), size});
+            work.notify_one();
+            // The writer owns one buffer, the others are queued, being written, or free
+            if(free.empty() && allocated < buffer_count) {
+                allocated++;
+                lock.unlock();
+                buffer.reset(new char[capacity]);
+                return true;
+            }
+            done.wait(lock, [this] { return !free.empty(); });
+            buffer = std::move(free.back());
+            free.pop_back();
+            return !failed;
+        }
+
+        bool write(const char* data, std::size_t size) {
+#ifdef BANSHEE_USE_IO_URING
+            // io_uring writes at explicit offsets and does not move the file position
+            if(uring) {
+                while(size) {
+                    const ssize_t n = ::pwrite(fd, data, size, off_t(offset));
+                    if(n < 0 && errno == EINTR)
+                        continue;
+                    if(n <= 0) {
+                        failed = true;
+                        return false;
+                    }
+                    data += n;
+                    size -= std::size_t(n);
+                    offset += std::uint64_t(n);
+                }
+                return true;
+            }
+#endif
+            const bool ok = write_all(fd, data, size);
+            std::lock_guard<std::mutex> lock(mutex);
+            failed |= !ok;
+            return !failed;
+        }
+
+        bool wait() {
+#ifdef BANSHEE_USE_IO_URING
+            if(uring) {
+                while(!in_flight.empty())
+                    reap();
+                return !failed;
+            }
+#endif
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [this] { return queue.empty() && !writing; });
+            return !failed;
+        }
+
+        void run() {
+            std::vector<chunk> batch;
+            std::unique_lock<std::mutex> lock(mutex);
+            for(;;) {
+                work.wait(lock, [this] { return !queue.empty() || stop; });
+                if(queue.empty())
+                    return;
+                batch.swap(queue);
+                writing = true;
+                lock.unlock();
+                const bool ok = write_chunks(fd, batch);
+                lock.lock();
+                failed |= !ok;
+                for(auto& c : batch)
+                    free.push_back(std::move(c.data));
+                batch.clear();
+                writing = false;
+                done.notify_all();
+            }
+        }
+
+#ifdef BANSHEE_USE_IO_URING
+        struct pending_write {
+            std::unique_ptr<char[]> data;
+            std::size_t size;
+            std::uint64_t offset;
+        };
+
+        bool uring_exchange(std::unique_ptr<char[]>& buffer, std::size_t size,
+                            std::size_t capacity) {
+            if(failed)
+                return false;
+            if(in_flight.size() == buffer_count - 1)
+                reap();
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            if(!sqe) {
+                failed = true;
+                return false;
+            }
+            auto* p = new pending_write{std::move(buffer), size, offset};
+            io_uring_prep_write(sqe, fd, p->data.get(), unsigned(size), p->offset);
+            io_uring_sqe_set_data(sqe, p);
+            in_flight.push_back(p);
+            offset += size;
+            if(io_uring_submit(&ring) < 0)
+                failed = true;
+            if(!free.empty()) {
+                buffer = std::move(free.back());
+                free.pop_back();
+            } else {
+                buffer.reset(new char[capacity]);
+            }
+            return !failed;
+        }
+
+        // Waits for one write to complete. Short writes are completed synchronously.
+        void reap() {
+            io_uring_cqe* cqe;
+            int ret;
+            while((ret = io_uring_wait_cqe(&ring, &cqe)) == -EINTR) {
+            }
+            if(ret < 0) {
+                failed = true;
+                for(pending_write* p : in_flight)
+                    delete p;
+                in_flight.clear();
+                return;
+            }
+            auto* p = static_cast<pending_write*>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            if(res < 0) {
+                failed = true;
+            } else {
+                std::size_t written = std::size_t(res);
+                while(written < p->size) {
+                    const ssize_t n = ::pwrite(fd, p->data.get() + written, p->size - written,
+                                               off_t(p->offset + written));
+                    if(n < 0 && errno == EINTR)
+                        continue;
+                    if(n <= 0) {
+                        failed = true;
+                        break;
+                    }
+                    written += std::size_t(n);
+                }
+            }
+            in_flight.erase(std::find(in_flight.begin(), in_flight.end(), p));
+            free.push_back(std::move(p->data));
+            delete p;
+        }
+
+        io_uring ring;
+        bool uring = false;
+        std::uint64_t offset = 0;
+        std::vector<pending_write*> in_flight;
+#endif
+
+        int fd;
+        std::size_t buffer_count;
+        std::size_t allocated = 1;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable work;
+        std::condition_variable done;
+        std::vector<chunk> queue;
+        std::vector<std::unique_ptr<char[]>> free;
+        bool writing = false;
+        bool stop = false;
+        bool failed = false;
+    };
+
+    std::unique_ptr<state> m_state;
+};
+
+}    // namespace banshee
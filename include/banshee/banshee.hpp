@@ -2,3 +2,17 @@
 #include <banshee/unicode_view.hpp>
 #include <banshee/property.hpp>
 #include <banshee/json/json_parser.hpp>
+#include <banshee/json/json_tape.hpp>
+#include <banshee/json/json_parse_context.hpp>
+#include <banshee/json/json_validator.hpp>
+#include <banshee/json/json_schema.hpp>
+#include <banshee/json/json_columns.hpp>
+#include <banshee/json/json_writer.hpp>
+#include <banshee/ici/ici_loader.hpp>
+#include <banshee/binary/binary_reader.hpp>
+#include <banshee/binary/binary_writer.hpp>
+#include <banshee/document_view.hpp>
+#include <banshee/snapshot.hpp>
+#include <banshee/async_file_sink.hpp>
+#include <banshee/value_pool.hpp>
+#include <banshee/patch.hpp>
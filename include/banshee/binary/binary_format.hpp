@@ -0,0 +1,113 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <boost/endian/conversion.hpp>
+
+// Layout of the binary snapshot format
+//
+// A document is an 8 byte header ("BNSH", a version byte and 3 reserved bytes) followed
+// by the root value. Every value starts with a one byte tag:
+//  - null, false, true: the tag alone
+//  - integral: a zigzag encoded varint
+//  - floating: 8 bytes, little endian ieee 754
+//  - string: a varint length followed by the utf-8 code units
+//  - array: a varint count, count little endian uint32 offsets, then the elements
+//  - object: a varint count, count little endian uint32 offsets, then the members, each
+//    member being a key (encoded like a string, without tag) followed by its value.
+//    Members are sorted by key.
+// Offsets are relative to the tag of the container, so any child can be reached without
+// decoding its siblings.
+
+namespace banshee::detail::binary {
+
+enum class tag : std::uint8_t {
+    null = 0,
+    false_ = 1,
+    true_ = 2,
+    integral = 3,
+    floating = 4,
+    string = 5,
+    array = 6,
+    object = 7,
+};
+
+constexpr std::array<char, 4> magic = {'B', 'N', 'S', 'H'};
+constexpr std::uint8_t version = 1;
+constexpr std::size_t header_size = 8;
+constexpr std::size_t offset_size = sizeof(std::uint32_t);
+// Containers nest at most max_depth deep: writers refuse deeper trees, and readers decode the
+// values of deeper containers as null rather than recursing without bound
+constexpr std::size_t max_depth = 1024;
+
+inline std::uint64_t zigzag_encode(std::int64_t v) noexcept {
+    return (std::uint64_t(v) << 1) ^ std::uint64_t(v >> 63);
+}
+
+inline std::int64_t zigzag_decode(std::uint64_t v) noexcept {
+    return std::int64_t(v >> 1) ^ -std::int64_t(v & 1);
+}
+
+// Writes v as a LEB128 varint, out must have room for 10 bytes.
+inline std::size_t encode_varint(char* out, std::uint64_t v) noexcept {
+    std::size_t n = 0;
+    while(v >= 0x80) {
+        out[n++] = char(std::uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out[n++] = char(v);
+    return n;
+}
+
+inline std::uint64_t decode_varint(const char*& it) noexcept {
+    std::uint64_t v = 0;
+    for(unsigned shift = 0; shift < 64; shift += 7) {
+        const std::uint8_t b = std::uint8_t(*it++);
+        v |= std::uint64_t(b & 0x7F) << shift;
+        if(!(b & 0x80))
+            break;
+    }
+    return v;
+}
+
+// Bounds checked decode_varint, for buffers that may be truncated or corrupt.
+// Returns false if the varint does not end before end.
+inline bool decode_varint(const char*& it, const char* end, std::uint64_t& v) noexcept {
+    v = 0;
+    for(unsigned shift = 0; shift < 64 && it != end; shift += 7) {
+        const std::uint8_t b = std::uint8_t(*it++);
+        v |= std::uint64_t(b & 0x7F) << shift;
+        if(!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+inline std::uint32_t load_offset(const char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return boost::endian::little_to_native(v);
+}
+
+inline void store_offset(char* p, std::uint32_t v) noexcept {
+    v = boost::endian::native_to_little(v);
+    std::memcpy(p, &v, sizeof(v));
+}
+
+inline double load_floating(const char* p) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, p, sizeof(bits));
+    bits = boost::endian::little_to_native(bits);
+    double d;
+    std::memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+inline void store_floating(char* p, double d) noexcept {
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    bits = boost::endian::native_to_little(bits);
+    std::memcpy(p, &bits, sizeof(bits));
+}
+
+}    // namespace banshee::detail::binary
@@ -0,0 +1,286 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <banshee/binary/binary_format.hpp>
+
+namespace banshee {
+
+// A value of a binary snapshot, read in place.
+// binary_value is a pointer into the document: it is trivially copyable, never allocates and
+// only touches the bytes of the values it is asked about. The document must outlive it.
+// Accessing a missing key or index, or a value of the wrong kind, yields a null value.
+// Snapshots are not trusted: every value is checked to fit in the buffer before it is read,
+// and the values of truncated or corrupt snapshots that do not fit read as null.
+// Corrupt snapshots can also point several entries at the same child, or nest containers
+// without bound: to_property decodes at most one value per byte of the snapshot and leaves
+// out the rest, and reads containers deeper than detail::binary::max_depth as null.
+class binary_value {
+    using tag = detail::binary::tag;
+
+public:
+    binary_value() noexcept : m_data(&null_tag), m_end(&null_tag + 1) {}
+    // The value starting at data, in a buffer ending at end
+    binary_value(const char* data, const char* end) noexcept : binary_value() {
+        if(fits(data, end)) {
+            m_data = data;
+            m_end = end;
+        }
+    }
+
+    tag kind() const noexcept {
+        return tag(*m_data);
+    }
+
+    bool is_null() const noexcept {
+        return kind() == tag::null;
+    }
+    bool is_boolean() const noexcept {
+        return kind() == tag::true_ || kind() == tag::false_;
+    }
+    bool is_integral() const noexcept {
+        return kind() == tag::integral;
+    }
+    bool is_double() const noexcept {
+        return kind() == tag::floating;
+    }
+    bool is_number() const noexcept {
+        return is_integral() || is_double();
+    }
+    bool is_string() const noexcept {
+        return kind() == tag::string;
+    }
+    bool is_array() const noexcept {
+        return kind() == tag::array;
+    }
+    bool is_object() const noexcept {
+        return kind() == tag::object;
+    }
+
+    // Number of elements or members of a container, length of a string, 0 otherwise
+    std::size_t size() const noexcept {
+        if(!is_array() && !is_object() && !is_string())
+            return 0;
+        const char* p = m_data + 1;
+        return std::size_t(detail::binary::decode_varint(p));
+    }
+
+    explicit operator bool() const noexcept {
+        return kind() == tag::true_ || (!is_null() && kind() != tag::false_);
+    }
+
+    std::int64_t as_integral() const noexcept {
+        if(is_double())
+            return std::int64_t(as_double());
+        if(!is_integral())
+            return 0;
+        const char* p = m_data + 1;
+        return detail::binary::zigzag_decode(detail::binary::decode_varint(p));
+    }
+
+    double as_double() const noexcept {
+        if(is_integral())
+            return double(as_integral());
+        if(!is_double())
+            return 0;
+        return detail::binary::load_floating(m_data + 1);
+    }
+
+    std::string_view as_string() const noexcept {
+        if(!is_string())
+            return {};
+        const char* p = m_data + 1;
+        const std::size_t size = std::size_t(detail::binary::decode_varint(p));
+        return std::string_view(p, size);
+    }
+
+    // Element of an array
+    binary_value operator[](std::size_t idx) const noexcept {
+        if(!is_array())
+            return {};
+        const char* table = m_data + 1;
+        if(idx >= detail::binary::decode_varint(table))
+            return {};
+        return child(table, idx);
+    }
+
+    // Member of an object, found by binary search over the sorted keys
+    binary_value operator[](std::string_view key) const noexcept {
+        auto idx = find(key);
+        return idx ? value(*idx) : binary_value{};
+    }
+
+    // Index of the member named key
+    std::optional<std::size_t> find(std::string_view key) const noexcept {
+        if(!is_object())
+            return {};
+        const char* table = m_data + 1;
+        std::size_t first = 0;
+        std::size_t count = std::size_t(detail::binary::decode_varint(table));
+        while(count > 0) {
+            const std::size_t half = count / 2;
+            const int c = member_key(table, first + half).compare(key);
+            if(c == 0)
+                return first + half;
+            if(c < 0) {
+                first += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+        return {};
+    }
+
+    // Key of the idx-th member of an object
+    std::string_view key(std::size_t idx) const noexcept {
+        if(!is_object())
+            return {};
+        const char* table = m_data + 1;
+        if(idx >= detail::binary::decode_varint(table))
+            return {};
+        return member_key(table, idx);
+    }
+
+    // Value of the idx-th member of an object
+    binary_value value(std::size_t idx) const noexcept {
+        if(!is_object())
+            return {};
+        const char* table = m_data + 1;
+        if(idx >= detail::binary::decode_varint(table))
+            return {};
+        const char* p = member(table, idx);
+        std::uint64_t size;
+        if(!p || !detail::binary::decode_varint(p, m_end, size) ||
+           size >= std::uint64_t(m_end - p))
+            return {};
+        return binary_value(p + size, m_end);
+    }
+
+    const char* data() const noexcept {
+        return m_data;
+    }
+
+    // Decodes the value and all its children into a property tree
+    template<typename Property>
+    Property to_property() const;
+
+private:
+    // budget is the number of values which can still be decoded
+    template<typename Property>
+    Property to_property(std::size_t depth, std::size_t& budget) const;
+
+    // Whether the tag of the value starting at data is known, and its scalar payload or the
+    // offset table of a container lies before end
+    static bool fits(const char* data, const char* end) noexcept {
+        namespace bin = detail::binary;
+        if(data >= end)
+            return false;
+        const char* p = data + 1;
+        std::uint64_t size;
+        switch(tag(*data)) {
+            case tag::null:
+            case tag::false_:
+            case tag::true_: return true;
+            case tag::integral: return bin::decode_varint(p, end, size);
+            case tag::floating: return end - p >= 8;
+            case tag::string:
+                return bin::decode_varint(p, end, size) && size <= std::uint64_t(end - p);
+            case tag::array:
+            case tag::object:
+                return bin::decode_varint(p, end, size) &&
+                       size <= std::uint64_t(end - p) / bin::offset_size;
+        }
+        return false;
+    }
+
+    // Children are stored after the offset table of their container, which guarantees
+    // that traversals move forward and end, even in corrupt snapshots
+    const char* member(const char* table, std::size_t idx) const noexcept {
+        const char* entry = table + idx * detail::binary::offset_size;
+        const std::uint32_t offset = detail::binary::load_offset(entry);
+        const char* first = table + size() * detail::binary::offset_size;
+        if(offset < std::size_t(first - m_data) || offset >= std::size_t(m_end - m_data))
+            return nullptr;
+        return m_data + offset;
+    }
+    binary_value child(const char* table, std::size_t idx) const noexcept {
+        const char* p = member(table, idx);
+        return p ? binary_value(p, m_end) : binary_value{};
+    }
+    std::string_view member_key(const char* table, std::size_t idx) const noexcept {
+        const char* p = member(table, idx);
+        std::uint64_t size;
+        if(!p || !detail::binary::decode_varint(p, m_end, size) ||
+           size > std::uint64_t(m_end - p))
+            return {};
+        return std::string_view(p, std::size_t(size));
+    }
+
+    static constexpr char null_tag = char(tag::null);
+    const char* m_data;
+    const char* m_end;
+};
+
+template<typename Property>
+Property binary_value::to_property() const {
+    // binary_writer writes each value in its own bytes
+    std::size_t budget = std::size_t(m_end - m_data);
+    return to_property<Property>(0, budget);
+}
+
+template<typename Property>
+Property binary_value::to_property(std::size_t depth, std::size_t& budget) const {
+    if(budget == 0)
+        return Property{};
+    budget--;
+    switch(kind()) {
+        case tag::null: return Property{};
+        case tag::false_: return Property(false);
+        case tag::true_: return Property(true);
+        case tag::integral:
+            return Property(typename Property::integral_t(as_integral()));
+        case tag::floating: return Property(typename Property::floating_t(as_double()));
+        case tag::string: return Property(typename Property::string_t(as_string()));
+        case tag::array: {
+            if(depth >= detail::binary::max_depth)
+                return Property{};
+            typename Property::array_t array;
+            const std::size_t count = size();
+            array.reserve(std::min(count, budget));
+            for(std::size_t i = 0; i < count && budget; i++)
+                array.push_back((*this)[i].to_property<Property>(depth + 1, budget));
+            return Property(std::move(array));
+        }
+        case tag::object: {
+            if(depth >= detail::binary::max_depth)
+                return Property{};
+            typename Property::object_t object;
+            const std::size_t count = size();
+            for(std::size_t i = 0; i < count && budget; i++) {
+                object.emplace(typename Property::key_t(key(i)),
+                               value(i).to_property<Property>(depth + 1, budget));
+            }
+            return Property(std::move(object));
+        }
+    }
+    return Property{};
+}
+
+// Returns the root of a binary snapshot held in [data, data + size), or nothing if the buffer
+// does not start with a valid header. The rest of the snapshot is checked as it is read.
+inline std::optional<binary_value> read_binary(const char* data, std::size_t size) noexcept {
+    namespace bin = detail::binary;
+    if(size <= bin::header_size ||
+       !std::equal(bin::magic.begin(), bin::magic.end(), data) ||
+       std::uint8_t(data[bin::magic.size()]) != bin::version)
+        return {};
+    return binary_value(data + bin::header_size, data + size);
+}
+
+inline std::optional<binary_value> read_binary(std::string_view buffer) noexcept {
+    return read_binary(buffer.data(), buffer.size());
+}
+
+}    // namespace banshee
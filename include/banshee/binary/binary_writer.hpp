@@ -0,0 +1,136 @@
+#pragma once
+#include <limits>
+#include <string>
+#include <variant>
+#include <banshee/binary/binary_format.hpp>
+#include <banshee/property.hpp>
+#include <banshee/detail/util.hpp>
+
+namespace banshee {
+
+// Serializes basic_property trees to the binary snapshot format
+// (see binary/binary_format.hpp). The output buffer is reused across calls.
+class binary_writer {
+public:
+    // Returns false if a container does not fit in 4GB, or containers nest deeper than
+    // detail::binary::max_depth
+    template<typename types>
+    bool write(const basic_property<types>& p) {
+        namespace bin = detail::binary;
+        m_buffer.clear();
+        m_buffer.append(bin::magic.data(), bin::magic.size());
+        m_buffer.push_back(char(bin::version));
+        m_buffer.append(bin::header_size - bin::magic.size() - 1, '\0');
+        return write_value(p, 0);
+    }
+
+    const std::string& buffer() const noexcept {
+        return m_buffer;
+    }
+    std::string release() noexcept {
+        return std::move(m_buffer);
+    }
+
+private:
+    void put_tag(detail::binary::tag t) {
+        m_buffer.push_back(char(t));
+    }
+    void put_varint(std::uint64_t v) {
+        char buffer[10];
+        m_buffer.append(buffer, detail::binary::encode_varint(buffer, v));
+    }
+    template<typename String>
+    void put_string(const String& s) {
+        put_varint(s.size());
+        m_buffer.append(s.data(), s.size());
+    }
+
+    // Reserves the offset table of a container with count children
+    std::size_t put_offset_table(std::size_t count) {
+        put_varint(count);
+        const std::size_t table = m_buffer.size();
+        m_buffer.append(count * detail::binary::offset_size, '\0');
+        return table;
+    }
+    bool set_offset(std::size_t start, std::size_t table, std::size_t i) {
+        const std::size_t offset = m_buffer.size() - start;
+        if(offset > std::numeric_limits<std::uint32_t>::max())
+            return false;
+        detail::binary::store_offset(&m_buffer[table + i * detail::binary::offset_size],
+                                     std::uint32_t(offset));
+        return true;
+    }
+
+    template<typename types>
+    bool write_value(const basic_property<types>& p, std::size_t depth) {
+        using property_t = basic_property<types>;
+        using tag = detail::binary::tag;
+        if((p.is_array() || p.is_object()) && depth >= detail::binary::max_depth)
+            return false;
+        return std::visit(
+            detail::overloaded{
+                [this](const std::monostate&) {
+                    put_tag(tag::null);
+                    return true;
+                },
+                [this](const typename property_t::bool_t& e) {
+                    put_tag(e ? tag::true_ : tag::false_);
+                    return true;
+                },
+                [this](const typename property_t::integral_t& e) {
+                    put_tag(tag::integral);
+                    put_varint(detail::binary::zigzag_encode(e));
+                    return true;
+                },
+                [this](const typename property_t::floating_t& e) {
+                    // Raw integers are read back as integers
+                    if constexpr(detail::is_raw_number_v<typename property_t::floating_t>) {
+                        if(e.is_integral()) {
+                            put_tag(tag::integral);
+                            put_varint(detail::binary::zigzag_encode(std::int64_t(e)));
+                            return true;
+                        }
+                    }
+                    put_tag(tag::floating);
+                    char buffer[8];
+                    detail::binary::store_floating(buffer, double(e));
+                    m_buffer.append(buffer, sizeof(buffer));
+                    return true;
+                },
+                [this](const typename property_t::string_t& e) {
+                    put_tag(tag::string);
+                    put_string(e);
+                    return true;
+                },
+                [this, depth](const typename property_t::array_t& e) {
+                    const std::size_t start = m_buffer.size();
+                    put_tag(tag::array);
+                    const std::size_t table = put_offset_table(e.size());
+                    std::size_t i = 0;
+                    for(auto&& element : e) {
+                        if(!set_offset(start, table, i++) || !write_value(element, depth + 1))
+                            return false;
+                    }
+                    return true;
+                },
+                [this, depth](const typename property_t::object_t& e) {
+                    const std::size_t start = m_buffer.size();
+                    put_tag(tag::object);
+                    const std::size_t table = put_offset_table(e.size());
+                    std::size_t i = 0;
+                    for(auto&& member : e) {
+                        if(!set_offset(start, table, i++))
+                            return false;
+                        put_string(member.first);
+                        if(!write_value(member.second, depth + 1))
+                            return false;
+                    }
+                    return true;
+                }},
+            p.value);
+    }
+
+    std::string m_buffer;
+};
+
+}    // namespace banshee
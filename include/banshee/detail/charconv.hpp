@@ -0,0 +1,205 @@
+#pragma once
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace banshee::detail {
+
+enum class number_kind { invalid, integral, floating };
+
+// Longest number literal the lexers will buffer.
+constexpr std::size_t max_number_length = 256;
+
+// Value of each ascii hexadecimal digit, -1 for any other character.
+constexpr auto hex_table = [] {
+    std::array<std::int8_t, 128> table{};
+    for(std::size_t i = 0; i < table.size(); i++)
+        table[i] = -1;
+    for(int i = 0; i < 10; i++)
+        table['0' + i] = std::int8_t(i);
+    for(int i = 0; i < 6; i++) {
+        table['a' + i] = std::int8_t(10 + i);
+        table['A' + i] = std::int8_t(10 + i);
+    }
+    return table;
+}();
+
+inline int hex_digit_value(char32_t c) noexcept {
+    return c < hex_table.size() ? hex_table[c] : -1;
+}
+
+// Decodes 4 hexadecimal digits starting at it, advancing it past them.
+inline bool decode_hex4(const char*& it, const char* end, char32_t& out) noexcept {
+    if(end - it < 4)
+        return false;
+    int digits[4];
+    for(int i = 0; i < 4; i++)
+        digits[i] = hex_digit_value(std::uint8_t(it[i]));
+    // Shifting the -1 of an invalid digit would be undefined
+    if((digits[0] | digits[1] | digits[2] | digits[3]) < 0)
+        return false;
+    it += 4;
+    out = char32_t((digits[0] << 12) | (digits[1] << 8) | (digits[2] << 4) | digits[3]);
+    return true;
+}
+
+constexpr bool is_number_char(char32_t c) noexcept {
+    return (c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '-' || c == '+';
+}
+
+// Returns the end of the longest prefix of [first, last) forming a json number, or first if
+// there is none. Only the syntax is checked, nothing is converted.
+inline const char* match_number(const char* first, const char* last) noexcept {
+    const char* p = first;
+    auto digits = [&] {
+        const char* start = p;
+        while(p != last && *p >= '0' && *p <= '9')
+            ++p;
+        return p != start;
+    };
+    if(p != last && *p == '-')
+        ++p;
+    if(p != last && *p == '0')
+        ++p;
+    else if(!digits())
+        return first;
+    if(p != last && *p == '.') {
+        const char* dot = p++;
+        if(!digits())
+            return dot;
+    }
+    if(p != last && (*p == 'e' || *p == 'E')) {
+        const char* e = p++;
+        if(p != last && (*p == '+' || *p == '-'))
+            ++p;
+        if(!digits())
+            return e;
+    }
+    return p;
+}
+
+// Parses a json number (-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?) spanning exactly
+// [first, last).
+// Integers that fit in Integral are returned as such, everything else as a Floating.
+// Short mantissas with small exponents are converted exactly without calling strtod.
+template<typename Integral, typename Floating>
+number_kind parse_number(const char* first, const char* last, Integral& i, Floating& d) noexcept {
+    constexpr int max_digits = std::numeric_limits<std::uint64_t>::digits10;
+    const char* p = first;
+    const bool negative = p != last && *p == '-';
+    if(negative)
+        ++p;
+    if(p == last || *p < '0' || *p > '9')
+        return number_kind::invalid;
+
+    std::uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool truncated = false;
+    bool integral = true;
+
+    auto push_digit = [&](char c) {
+        if(digits < max_digits) {
+            mantissa = mantissa * 10 + unsigned(c - '0');
+            if(mantissa != 0)
+                ++digits;
+            return true;
+        }
+        truncated |= c != '0';
+        return false;
+    };
+
+    if(*p == '0') {
+        ++p;
+        if(p != last && *p >= '0' && *p <= '9')
+            return number_kind::invalid;    // leading zero
+    } else {
+        for(; p != last && *p >= '0' && *p <= '9'; ++p) {
+            if(!push_digit(*p))
+                ++exponent;
+        }
+    }
+    if(p != last && *p == '.') {
+        integral = false;
+        ++p;
+        if(p == last || *p < '0' || *p > '9')
+            return number_kind::invalid;
+        for(; p != last && *p >= '0' && *p <= '9'; ++p) {
+            if(push_digit(*p))
+                --exponent;
+        }
+    }
+    if(p != last && (*p == 'e' || *p == 'E')) {
+        integral = false;
+        ++p;
+        bool negative_exponent = false;
+        if(p != last && (*p == '+' || *p == '-')) {
+            negative_exponent = *p == '-';
+            ++p;
+        }
+        if(p == last || *p < '0' || *p > '9')
+            return number_kind::invalid;
+        int e = 0;
+        for(; p != last && *p >= '0' && *p <= '9'; ++p) {
+            if(e < 100000)
+                e = e * 10 + (*p - '0');
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+    if(p != last)
+        return number_kind::invalid;
+
+    if(integral && !truncated && exponent == 0 && !(negative && mantissa == 0)) {
+        constexpr auto max = std::uint64_t(std::numeric_limits<Integral>::max());
+        if(mantissa <= max + (negative ? 1 : 0)) {
+            i = negative ? Integral(-std::int64_t(mantissa - 1) - 1) : Integral(mantissa);
+            return number_kind::integral;
+        }
+    }
+
+    constexpr double powers_of_ten[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                                        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    if(!truncated && mantissa <= (std::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22) {
+        double v = double(mantissa);
+        v = exponent < 0 ? v / powers_of_ten[-exponent] : v * powers_of_ten[exponent];
+        d = Floating(negative ? -v : v);
+        return number_kind::floating;
+    }
+
+    // Slow path, strtod needs a null terminated buffer
+    char buffer[max_number_length + 1];
+    const std::size_t size = std::size_t(last - first);
+    if(size > max_number_length)
+        return number_kind::invalid;
+    std::memcpy(buffer, first, size);
+    buffer[size] = 0;
+    d = Floating(std::strtod(buffer, nullptr));
+    return number_kind::floating;
+}
+
+// Writes the shortest representation of a finite d that reads back as the same double to
+// out, which must hold 32 characters. Without floating point to_chars, the shortest of 15 or
+// 17 significant digits.
+inline std::size_t format_double(double d, char* out) noexcept {
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    std::size_t size = std::size_t(std::to_chars(out, out + 30, d).ptr - out);
+    out[size] = 0;
+#else
+    int size = std::snprintf(out, 32, "%.15g", d);
+    if(std::strtod(out, nullptr) != d)
+        size = std::snprintf(out, 32, "%.17g", d);
+#endif
+    // Keep doubles distinguishable from integers when read back
+    if(!std::strpbrk(out, ".eE")) {
+        out[size++] = '.';
+        out[size++] = '0';
+    }
+    return std::size_t(size);
+}
+
+}    // namespace banshee::detail
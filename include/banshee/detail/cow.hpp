@@ -0,0 +1,206 @@
+#pragma once
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <utility>
+
+namespace banshee::detail {
+
+// A reference counted container with copy on write semantics.
+// Copies share the same container. Any non const access first detaches the container if it
+// is shared, so modifying a nested value only clones the containers along its path.
+// Const member functions never allocate; an empty cow does not own a container.
+// The container can carry the structural hash of its content (see value_pool), the hash is
+// forgotten as soon as the container is accessed mutably.
+//
+// References into a shared container would let writes through one copy show in the others,
+// so the container is only ever modified in ways that do not leak them:
+//  - iteration and find() are read only, and never detach, even on a non const cow;
+//  - push_back, insert, erase... modify the container and return nothing;
+//  - modify() hands the container to a function, which must not keep references to it;
+//  - operator[] and get_mutable() return references which outlive the call. They mark the
+//    container unshareable: later copies clone it instead of sharing it, until it is
+//    replaced by an assignment or clear().
+template<typename Container>
+class cow {
+public:
+    using container_type = Container;
+    using value_type = typename Container::value_type;
+    using size_type = typename Container::size_type;
+    using const_iterator = typename Container::const_iterator;
+
+    cow() noexcept = default;
+    cow(const Container& c) : m_ptr(std::make_shared<node>(std::in_place, c)) {}
+    cow(Container&& c) : m_ptr(std::make_shared<node>(std::in_place, std::move(c))) {}
+    cow(std::initializer_list<value_type> il) : m_ptr(std::make_shared<node>(std::in_place, il)) {}
+    cow(const cow& other) : m_ptr(other.share()) {}
+    cow(cow&& other) noexcept = default;
+    cow& operator=(const cow& other) {
+        m_ptr = other.share();
+        return *this;
+    }
+    cow& operator=(cow&& other) noexcept = default;
+
+    const Container& get() const noexcept {
+        return m_ptr ? m_ptr->value : empty_container();
+    }
+    Container& get_mutable() {
+        Container& c = mutate();
+        m_ptr->shareable = false;
+        return c;
+    }
+    // Calls f with the container, detached. f must not keep references into it.
+    template<typename F>
+    decltype(auto) modify(F&& f) {
+        return std::forward<F>(f)(mutate());
+    }
+    // Whether other copies share the container
+    bool is_shared() const noexcept {
+        return m_ptr && m_ptr.use_count() > 1;
+    }
+    const void* identity() const noexcept {
+        return m_ptr.get();
+    }
+
+    // Cached structural hash of the container, 0 if unknown
+    std::uint64_t cached_hash() const noexcept {
+        return m_ptr ? m_ptr->hash : 0;
+    }
+    // Does not detach: the content, hence the hash, is the same for all the copies.
+    // Must not be called while other threads can read the hash.
+    void cache_hash(std::uint64_t hash) noexcept {
+        if(m_ptr)
+            m_ptr->hash = hash;
+    }
+
+    size_type size() const noexcept {
+        return get().size();
+    }
+    bool empty() const noexcept {
+        return get().empty();
+    }
+
+    const_iterator begin() const noexcept {
+        return get().begin();
+    }
+    const_iterator end() const noexcept {
+        return get().end();
+    }
+    const_iterator cbegin() const noexcept {
+        return get().begin();
+    }
+    const_iterator cend() const noexcept {
+        return get().end();
+    }
+
+    template<typename K>
+    auto operator[](K&& k) const -> decltype(std::declval<const Container&>()[k]) {
+        return get()[std::forward<K>(k)];
+    }
+    template<typename K>
+    auto operator[](K&& k) -> decltype(std::declval<Container&>()[std::forward<K>(k)]) {
+        return get_mutable()[std::forward<K>(k)];
+    }
+
+    template<typename K>
+    const_iterator find(const K& k) const {
+        return get().find(k);
+    }
+    template<typename K>
+    size_type count(const K& k) const {
+        return get().count(k);
+    }
+
+    template<typename... Args>
+    void push_back(Args&&... args) {
+        mutate().push_back(std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    void emplace_back(Args&&... args) {
+        mutate().emplace_back(std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    void emplace(Args&&... args) {
+        mutate().emplace(std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    void insert(Args&&... args) {
+        mutate().insert(std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    void insert_or_assign(Args&&... args) {
+        mutate().insert_or_assign(std::forward<Args>(args)...);
+    }
+    // By key, positions can only be taken from get_mutable()
+    template<typename K>
+    size_type erase(const K& k) {
+        return mutate().erase(k);
+    }
+    template<typename... Args>
+    void resize(Args&&... args) {
+        mutate().resize(std::forward<Args>(args)...);
+    }
+    void reserve(size_type n) {
+        mutate().reserve(n);
+    }
+    void clear() noexcept {
+        m_ptr.reset();
+    }
+
+    friend bool operator==(const cow& a, const cow& b) {
+        if(a.m_ptr == b.m_ptr)
+            return true;
+        const std::uint64_t ha = a.cached_hash(), hb = b.cached_hash();
+        if(ha && hb && ha != hb)
+            return false;
+        return a.get() == b.get();
+    }
+    friend bool operator!=(const cow& a, const cow& b) {
+        return !(a == b);
+    }
+
+private:
+    struct node {
+        template<typename... Args>
+        explicit node(std::in_place_t, Args&&... args) : value(std::forward<Args>(args)...) {}
+        Container value;
+        std::uint64_t hash = 0;
+        // Cleared when references into value are handed out
+        bool shareable = true;
+    };
+
+    Container& mutate() {
+        if(!m_ptr)
+            m_ptr = std::make_shared<node>(std::in_place);
+        else if(m_ptr.use_count() > 1)
+            m_ptr = std::make_shared<node>(std::in_place, m_ptr->value);
+        m_ptr->hash = 0;
+        return m_ptr->value;
+    }
+    std::shared_ptr<node> share() const {
+        if(!m_ptr || m_ptr->shareable)
+            return m_ptr;
+        auto copy = std::make_shared<node>(std::in_place, m_ptr->value);
+        copy->hash = m_ptr->hash;
+        return copy;
+    }
+    static const Container& empty_container() noexcept {
+        static const Container empty;
+        return empty;
+    }
+
+    std::shared_ptr<node> m_ptr;
+};
+
+// The array or object container of a property, to modify it through references or iterators.
+// Marks shared containers unshareable, see cow.
+template<typename Container>
+Container& mutable_container(Container& c) noexcept {
+    return c;
+}
+template<typename Container>
+Container& mutable_container(cow<Container>& c) {
+    return c.get_mutable();
+}
+
+}    // namespace banshee::detail
@@ -0,0 +1,237 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <streambuf>
+#include <banshee/detail/prefetch_reader.hpp>
+#ifdef BANSHEE_USE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef BANSHEE_USE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace banshee::detail {
+
+enum class compression { none, gzip, zstd };
+
+// Recognizes a compressed file from its first bytes, as test_bom does for encodings
+inline compression detect_compression(const std::array<char, 4>& prefix) noexcept {
+    const auto byte = [&](std::size_t i) { return std::uint8_t(prefix[i]); };
+    if(byte(0) == 0x1F && byte(1) == 0x8B)
+        return compression::gzip;
+    if(byte(0) == 0x28 && byte(1) == 0xB5 && byte(2) == 0x2F && byte(3) == 0xFD)
+        return compression::zstd;
+    return compression::none;
+}
+
+// Whether banshee was built with support for the format, see BANSHEE_ZLIB and BANSHEE_ZSTD
+constexpr bool can_decompress(compression c) noexcept {
+    switch(c) {
+#ifdef BANSHEE_USE_ZLIB
+        case compression::gzip: return true;
+#endif
+#ifdef BANSHEE_USE_ZSTD
+        case compression::zstd: return true;
+#endif
+        default: return false;
+    }
+}
+
+// Decoders decode as much of [in, in_end) into [out, out_end) as they can and advance both
+// pointers. decode returns false on corrupt input. at_boundary tells whether all the input
+// so far forms complete streams, ie whether the input may end there.
+// Concatenated streams, as produced by cat or by parallel compressors, are decoded one after
+// the other.
+
+#ifdef BANSHEE_USE_ZLIB
+class gzip_decoder {
+public:
+    gzip_decoder() {
+        // 16 + 15: gzip header, largest window
+        m_ok = inflateInit2(&m_stream, 16 + MAX_WBITS) == Z_OK;
+    }
+    gzip_decoder(const gzip_decoder&) = delete;
+    gzip_decoder& operator=(const gzip_decoder&) = delete;
+    ~gzip_decoder() {
+        if(m_ok)
+            inflateEnd(&m_stream);
+    }
+
+    bool decode(const char*& in, const char* in_end, char*& out, char* out_end) {
+        if(!m_ok)
+            return false;
+        m_stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+        m_stream.avail_in = uInt(std::min<std::size_t>(std::size_t(in_end - in), UINT_MAX));
+        m_stream.next_out = reinterpret_cast<Bytef*>(out);
+        m_stream.avail_out = uInt(std::min<std::size_t>(std::size_t(out_end - out), UINT_MAX));
+        const int ret = inflate(&m_stream, Z_NO_FLUSH);
+        const char* const consumed = reinterpret_cast<const char*>(m_stream.next_in);
+        if(consumed != in)
+            m_at_boundary = false;
+        in = consumed;
+        out = reinterpret_cast<char*>(m_stream.next_out);
+        if(ret == Z_STREAM_END) {
+            // Another member may follow
+            m_at_boundary = true;
+            return inflateReset(&m_stream) == Z_OK;
+        }
+        // Z_BUF_ERROR only means that no progress was possible
+        return ret == Z_OK || ret == Z_BUF_ERROR;
+    }
+    bool at_boundary() const noexcept {
+        return m_at_boundary;
+    }
+
+private:
+    z_stream m_stream = {};
+    bool m_ok = false;
+    bool m_at_boundary = true;
+};
+#endif
+
+#ifdef BANSHEE_USE_ZSTD
+class zstd_decoder {
+public:
+    zstd_decoder() : m_stream(ZSTD_createDStream()) {
+        if(m_stream && ZSTD_isError(ZSTD_initDStream(m_stream))) {
+            ZSTD_freeDStream(m_stream);
+            m_stream = nullptr;
+        }
+    }
+    zstd_decoder(const zstd_decoder&) = delete;
+    zstd_decoder& operator=(const zstd_decoder&) = delete;
+    ~zstd_decoder() {
+        ZSTD_freeDStream(m_stream);
+    }
+
+    bool decode(const char*& in, const char* in_end, char*& out, char* out_end) {
+        if(!m_stream)
+            return false;
+        ZSTD_inBuffer input{in, std::size_t(in_end - in), 0};
+        ZSTD_outBuffer output{out, std::size_t(out_end - out), 0};
+        const std::size_t ret = ZSTD_decompressStream(m_stream, &output, &input);
+        if(ZSTD_isError(ret))
+            return false;
+        in += input.pos;
+        out += output.pos;
+        // 0 once a frame is decoded and flushed, a new frame may follow
+        if(input.pos || output.pos)
+            m_at_boundary = ret == 0;
+        return true;
+    }
+    bool at_boundary() const noexcept {
+        return m_at_boundary;
+    }
+
+private:
+    ZSTD_DStream* m_stream;
+    bool m_at_boundary = true;
+};
+#endif
+
+// A stream buffer decoding a compressed stream read from another stream buffer.
+// Input is read in blocks of input_size, and decoded until the output buffer is full, so that
+// the lexer reads large blocks in place. Wrap it in a prefetch_streambuf to decode on a
+// separate thread, ahead of the lexer.
+// Corrupt or truncated input ends the stream early, see failed().
+template<typename Decoder>
+class decompress_streambuf : public peekable_streambuf {
+public:
+    static constexpr std::size_t default_buffer_size = 1024 * 1024;
+    static constexpr std::size_t input_size = 256 * 1024;
+
+    explicit decompress_streambuf(std::unique_ptr<std::streambuf> source,
+                                  std::size_t buffer_size = default_buffer_size) :
+        m_source(std::move(source)),
+        m_input(new char[input_size]),
+        m_output(new char[buffer_size]),
+        m_buffer_size(buffer_size) {}
+
+    // Whether the input was corrupt or truncated, or could not be read
+    bool failed() const noexcept override {
+        return m_failed || source_failed();
+    }
+
+protected:
+    int_type underflow() override {
+        if(gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        char* out = m_output.get();
+        char* const out_end = out + m_buffer_size;
+        while(out != out_end && !m_ended) {
+            if(m_in == m_in_end) {
+                const std::streamsize n =
+                    m_source ? m_source->sgetn(m_input.get(), input_size) : 0;
+                m_in = m_input.get();
+                m_in_end = m_in + (n > 0 ? n : 0);
+                if(n <= 0) {
+                    m_ended = true;
+                    m_failed = !m_decoder.at_boundary();
+                    break;
+                }
+            }
+            if(!m_decoder.decode(m_in, m_in_end, out, out_end)) {
+                m_ended = m_failed = true;
+                break;
+            }
+        }
+        setg(m_output.get(), m_output.get(), out);
+        if(out == m_output.get())
+            return traits_type::eof();
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    // A prefetched source reports its read errors
+    bool source_failed() const noexcept {
+        if(auto* source = dynamic_cast<const peekable_streambuf*>(m_source.get()))
+            return source->failed();
+        return false;
+    }
+
+    std::unique_ptr<std::streambuf> m_source;
+    std::unique_ptr<char[]> m_input;
+    std::unique_ptr<char[]> m_output;
+    std::size_t m_buffer_size;
+    const char* m_in = nullptr;
+    const char* m_in_end = nullptr;
+    Decoder m_decoder;
+    bool m_ended = false;
+    bool m_failed = false;
+};
+
+template<typename Decoder>
+std::unique_ptr<peekable_streambuf>
+make_decompress_streambuf(std::unique_ptr<std::streambuf> source, bool pipelined) {
+    auto decoded = std::make_unique<decompress_streambuf<Decoder>>(std::move(source));
+    if(!pipelined)
+        return decoded;
+    return std::make_unique<prefetch_streambuf>(std::move(decoded));
+}
+
+// Decodes source, which must be in a format which can_decompress. When pipelined, decoding
+// runs on its own thread.
+inline std::unique_ptr<peekable_streambuf>
+make_decompress_streambuf(std::unique_ptr<std::streambuf> source, compression c, bool pipelined) {
+    switch(c) {
+#ifdef BANSHEE_USE_ZLIB
+        case compression::gzip:
+            return make_decompress_streambuf<gzip_decoder>(std::move(source), pipelined);
+#endif
+#ifdef BANSHEE_USE_ZSTD
+        case compression::zstd:
+            return make_decompress_streambuf<zstd_decoder>(std::move(source), pipelined);
+#endif
+        default:
+            (void)source;
+            (void)pipelined;
+            return nullptr;
+    }
+}
+
+}    // namespace banshee::detail
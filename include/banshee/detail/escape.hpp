@@ -0,0 +1,96 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <banshee/detail/charconv.hpp>
+#include <banshee/unicode.hpp>
+
+namespace banshee::detail {
+
+// Decoded value of the single character escape sequences of json, 0 when the character after
+// the backslash does not form one.
+constexpr auto json_escape_table = [] {
+    std::array<char, 128> table{};
+    table['b'] = '\b';
+    table['f'] = '\f';
+    table['n'] = '\n';
+    table['r'] = '\r';
+    table['t'] = '\t';
+    table['"'] = '"';
+    table['/'] = '/';
+    table['\\'] = '\\';
+    return table;
+}();
+
+// ICI strings also accept \v and \'
+constexpr auto ici_escape_table = [] {
+    auto table = json_escape_table;
+    table['v'] = '\v';
+    table['\''] = '\'';
+    return table;
+}();
+
+// Ascii characters that end a run of verbatim string content: the double quote,
+// backslashes and control characters.
+constexpr auto string_stop_table = [] {
+    std::array<bool, 128> table{};
+    for(int i = 0; i < 0x20; i++)
+        table[i] = true;
+    table['"'] = true;
+    table['\\'] = true;
+    return table;
+}();
+
+inline bool is_high_surrogate(char32_t c) noexcept {
+    return c >= 0xD800 && c <= 0xDBFF;
+}
+
+inline bool is_low_surrogate(char32_t c) noexcept {
+    return c >= 0xDC00 && c <= 0xDFFF;
+}
+
+// Decodes the content of a json string from utf-8 input, it must point just past the opening
+// quote. Runs of characters that need no decoding are appended to out in bulk.
+// On success, it points past the closing quote.
+inline bool decode_string(const char*& it, const char* end, std::string& out) {
+    const char* p = it;
+    while(true) {
+        const char* run = p;
+        while(p != end && (std::uint8_t(*p) >= 0x80 || !string_stop_table[std::uint8_t(*p)]))
+            ++p;
+        out.append(run, std::size_t(p - run));
+        if(p == end)
+            return false;
+        const char c = *p++;
+        if(c == '"') {
+            it = p;
+            return true;
+        }
+        if(c != '\\' || p == end)
+            return false;    // control character or dangling backslash
+        const char e = *p++;
+        if(std::uint8_t(e) < 0x80 && json_escape_table[std::uint8_t(e)]) {
+            out.push_back(json_escape_table[std::uint8_t(e)]);
+            continue;
+        }
+        if(e != 'u')
+            return false;
+        char32_t codepoint;
+        if(!decode_hex4(p, end, codepoint) || is_low_surrogate(codepoint))
+            return false;
+        // Surrogates must come in pairs, lone ones cannot be encoded in utf-8
+        if(is_high_surrogate(codepoint)) {
+            if(end - p < 6 || p[0] != '\\' || p[1] != 'u')
+                return false;
+            p += 2;
+            char32_t low;
+            if(!decode_hex4(p, end, low) || !is_low_surrogate(low))
+                return false;
+            codepoint = surrogate_pair_to_codepoint(codepoint, low);
+        }
+        char buffer[4];
+        out.append(buffer, encode_utf8(buffer, codepoint));
+    }
+}
+
+}    // namespace banshee::detail
@@ -6,6 +6,8 @@
 #define CPPCORO_GENERATOR_HPP_INCLUDED
 
 #include <experimental/coroutine>
+#include <exception>
+#include <functional>
 #include <type_traits>
 #include <utility>
 
@@ -25,10 +27,10 @@ namespace detail {
 
         generator<T> get_return_object() noexcept;
 
-        constexpr std::experimental::suspend_always initial_suspend() const {
+        constexpr std::experimental::suspend_always initial_suspend() const noexcept {
             return {};
         }
-        constexpr std::experimental::suspend_always final_suspend() const {
+        constexpr std::experimental::suspend_always final_suspend() const noexcept {
             return {};
         }
 
@@ -44,7 +46,11 @@ namespace detail {
         }
 
         void unhandled_exception() {
+#ifdef __cpp_exceptions
             std::rethrow_exception(std::current_exception());
+#else
+            std::terminate();
+#endif
         }
 
         void return_void() {}
@@ -93,6 +99,9 @@ public:
             return decltype(m_coroutine.promise().value()){};
         }
         m_coroutine.resume();
+        // The last yielded value does not outlive the end of the coroutine
+        if(m_coroutine.done())
+            return decltype(m_coroutine.promise().value()){};
         return m_coroutine.promise().value();
     }
 
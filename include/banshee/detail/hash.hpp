@@ -0,0 +1,81 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+namespace banshee::detail {
+
+// 64 bits hashing of byte strings (after wyhash, public domain).
+// Fast on short keys, and every bit of the result depends on every bit of the input.
+
+inline std::uint64_t hash_mix(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined(__SIZEOF_INT128__)
+    const __uint128_t r = __uint128_t(a) * b;
+    return std::uint64_t(r) ^ std::uint64_t(r >> 64);
+#else
+    a ^= b * 0x9E3779B97F4A7C15ull;
+    a ^= a >> 32;
+    a *= 0xD6E8FEB86659FD93ull;
+    return a ^ (a >> 32);
+#endif
+}
+
+inline std::uint64_t hash_read64(const unsigned char* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t hash_read32(const unsigned char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t hash_bytes(const void* data, std::size_t size,
+                                std::uint64_t seed = 0) noexcept {
+    constexpr std::uint64_t k0 = 0xa0761d6478bd642full;
+    constexpr std::uint64_t k1 = 0xe7037ed1a0b428dbull;
+    constexpr std::uint64_t k2 = 0x8ebc6af09c88c6e3ull;
+    constexpr std::uint64_t k3 = 0x589965cc75374cc3ull;
+
+    const auto* p = static_cast<const unsigned char*>(data);
+    seed ^= k0;
+    std::uint64_t a = 0, b = 0;
+    if(size <= 16) {
+        if(size >= 4) {
+            const std::size_t mid = (size >> 3) << 2;
+            a = (hash_read32(p) << 32) | hash_read32(p + mid);
+            b = (hash_read32(p + size - 4) << 32) | hash_read32(p + size - 4 - mid);
+        } else if(size > 0) {
+            a = (std::uint64_t(p[0]) << 16) | (std::uint64_t(p[size >> 1]) << 8) | p[size - 1];
+        }
+    } else {
+        std::size_t i = size;
+        if(i > 48) {
+            std::uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = hash_mix(hash_read64(p) ^ k1, hash_read64(p + 8) ^ seed);
+                seed1 = hash_mix(hash_read64(p + 16) ^ k2, hash_read64(p + 24) ^ seed1);
+                seed2 = hash_mix(hash_read64(p + 32) ^ k3, hash_read64(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while(i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while(i > 16) {
+            seed = hash_mix(hash_read64(p) ^ k1, hash_read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = hash_read64(p + i - 16);
+        b = hash_read64(p + i - 8);
+    }
+    return hash_mix(k1 ^ size, hash_mix(a ^ k1, b ^ seed));
+}
+
+template<typename String>
+std::uint64_t hash_string(const String& s, std::uint64_t seed = 0) noexcept {
+    return hash_bytes(s.data(), s.size() * sizeof(*s.data()), seed);
+}
+
+}    // namespace banshee::detail
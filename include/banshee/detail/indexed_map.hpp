@@ -0,0 +1,293 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <banshee/detail/hash.hpp>
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+namespace banshee::detail {
+
+// Open addressing hash table of iterators into a node based map, probed 16 slots at a time.
+// Each slot has a control byte, either empty or holding 7 bits of the hash of its key, and the
+// control bytes of a group are compared against the searched hash in a single SIMD
+// instruction. The first group is mirrored past the end so groups can be loaded at any
+// position.
+template<typename Iterator>
+class hash_index {
+public:
+    static constexpr std::size_t group_size = 16;
+    static constexpr std::uint8_t empty = 0x80;
+
+    explicit hash_index(std::size_t expected) {
+        m_capacity = group_size;
+        while(m_capacity * 7 / 8 < expected)
+            m_capacity *= 2;
+        m_control = std::make_unique<std::uint8_t[]>(m_capacity + group_size);
+        std::fill_n(m_control.get(), m_capacity + group_size, empty);
+        m_slots = std::make_unique<Iterator[]>(m_capacity);
+    }
+
+    // Returns false when the table is full
+    bool insert(Iterator it, std::uint64_t hash) noexcept {
+        if(m_size + 1 > m_capacity * 7 / 8)
+            return false;
+        std::size_t pos = std::size_t(hash >> 7) & (m_capacity - 1);
+        while(true) {
+            if(std::uint32_t mask = match(pos, empty)) {
+                const std::size_t slot = (pos + std::size_t(__builtin_ctz(mask))) & (m_capacity - 1);
+                set_control(slot, std::uint8_t(hash & 0x7F));
+                m_slots[slot] = it;
+                m_size++;
+                return true;
+            }
+            pos = (pos + group_size) & (m_capacity - 1);
+        }
+    }
+
+    // Returns the slot holding the iterator whose key satisfies equal, or nullptr
+    template<typename Equal>
+    const Iterator* find(std::uint64_t hash, Equal&& equal) const noexcept {
+        const std::uint8_t h2 = std::uint8_t(hash & 0x7F);
+        std::size_t pos = std::size_t(hash >> 7) & (m_capacity - 1);
+        while(true) {
+            for(std::uint32_t mask = match(pos, h2); mask; mask &= mask - 1) {
+                const std::size_t slot = (pos + std::size_t(__builtin_ctz(mask))) & (m_capacity - 1);
+                if(equal(m_slots[slot]))
+                    return &m_slots[slot];
+            }
+            if(match(pos, empty))
+                return nullptr;
+            pos = (pos + group_size) & (m_capacity - 1);
+        }
+    }
+
+private:
+    // Bit i is set if the control byte at pos + i equals b
+    std::uint32_t match(std::size_t pos, std::uint8_t b) const noexcept {
+        const std::uint8_t* group = m_control.get() + pos;
+#if defined(__SSE2__)
+        const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        return std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(char(b)))));
+#else
+        std::uint32_t mask = 0;
+        for(std::size_t i = 0; i < group_size; i++)
+            mask |= std::uint32_t(group[i] == b) << i;
+        return mask;
+#endif
+    }
+
+    void set_control(std::size_t slot, std::uint8_t b) noexcept {
+        m_control[slot] = b;
+        if(slot < group_size)
+            m_control[m_capacity + slot] = b;
+    }
+
+    std::unique_ptr<std::uint8_t[]> m_control;
+    std::unique_ptr<Iterator[]> m_slots;
+    std::size_t m_capacity = 0;
+    std::size_t m_size = 0;
+};
+
+// An ordered map of strings which builds a hash index the first time a large instance is
+// searched, making lookups O(1) on objects with many members.
+// Lookups accept any type convertible to a string view of the key.
+// Building the index from concurrent const lookups is thread safe.
+template<typename Key, typename T>
+class indexed_map {
+    using map_t = std::map<Key, T, std::less<>>;
+    using key_view_t = std::basic_string_view<typename Key::value_type>;
+    using index_t = hash_index<typename map_t::const_iterator>;
+
+public:
+    // Smaller maps are searched by the binary tree
+    static constexpr std::size_t index_threshold = 32;
+
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = typename map_t::value_type;
+    using size_type = typename map_t::size_type;
+    using iterator = typename map_t::iterator;
+    using const_iterator = typename map_t::const_iterator;
+
+    indexed_map() = default;
+    indexed_map(std::initializer_list<value_type> il) : m_map(il) {}
+    indexed_map(const indexed_map& other) : m_map(other.m_map) {}
+    indexed_map(indexed_map&& other) noexcept :
+        m_map(std::move(other.m_map)),
+        m_index(other.m_index.exchange(nullptr)) {}
+    ~indexed_map() {
+        delete m_index.load(std::memory_order_relaxed);
+    }
+    indexed_map& operator=(const indexed_map& other) {
+        if(this != &other) {
+            drop_index();
+            m_map = other.m_map;
+        }
+        return *this;
+    }
+    indexed_map& operator=(indexed_map&& other) noexcept {
+        if(this != &other) {
+            drop_index();
+            m_map = std::move(other.m_map);
+            m_index.store(other.m_index.exchange(nullptr), std::memory_order_relaxed);
+        }
+        return *this;
+    }
+
+    size_type size() const noexcept {
+        return m_map.size();
+    }
+    bool empty() const noexcept {
+        return m_map.empty();
+    }
+
+    iterator begin() noexcept {
+        return m_map.begin();
+    }
+    iterator end() noexcept {
+        return m_map.end();
+    }
+    const_iterator begin() const noexcept {
+        return m_map.begin();
+    }
+    const_iterator end() const noexcept {
+        return m_map.end();
+    }
+    const_iterator cbegin() const noexcept {
+        return m_map.begin();
+    }
+    const_iterator cend() const noexcept {
+        return m_map.end();
+    }
+
+    template<typename K>
+    const_iterator find(const K& key) const {
+        const key_view_t k(key);
+        if(m_map.size() >= index_threshold) {
+            const index_t* index = get_index();
+            const auto* slot = index->find(
+                hash_string(k), [&k](const const_iterator& it) { return key_view_t(it->first) == k; });
+            return slot ? *slot : m_map.end();
+        }
+        return m_map.find(k);
+    }
+    template<typename K>
+    iterator find(const K& key) {
+        const_iterator it = std::as_const(*this).find(key);
+        return m_map.erase(it, it);
+    }
+    template<typename K>
+    size_type count(const K& key) const {
+        return find(key) == end() ? 0 : 1;
+    }
+    template<typename K>
+    const T& at(const K& key) const {
+        return find(key)->second;
+    }
+
+    T& operator[](const Key& key) {
+        return try_emplace(key).first->second;
+    }
+    T& operator[](Key&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+    // Only allocates a key when it is inserted
+    template<typename K,
+             typename = std::enable_if_t<std::is_convertible_v<const K&, key_view_t> &&
+                                         !std::is_same_v<K, Key>>>
+    T& operator[](const K& key) {
+        const auto it = find(key);
+        if(it != end())
+            return it->second;
+        return try_emplace(Key(key_view_t(key))).first->second;
+    }
+
+    template<typename K, typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) {
+        return inserted(m_map.try_emplace(std::forward<K>(key), std::forward<Args>(args)...));
+    }
+    template<typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return inserted(m_map.emplace(std::forward<Args>(args)...));
+    }
+    std::pair<iterator, bool> insert(const value_type& v) {
+        return inserted(m_map.insert(v));
+    }
+    std::pair<iterator, bool> insert(value_type&& v) {
+        return inserted(m_map.insert(std::move(v)));
+    }
+    template<typename K, typename M>
+    std::pair<iterator, bool> insert_or_assign(K&& key, M&& m) {
+        return inserted(m_map.insert_or_assign(std::forward<K>(key), std::forward<M>(m)));
+    }
+
+    iterator erase(const_iterator it) {
+        drop_index();
+        return m_map.erase(it);
+    }
+    iterator erase(iterator it) {
+        drop_index();
+        return m_map.erase(it);
+    }
+    template<typename K, typename = std::enable_if_t<std::is_convertible_v<const K&, key_view_t>>>
+    size_type erase(const K& key) {
+        auto it = find(key);
+        if(it == end())
+            return 0;
+        drop_index();
+        m_map.erase(it);
+        return 1;
+    }
+    void clear() noexcept {
+        drop_index();
+        m_map.clear();
+    }
+
+    friend bool operator==(const indexed_map& a, const indexed_map& b) {
+        return a.m_map == b.m_map;
+    }
+    friend bool operator!=(const indexed_map& a, const indexed_map& b) {
+        return a.m_map != b.m_map;
+    }
+
+private:
+    const index_t* get_index() const {
+        if(const index_t* index = m_index.load(std::memory_order_acquire))
+            return index;
+        auto index = std::make_unique<index_t>(m_map.size());
+        for(auto it = m_map.begin(); it != m_map.end(); ++it)
+            index->insert(it, hash_string(key_view_t(it->first)));
+        index_t* expected = nullptr;
+        if(m_index.compare_exchange_strong(expected, index.get(), std::memory_order_acq_rel))
+            return index.release();
+        return expected;
+    }
+
+    // Keeps an existing index up to date, or drops it if it is full
+    std::pair<iterator, bool> inserted(std::pair<iterator, bool> res) {
+        if(res.second) {
+            if(index_t* index = m_index.load(std::memory_order_relaxed)) {
+                if(!index->insert(res.first, hash_string(key_view_t(res.first->first))))
+                    drop_index();
+            }
+        }
+        return res;
+    }
+
+    void drop_index() noexcept {
+        delete m_index.exchange(nullptr, std::memory_order_relaxed);
+    }
+
+    map_t m_map;
+    mutable std::atomic<index_t*> m_index{nullptr};
+};
+
+}    // namespace banshee::detail
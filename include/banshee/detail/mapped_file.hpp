@@ -0,0 +1,107 @@
+#pragma once
+#include <cerrno>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace banshee::detail {
+
+// A read only, shared memory mapping of a whole file.
+// Pages are only read from disk when first accessed, and processes mapping the same file
+// share the same physical pages.
+class mapped_file {
+public:
+    enum class access { sequential, random };
+
+    mapped_file() = default;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file(mapped_file&& other) noexcept :
+        m_data(std::exchange(other.m_data, nullptr)),
+        m_size(std::exchange(other.m_size, 0)) {}
+    mapped_file& operator=(mapped_file other) noexcept {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        return *this;
+    }
+    ~mapped_file() {
+        if(m_data)
+            ::munmap(const_cast<char*>(m_data), m_size);
+    }
+
+    bool open(const std::string& path, access a = access::sequential) noexcept {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0)
+            return false;
+        struct stat st;
+        if(::fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* p = ::mmap(nullptr, std::size_t(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED)
+            return false;
+        ::madvise(p, std::size_t(st.st_size),
+                  a == access::random ? MADV_RANDOM : MADV_SEQUENTIAL);
+        *this = mapped_file();
+        m_data = static_cast<const char*>(p);
+        m_size = std::size_t(st.st_size);
+        return true;
+    }
+
+    const char* data() const noexcept {
+        return m_data;
+    }
+    std::size_t size() const noexcept {
+        return m_size;
+    }
+    bool is_open() const noexcept {
+        return m_data != nullptr;
+    }
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+// Replaces the file at path by size bytes of data.
+// The data is written to path.tmp, flushed to disk, then renamed over path, and the rename
+// itself is flushed, so that after a crash path holds either the old or the new content,
+// never a partial one. Readers which have the old file mapped keep reading it.
+// If the data cannot be written, path is left untouched and path.tmp is removed.
+inline bool replace_file(const std::string& path, const char* data, std::size_t size) noexcept {
+    const std::string tmp = path + ".tmp";
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if(fd < 0)
+        return false;
+    bool ok = true;
+    while(ok && size > 0) {
+        const ssize_t n = ::write(fd, data, size);
+        if(n < 0 && errno == EINTR)
+            continue;
+        ok = n > 0;
+        if(ok) {
+            data += n;
+            size -= std::size_t(n);
+        }
+    }
+    ok = ok && ::fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+    if(!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        return false;
+    }
+    const auto slash = path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+    const int dir_fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dir_fd < 0)
+        return false;
+    ok = ::fsync(dir_fd) == 0;
+    ::close(dir_fd);
+    return ok;
+}
+
+}    // namespace banshee::detail
@@ -0,0 +1,306 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <variant>
+#include <vector>
+
+namespace banshee::detail {
+
+// A read only view of contiguous elements
+template<typename T>
+class span {
+public:
+    span() noexcept = default;
+    span(const T* data, std::size_t size) noexcept : m_data(data), m_size(size) {}
+
+    const T* data() const noexcept {
+        return m_data;
+    }
+    std::size_t size() const noexcept {
+        return m_size;
+    }
+    bool empty() const noexcept {
+        return m_size == 0;
+    }
+    const T* begin() const noexcept {
+        return m_data;
+    }
+    const T* end() const noexcept {
+        return m_data + m_size;
+    }
+    const T& operator[](std::size_t idx) const noexcept {
+        return m_data[idx];
+    }
+
+private:
+    const T* m_data = nullptr;
+    std::size_t m_size = 0;
+};
+
+// An array of properties which holds an array of only integers, or of only doubles, as a
+// packed int64_t[] or double[]: 8 bytes per element instead of a whole property.
+// The first element appended to an empty array picks the layout. Appending an element of
+// another type, or accessing the elements mutably, unpacks the array into a vector of
+// properties for good.
+// integers() and doubles() expose the packed elements, for vectorized math.
+// Const iterators make each packed element in the iterator itself: a reference obtained
+// from one is valid until the iterator is incremented. Const operator[] must return a
+// stable property, its first call on a packed array builds all the properties once, on the
+// side (this is thread safe, and forgotten as soon as the array is modified).
+template<typename Property>
+class packed_array {
+public:
+    using value_type = Property;
+    using size_type = std::size_t;
+    using iterator = typename std::vector<Property>::iterator;
+    class const_iterator;
+
+    enum class layout : std::uint8_t { generic, integers, doubles };
+
+    packed_array() noexcept = default;
+    packed_array(std::initializer_list<Property> il) {
+        reserve(il.size());
+        for(const auto& e : il)
+            push_back(e);
+    }
+    packed_array(const packed_array& other) : m_storage(other.m_storage) {}
+    packed_array(packed_array&& other) noexcept :
+        m_storage(std::move(other.m_storage)),
+        m_properties(other.m_properties.exchange(nullptr, std::memory_order_acq_rel)) {}
+    packed_array& operator=(const packed_array& other) {
+        if(this != &other) {
+            m_storage = other.m_storage;
+            forget_properties();
+        }
+        return *this;
+    }
+    packed_array& operator=(packed_array&& other) noexcept {
+        if(this != &other) {
+            m_storage = std::move(other.m_storage);
+            forget_properties();
+            m_properties.store(other.m_properties.exchange(nullptr, std::memory_order_acq_rel),
+                               std::memory_order_release);
+        }
+        return *this;
+    }
+    ~packed_array() {
+        forget_properties();
+    }
+
+    layout packing() const noexcept {
+        return layout(m_storage.index());
+    }
+    // The packed elements, empty unless the array has the matching layout
+    span<std::int64_t> integers() const noexcept {
+        const auto* integers = std::get_if<integers_index>(&m_storage);
+        return integers ? span<std::int64_t>(integers->data(), integers->size())
+                        : span<std::int64_t>();
+    }
+    span<double> doubles() const noexcept {
+        const auto* doubles = std::get_if<doubles_index>(&m_storage);
+        return doubles ? span<double>(doubles->data(), doubles->size()) : span<double>();
+    }
+
+    size_type size() const noexcept {
+        return std::visit([](const auto& v) { return v.size(); }, m_storage);
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+    void reserve(size_type n) {
+        std::visit([n](auto& v) { v.reserve(n); }, m_storage);
+    }
+    void clear() noexcept {
+        forget_properties();
+        m_storage.template emplace<generic_index>();
+    }
+
+    template<typename P>
+    void push_back(P&& p) {
+        forget_properties();
+        if(!push_packed(p))
+            generic().push_back(std::forward<P>(p));
+    }
+    template<typename... Args>
+    void emplace_back(Args&&... args) {
+        push_back(Property(std::forward<Args>(args)...));
+    }
+    template<typename... Args>
+    decltype(auto) insert(Args&&... args) {
+        return generic().insert(std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    decltype(auto) erase(Args&&... args) {
+        return generic().erase(std::forward<Args>(args)...);
+    }
+    template<typename... Args>
+    void resize(Args&&... args) {
+        generic().resize(std::forward<Args>(args)...);
+    }
+
+    const Property& operator[](size_type idx) const {
+        if(const auto* values = std::get_if<generic_index>(&m_storage))
+            return (*values)[idx];
+        return properties()[idx];
+    }
+    Property& operator[](size_type idx) {
+        return generic()[idx];
+    }
+
+    const_iterator begin() const noexcept {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const noexcept {
+        return const_iterator(this, size());
+    }
+    const_iterator cbegin() const noexcept {
+        return begin();
+    }
+    const_iterator cend() const noexcept {
+        return end();
+    }
+    iterator begin() {
+        return generic().begin();
+    }
+    iterator end() {
+        return generic().end();
+    }
+
+    friend bool operator==(const packed_array& a, const packed_array& b) {
+        if(a.m_storage.index() == b.m_storage.index())
+            return a.m_storage == b.m_storage;
+        return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+    }
+    friend bool operator!=(const packed_array& a, const packed_array& b) {
+        return !(a == b);
+    }
+
+    class const_iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Property;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Property*;
+        using reference = const Property&;
+
+        const_iterator() = default;
+
+        reference operator*() const {
+            switch(m_array->m_storage.index()) {
+                case integers_index:
+                    m_element = typename Property::integral_t(
+                        std::get<integers_index>(m_array->m_storage)[m_index]);
+                    return m_element;
+                case doubles_index:
+                    m_element = std::get<doubles_index>(m_array->m_storage)[m_index];
+                    return m_element;
+                default: return std::get<generic_index>(m_array->m_storage)[m_index];
+            }
+        }
+        pointer operator->() const {
+            return &**this;
+        }
+        const_iterator& operator++() noexcept {
+            ++m_index;
+            return *this;
+        }
+        const_iterator operator++(int) noexcept {
+            auto copy = *this;
+            ++m_index;
+            return copy;
+        }
+        friend bool operator==(const const_iterator& a, const const_iterator& b) noexcept {
+            return a.m_index == b.m_index;
+        }
+        friend bool operator!=(const const_iterator& a, const const_iterator& b) noexcept {
+            return a.m_index != b.m_index;
+        }
+
+    private:
+        friend class packed_array;
+        const_iterator(const packed_array* array, size_type index) noexcept :
+            m_array(array), m_index(index) {}
+
+        const packed_array* m_array = nullptr;
+        size_type m_index = 0;
+        mutable Property m_element;
+    };
+
+private:
+    enum : std::size_t { generic_index, integers_index, doubles_index };
+
+    // Appends p to the packed storage, unpacking the array if p does not fit
+    bool push_packed(const Property& p) {
+        constexpr bool pack_doubles = std::is_floating_point_v<typename Property::floating_t>;
+        if(auto* values = std::get_if<generic_index>(&m_storage)) {
+            if(!values->empty())
+                return false;
+            // The first element picks the layout, keeping the capacity reserved
+            const size_type capacity = values->capacity();
+            if(p.is_integral())
+                m_storage.template emplace<integers_index>().reserve(capacity);
+            else if(pack_doubles && p.is_double())
+                m_storage.template emplace<doubles_index>().reserve(capacity);
+            else
+                return false;
+        }
+        if(auto* integers = std::get_if<integers_index>(&m_storage)) {
+            if(p.is_integral()) {
+                integers->push_back(std::get<typename Property::integral_t>(p.value));
+                return true;
+            }
+        } else if constexpr(pack_doubles) {
+            if(p.is_double()) {
+                std::get<doubles_index>(m_storage).push_back(
+                    std::get<typename Property::floating_t>(p.value));
+                return true;
+            }
+        }
+        generic();
+        return false;
+    }
+
+    // Unpacks the array if needed
+    std::vector<Property>& generic() {
+        forget_properties();
+        if(m_storage.index() != generic_index) {
+            std::vector<Property> values;
+            values.reserve(size());
+            values.insert(values.end(), std::as_const(*this).begin(), std::as_const(*this).end());
+            m_storage = std::move(values);
+        }
+        return std::get<generic_index>(m_storage);
+    }
+
+    const std::vector<Property>& properties() const {
+        if(const auto* properties = m_properties.load(std::memory_order_acquire))
+            return *properties;
+        auto properties = std::make_unique<std::vector<Property>>(begin(), end());
+        std::vector<Property>* expected = nullptr;
+        if(m_properties.compare_exchange_strong(expected, properties.get(),
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire))
+            return *properties.release();
+        return *expected;
+    }
+    void forget_properties() noexcept {
+        delete m_properties.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    std::variant<std::vector<Property>, std::vector<std::int64_t>, std::vector<double>>
+        m_storage;
+    mutable std::atomic<std::vector<Property>*> m_properties{nullptr};
+};
+
+template<typename T>
+constexpr bool is_packed_array_v = false;
+template<typename Property>
+constexpr bool is_packed_array_v<packed_array<Property>> = true;
+
+}    // namespace banshee::detail
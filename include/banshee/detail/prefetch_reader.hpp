@@ -0,0 +1,360 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef BANSHEE_USE_IO_URING
+#include <deque>
+#include <liburing.h>
+#endif
+
+namespace banshee::detail {
+
+// A stream buffer whose first bytes can be read without consuming them, to sniff a byte
+// order mark or a compression format.
+class peekable_streambuf : public std::streambuf {
+public:
+    // Copies up to size bytes from the start of the stream without consuming them.
+    // Returns the number of bytes copied, which is less than size only for shorter streams.
+    std::size_t peek_prefix(char* out, std::size_t size) {
+        if(gptr() == egptr() && traits_type::eq_int_type(underflow(), traits_type::eof()))
+            return 0;
+        const std::size_t available = std::size_t(egptr() - gptr());
+        const std::size_t n = size < available ? size : available;
+        traits_type::copy(out, gptr(), n);
+        return n;
+    }
+    // Whether the stream ended early, on a read error or corrupt input. Only final once the
+    // end of the stream is reached.
+    virtual bool failed() const noexcept {
+        return false;
+    }
+};
+
+// A stream buffer reading a file ahead of its consumer.
+// A background thread fills a ring of large, page aligned buffers and publishes each one
+// once complete; the consumer reads them in place and hands them back when it moves to the
+// next one. The producer and the consumer each own one index of the ring, so passing
+// buffers involves no lock, only a condition variable when one side has to sleep.
+// When built with BANSHEE_USE_IO_URING and the file is seekable, several buffers are read at
+// once through io_uring, which helps with high latency storage.
+// Works with files that cannot be mapped or seeked, such as pipes. Read errors end the
+// stream early, see failed().
+// The destructor waits for the read in progress, which does not return on a pipe until data
+// is written or the pipe is closed.
+// It can also read ahead from another stream buffer, such as a decompress_streambuf, which
+// then does its work on the background thread.
+class prefetch_streambuf : public peekable_streambuf {
+public:
+    static constexpr std::size_t default_buffer_size = 1024 * 1024;
+    static constexpr std::size_t default_buffer_count = 4;
+
+    explicit prefetch_streambuf(const std::string& path,
+                                std::size_t buffer_size = default_buffer_size,
+                                std::size_t buffer_count = default_buffer_count) :
+        m_buffer_size((buffer_size + alignment - 1) / alignment * alignment),
+        m_slots(buffer_count < 2 ? 2 : buffer_count) {
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(m_fd < 0) {
+            m_failed = true;
+            return;
+        }
+        start();
+    }
+    // Source may have a bool failed() member, checked when it ends
+    template<typename Source>
+    explicit prefetch_streambuf(std::unique_ptr<Source> source,
+                                std::size_t buffer_size = default_buffer_size,
+                                std::size_t buffer_count = default_buffer_count) :
+        m_buffer_size((buffer_size + alignment - 1) / alignment * alignment),
+        m_slots(buffer_count < 2 ? 2 : buffer_count),
+        m_source(std::move(source)) {
+        if constexpr(has_failed<Source>::value) {
+            m_source_failed = [](std::streambuf& s) { return static_cast<Source&>(s).failed(); };
+        }
+        start();
+    }
+    prefetch_streambuf(const prefetch_streambuf&) = delete;
+    prefetch_streambuf& operator=(const prefetch_streambuf&) = delete;
+
+    ~prefetch_streambuf() override {
+        if(m_producer.joinable()) {
+            m_stop.store(true);
+            notify();
+            m_producer.join();
+        }
+        if(m_fd >= 0)
+            ::close(m_fd);
+    }
+
+    // Whether the file could not be opened or read, or the source failed
+    bool failed() const noexcept override {
+        return m_failed.load(std::memory_order_acquire);
+    }
+
+protected:
+    int_type underflow() override {
+        if(gptr() < egptr())
+            return traits_type::to_int_type(*gptr());
+        const std::uint64_t tail = m_tail.load(std::memory_order_relaxed);
+        // Hand the buffer just consumed back to the producer
+        if(eback()) {
+            setg(nullptr, nullptr, nullptr);
+            m_tail.store(tail + 1);
+            notify();
+            return underflow();
+        }
+        if(m_ended)
+            return traits_type::eof();
+        if(!m_producer.joinable())
+            return end();
+        wait([&] { return m_head.load() != tail; });
+        const slot& s = m_slots[tail % m_slots.size()];
+        // An empty buffer marks the end of the stream
+        if(s.size == 0)
+            return end();
+        setg(s.data.get(), s.data.get(), s.data.get() + s.size);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    static constexpr std::size_t alignment = 4096;
+
+    struct free_deleter {
+        void operator()(char* p) const noexcept {
+            std::free(p);
+        }
+    };
+    struct slot {
+        std::unique_ptr<char, free_deleter> data;
+        std::size_t size = 0;
+    };
+
+    template<typename T, typename = void>
+    struct has_failed : std::false_type {};
+    template<typename T>
+    struct has_failed<T, std::void_t<decltype(std::declval<const T&>().failed())>>
+        : std::true_type {};
+
+    void start() {
+        for(auto& slot : m_slots) {
+            slot.data.reset(static_cast<char*>(std::aligned_alloc(alignment, m_buffer_size)));
+            if(!slot.data) {
+                m_failed = true;
+                return;
+            }
+        }
+        m_producer = std::thread([this] { produce(); });
+    }
+
+    int_type end() {
+        m_ended = true;
+        return traits_type::eof();
+    }
+
+    // Both sides only sleep after announcing it, so that the other side takes the lock to wake
+    // them up only when needed.
+    template<typename Predicate>
+    void wait(Predicate ready) {
+        if(ready())
+            return;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_sleepers.fetch_add(1);
+        m_cv.wait(lock, ready);
+        m_sleepers.fetch_sub(1);
+    }
+    void notify() {
+        if(m_sleepers.load() == 0)
+            return;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_cv.notify_all();
+    }
+
+    // Waits for a free buffer, returns false when asked to stop
+    bool acquire(std::uint64_t head) {
+        wait([&] { return head - m_tail.load() < m_slots.size() || m_stop.load(); });
+        return !m_stop.load();
+    }
+    void publish(std::uint64_t head) {
+        m_head.store(head + 1);
+        notify();
+    }
+    void publish_end(std::uint64_t head, bool failed) {
+        if(failed)
+            m_failed.store(true, std::memory_order_release);
+        if(!acquire(head))
+            return;
+        m_slots[head % m_slots.size()].size = 0;
+        publish(head);
+    }
+
+    // Fills the buffer as much as possible, returns false on error
+    bool fill(slot& s) {
+        s.size = 0;
+        if(m_source) {
+            while(s.size < m_buffer_size) {
+                const std::streamsize n = m_source->sgetn(s.data.get() + s.size,
+                                                          std::streamsize(m_buffer_size - s.size));
+                if(n <= 0)
+                    break;
+                s.size += std::size_t(n);
+            }
+            // What was read before a failure is still delivered
+            return s.size || !m_source_failed || !m_source_failed(*m_source);
+        }
+        while(s.size < m_buffer_size) {
+            const ssize_t n = ::read(m_fd, s.data.get() + s.size, m_buffer_size - s.size);
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(n < 0)
+                return false;
+            if(n == 0)
+                break;
+            s.size += std::size_t(n);
+        }
+        return true;
+    }
+
+    void produce() {
+#ifdef BANSHEE_USE_IO_URING
+        if(m_fd >= 0 && ::lseek(m_fd, 0, SEEK_CUR) >= 0 && produce_uring())
+            return;
+#endif
+        for(std::uint64_t head = 0;; head++) {
+            if(!acquire(head))
+                return;
+            slot& s = m_slots[head % m_slots.size()];
+            if(!fill(s))
+                return publish_end(head, true);
+            if(s.size == 0)
+                return publish_end(head, false);
+            publish(head);
+        }
+    }
+
+#ifdef BANSHEE_USE_IO_URING
+    struct pending_read {
+        std::uint64_t index;
+        std::size_t size = 0;
+        bool complete = false;
+    };
+
+    void submit_read(io_uring& ring, pending_read& r) {
+        io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+        slot& s = m_slots[r.index % m_slots.size()];
+        io_uring_prep_read(sqe, m_fd, s.data.get() + r.size, unsigned(m_buffer_size - r.size),
+                           r.index * m_buffer_size + r.size);
+        io_uring_sqe_set_data(sqe, &r);
+    }
+
+    // Keeps a read in flight for every free buffer, and publishes them in order as they
+    // complete. Returns false, before reading anything, when io_uring is not available.
+    bool produce_uring() {
+        io_uring ring;
+        if(io_uring_queue_init(unsigned(m_slots.size()), &ring, 0) != 0)
+            return false;
+        std::deque<pending_read> reads;
+        std::uint64_t head = 0, next = 0;
+        std::size_t in_flight = 0;
+        bool end = false, failed = false;
+        while(!end && !m_stop.load()) {
+            std::size_t queued = 0;
+            for(; next - m_tail.load() < m_slots.size(); next++, queued++) {
+                reads.push_back(pending_read{next});
+                submit_read(ring, reads.back());
+            }
+            in_flight += queued;
+            if(queued && io_uring_submit(&ring) < 0) {
+                in_flight -= queued;
+                failed = true;
+                break;
+            }
+            if(reads.empty()) {
+                // All the buffers are waiting to be consumed
+                acquire(next);
+                continue;
+            }
+            io_uring_cqe* cqe;
+            const int ret = io_uring_wait_cqe(&ring, &cqe);
+            if(ret == -EINTR)
+                continue;
+            if(ret < 0) {
+                failed = true;
+                break;
+            }
+            auto* r = static_cast<pending_read*>(io_uring_cqe_get_data(cqe));
+            const int res = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            if(res < 0 && res != -EINTR && res != -EAGAIN) {
+                r->complete = true;
+                in_flight--;
+                failed = true;
+                break;
+            }
+            if(res > 0)
+                r->size += std::size_t(res);
+            // Short reads are continued until the buffer is full or the end is reached
+            if(res != 0 && r->size < m_buffer_size) {
+                submit_read(ring, *r);
+                io_uring_submit(&ring);
+                continue;
+            }
+            r->complete = true;
+            in_flight--;
+            for(; !reads.empty() && reads.front().complete; reads.pop_front()) {
+                // Reads past the end of the file complete empty
+                if(reads.front().size == 0) {
+                    end = true;
+                    break;
+                }
+                m_slots[head % m_slots.size()].size = reads.front().size;
+                publish(head++);
+            }
+        }
+        // The reads still in flight write to the buffers, they must complete first
+        while(in_flight) {
+            io_uring_cqe* cqe;
+            const int ret = io_uring_wait_cqe(&ring, &cqe);
+            if(ret == -EINTR)
+                continue;
+            if(ret < 0)
+                break;
+            io_uring_cqe_seen(&ring, cqe);
+            in_flight--;
+        }
+        io_uring_queue_exit(&ring);
+        if(!m_stop.load())
+            publish_end(head, failed);
+        return true;
+    }
+#endif
+
+    std::size_t m_buffer_size;
+    std::vector<slot> m_slots;
+    int m_fd = -1;
+    std::unique_ptr<std::streambuf> m_source;
+    bool (*m_source_failed)(std::streambuf&) = nullptr;
+    std::thread m_producer;
+    // Buffers [m_tail, m_head) are filled, the consumer reads buffer m_tail
+    std::atomic<std::uint64_t> m_head{0};
+    std::atomic<std::uint64_t> m_tail{0};
+    std::atomic<bool> m_stop{false};
+    std::atomic<bool> m_failed{false};
+    std::atomic<int> m_sleepers{0};
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_ended = false;
+};
+
+}    // namespace banshee::detail
@@ -0,0 +1,141 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace banshee::detail {
+
+// An immutable, reference counted string: copies share the same characters.
+// It is the string type of shared properties, so that basic_value_pool can store equal
+// strings once. Strings are built as std::basic_string (the lexers use a plain buffer) and
+// then moved in; the few modifying functions copy the characters if they are shared.
+// Reads go through a basic_string_view, which shared_string converts to implicitly.
+template<typename CharT>
+class shared_string {
+public:
+    using value_type = CharT;
+    using size_type = std::size_t;
+    using string_type = std::basic_string<CharT>;
+    using view_type = std::basic_string_view<CharT>;
+    using const_iterator = typename view_type::const_iterator;
+    using iterator = const_iterator;
+
+private:
+    template<typename T>
+    using if_view = std::enable_if_t<std::is_convertible_v<const T&, view_type> &&
+                                     !std::is_same_v<T, shared_string>>;
+
+public:
+
+    shared_string() noexcept = default;
+    shared_string(const CharT* s) : shared_string(view_type(s)) {}
+    shared_string(const string_type& s) : shared_string(view_type(s)) {}
+    shared_string(string_type&& s) {
+        if(!s.empty())
+            m_ptr = std::make_shared<const string_type>(std::move(s));
+    }
+    explicit shared_string(view_type s) {
+        if(!s.empty())
+            m_ptr = std::make_shared<const string_type>(s);
+    }
+
+    operator view_type() const noexcept {
+        return view();
+    }
+    view_type view() const noexcept {
+        return m_ptr ? view_type(*m_ptr) : view_type();
+    }
+    const string_type& str() const noexcept {
+        return m_ptr ? *m_ptr : empty_string();
+    }
+    const CharT* c_str() const noexcept {
+        return str().c_str();
+    }
+    const CharT* data() const noexcept {
+        return str().data();
+    }
+    size_type size() const noexcept {
+        return m_ptr ? m_ptr->size() : 0;
+    }
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+    const_iterator begin() const noexcept {
+        return view().begin();
+    }
+    const_iterator end() const noexcept {
+        return view().end();
+    }
+    CharT operator[](size_type i) const noexcept {
+        return (*m_ptr)[i];
+    }
+    int compare(view_type other) const noexcept {
+        return view().compare(other);
+    }
+
+    // Whether other copies share the characters
+    bool is_shared() const noexcept {
+        return m_ptr && m_ptr.use_count() > 1;
+    }
+    const void* identity() const noexcept {
+        return m_ptr.get();
+    }
+
+    shared_string& operator+=(view_type s) {
+        if(!s.empty()) {
+            string_type next;
+            next.reserve(size() + s.size());
+            next.append(view()).append(s);
+            m_ptr = std::make_shared<const string_type>(std::move(next));
+        }
+        return *this;
+    }
+    void clear() noexcept {
+        m_ptr.reset();
+    }
+
+    friend bool operator==(const shared_string& a, const shared_string& b) noexcept {
+        return a.m_ptr == b.m_ptr || a.view() == b.view();
+    }
+    friend bool operator!=(const shared_string& a, const shared_string& b) noexcept {
+        return !(a == b);
+    }
+    friend bool operator<(const shared_string& a, const shared_string& b) noexcept {
+        return a.view() < b.view();
+    }
+    // Comparisons with anything else convertible to a view, such as string literals
+    template<typename T, typename = if_view<T>>
+    friend bool operator==(const shared_string& a, const T& b) noexcept {
+        return a.view() == view_type(b);
+    }
+    template<typename T, typename = if_view<T>>
+    friend bool operator!=(const shared_string& a, const T& b) noexcept {
+        return a.view() != view_type(b);
+    }
+    template<typename T, typename = if_view<T>>
+    friend bool operator<(const shared_string& a, const T& b) noexcept {
+        return a.view() < view_type(b);
+    }
+    template<typename T, typename = if_view<T>>
+    friend bool operator<(const T& a, const shared_string& b) noexcept {
+        return view_type(a) < b.view();
+    }
+
+    friend std::basic_ostream<CharT>& operator<<(std::basic_ostream<CharT>& os,
+                                                 const shared_string& s) {
+        return os << s.view();
+    }
+
+private:
+    static const string_type& empty_string() noexcept {
+        static const string_type empty;
+        return empty;
+    }
+
+    std::shared_ptr<const string_type> m_ptr;
+};
+
+}    // namespace banshee::detail
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <banshee/detail/hash.hpp>
+#include <banshee/detail/util.hpp>
+
+namespace banshee::detail {
+
+// Structural hashes of property trees: equal properties have equal hashes.
+// Hashes of arrays and objects are never 0, so 0 can mean "unknown" in caches.
+
+template<typename T, typename = void>
+struct has_cached_hash : std::false_type {};
+template<typename T>
+struct has_cached_hash<T, std::void_t<decltype(std::declval<const T&>().cached_hash())>>
+    : std::true_type {};
+
+enum : std::uint64_t {
+    hash_seed_null = 0x9E3779B97F4A7C15ull,
+    hash_seed_bool = 0xC2B2AE3D27D4EB4Full,
+    hash_seed_integral = 0x165667B19E3779F9ull,
+    hash_seed_floating = 0x27D4EB2F165667C5ull,
+    hash_seed_string = 0x85EBCA77C2B2AE63ull,
+    hash_seed_array = 0xFF51AFD7ED558CCDull,
+    hash_seed_object = 0xC4CEB9FE1A85EC53ull,
+};
+
+inline std::uint64_t hash_scalar_mix(std::uint64_t seed, std::uint64_t v) noexcept {
+    return hash_mix(v ^ seed, 0xA0761D6478BD642Full);
+}
+
+template<typename Property>
+std::uint64_t hash_scalar(const Property& p) {
+    return std::visit(
+        overloaded{
+            [](const std::monostate&) -> std::uint64_t { return hash_seed_null; },
+            [](const typename Property::bool_t& b) -> std::uint64_t {
+                return hash_scalar_mix(hash_seed_bool, b ? 1 : 0);
+            },
+            [](const typename Property::integral_t& i) -> std::uint64_t {
+                return hash_scalar_mix(hash_seed_integral, std::uint64_t(i));
+            },
+            [](const typename Property::floating_t& f) -> std::uint64_t {
+                // 0.0 == -0.0
+                const double d = f == 0 ? 0.0 : double(f);
+                std::uint64_t bits;
+                std::memcpy(&bits, &d, sizeof(bits));
+                return hash_scalar_mix(hash_seed_floating, bits);
+            },
+            [](const typename Property::string_t& s) -> std::uint64_t {
+                return hash_string(s, hash_seed_string);
+            },
+            [](const auto&) -> std::uint64_t { return 0; },
+        },
+        p.value);
+}
+
+// The hash cached in the container of p, or 0
+template<typename Property>
+std::uint64_t cached_hash(const Property& p) noexcept {
+    using array_t = typename Property::array_t;
+    using object_t = typename Property::object_t;
+    if constexpr(has_cached_hash<array_t>::value) {
+        if(const auto* array = std::get_if<array_t>(&p.value))
+            return array->cached_hash();
+    }
+    if constexpr(has_cached_hash<object_t>::value) {
+        if(const auto* object = std::get_if<object_t>(&p.value))
+            return object->cached_hash();
+    }
+    return 0;
+}
+
+// Hash of an array or an object, hashing its children with child_hash
+template<typename Property, typename ChildHash>
+std::uint64_t hash_container(const Property& p, ChildHash&& child_hash) {
+    std::uint64_t h;
+    if(p.is_array()) {
+        h = hash_seed_array;
+        for(const auto& e : std::get<typename Property::array_t>(p.value))
+            h = hash_mix(h ^ child_hash(e), hash_seed_array);
+    } else {
+        h = hash_seed_object;
+        for(const auto& member : std::get<typename Property::object_t>(p.value)) {
+            h = hash_mix(h ^ hash_string(member.first, hash_seed_string),
+                         child_hash(member.second) ^ hash_seed_object);
+        }
+    }
+    return h ? h : 1;
+}
+
+// Hash of p, using the hashes cached in shared containers
+template<typename Property>
+std::uint64_t hash_value(const Property& p) {
+    if(!p.is_array() && !p.is_object())
+        return hash_scalar(p);
+    if(const std::uint64_t h = cached_hash(p))
+        return h;
+    return hash_container(p, [](const Property& child) { return hash_value(child); });
+}
+
+// Memoizes the hashes of the arrays and objects it visits by address, so asking for the hash
+// of a subtree whose parent was already hashed is a lookup. The trees must not be modified
+// while the hasher is alive.
+template<typename Property>
+class subtree_hasher {
+public:
+    std::uint64_t operator()(const Property& p) {
+        if(!p.is_array() && !p.is_object())
+            return hash_scalar(p);
+        if(const std::uint64_t h = cached_hash(p))
+            return h;
+        auto it = m_cache.find(&p);
+        if(it != m_cache.end())
+            return it->second;
+        const std::uint64_t h = hash_container(p, *this);
+        m_cache.emplace(&p, h);
+        return h;
+    }
+
+    // Whether a and b are equal. Different hashes answer in constant time,
+    // equal hashes are confirmed by a deep comparison.
+    bool same(const Property& a, const Property& b) {
+        return &a == &b || ((*this)(a) == (*this)(b) && a == b);
+    }
+
+private:
+    std::unordered_map<const Property*, std::uint64_t> m_cache;
+};
+
+}    // namespace banshee::detail
@@ -0,0 +1,71 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace banshee::detail {
+
+// A fixed set of threads running tasks in submission order.
+// A task waiting for the result of another one may wait forever if all the threads are busy:
+// callers should be able to run the other task themselves, see basic_ici_loader. With no
+// threads, submitted tasks never run.
+class thread_pool {
+public:
+    explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency()) {
+        m_threads.reserve(threads);
+        for(std::size_t i = 0; i < threads; i++)
+            m_threads.emplace_back([this] { run(); });
+    }
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    // Tasks still queued are discarded
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+            m_tasks.clear();
+        }
+        m_cv.notify_all();
+        for(auto& t : m_threads)
+            t.join();
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_tasks.push_back(std::move(task));
+        }
+        m_cv.notify_one();
+    }
+
+    std::size_t size() const noexcept {
+        return m_threads.size();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for(;;) {
+            m_cv.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+            if(m_stop)
+                return;
+            auto task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+            lock.unlock();
+            task();
+            lock.lock();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    std::vector<std::thread> m_threads;
+    bool m_stop = false;
+};
+
+}    // namespace banshee::detail
@@ -0,0 +1,238 @@
+#pragma once
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <banshee/binary/binary_reader.hpp>
+#include <banshee/binary/binary_writer.hpp>
+#include <banshee/detail/mapped_file.hpp>
+
+namespace banshee {
+
+// Read only access to a binary snapshot, with the same query interface as basic_property.
+// A document_view does not own any memory: it points into a mapped_document (or any buffer
+// holding a snapshot), which must outlive it. Lookups never copy or allocate, and only touch
+// the pages holding the values they traverse.
+class document_view {
+public:
+    using integral_t = std::int64_t;
+    using floating_t = double;
+    using string_t = std::string_view;
+    using key_t = std::string_view;
+
+    class iterator;
+    class member_iterator;
+    struct members_range;
+
+    document_view() = default;
+    explicit document_view(binary_value v) noexcept : m_value(v) {}
+
+    bool is_null() const noexcept {
+        return m_value.is_null();
+    }
+    bool is_boolean() const noexcept {
+        return m_value.is_boolean();
+    }
+    bool is_integral() const noexcept {
+        return m_value.is_integral();
+    }
+    bool is_double() const noexcept {
+        return m_value.is_double();
+    }
+    bool is_number() const noexcept {
+        return m_value.is_number();
+    }
+    bool is_string() const noexcept {
+        return m_value.is_string();
+    }
+    bool is_array() const noexcept {
+        return m_value.is_array();
+    }
+    bool is_object() const noexcept {
+        return m_value.is_object();
+    }
+    bool is_empty() const noexcept {
+        return is_null() || ((is_array() || is_object()) && size() == 0);
+    }
+
+    std::size_t size() const noexcept {
+        return m_value.size();
+    }
+
+    // Missing elements and members are null
+    document_view operator[](std::size_t idx) const noexcept {
+        return document_view(m_value[idx]);
+    }
+    document_view operator[](key_t key) const noexcept {
+        return document_view(m_value[key]);
+    }
+    std::optional<document_view> find(key_t key) const noexcept {
+        if(auto idx = m_value.find(key))
+            return document_view(m_value.value(*idx));
+        return {};
+    }
+
+    explicit operator bool() const noexcept {
+        return bool(m_value);
+    }
+    template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>,
+                                          int> = 0>
+    explicit operator T() const noexcept {
+        return T(m_value.as_integral());
+    }
+    template<typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    explicit operator T() const noexcept {
+        return T(m_value.as_double());
+    }
+    explicit operator string_t() const noexcept {
+        return m_value.as_string();
+    }
+
+    // Iterates over the elements of an array or the values of an object
+    iterator begin() const noexcept;
+    iterator end() const noexcept;
+    // Iterates over the (key, value) pairs of an object
+    members_range members() const noexcept;
+
+    template<typename Property>
+    Property to_property() const {
+        return m_value.to_property<Property>();
+    }
+
+    binary_value value() const noexcept {
+        return m_value;
+    }
+
+private:
+    binary_value m_value;
+};
+
+class document_view::iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = document_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = document_view;
+
+    iterator() = default;
+    iterator(binary_value parent, std::size_t idx) noexcept : m_parent(parent), m_idx(idx) {}
+
+    document_view operator*() const noexcept {
+        return document_view(m_parent.is_object() ? m_parent.value(m_idx) : m_parent[m_idx]);
+    }
+    iterator& operator++() noexcept {
+        ++m_idx;
+        return *this;
+    }
+    iterator operator++(int) noexcept {
+        return iterator(m_parent, m_idx++);
+    }
+    bool operator==(const iterator& other) const noexcept {
+        return m_idx == other.m_idx;
+    }
+    bool operator!=(const iterator& other) const noexcept {
+        return m_idx != other.m_idx;
+    }
+
+private:
+    binary_value m_parent;
+    std::size_t m_idx = 0;
+};
+
+class document_view::member_iterator {
+public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::pair<key_t, document_view>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = value_type;
+
+    member_iterator() = default;
+    member_iterator(binary_value parent, std::size_t idx) noexcept :
+        m_parent(parent),
+        m_idx(idx) {}
+
+    value_type operator*() const noexcept {
+        return {m_parent.key(m_idx), document_view(m_parent.value(m_idx))};
+    }
+    member_iterator& operator++() noexcept {
+        ++m_idx;
+        return *this;
+    }
+    member_iterator operator++(int) noexcept {
+        return member_iterator(m_parent, m_idx++);
+    }
+    bool operator==(const member_iterator& other) const noexcept {
+        return m_idx == other.m_idx;
+    }
+    bool operator!=(const member_iterator& other) const noexcept {
+        return m_idx != other.m_idx;
+    }
+
+private:
+    binary_value m_parent;
+    std::size_t m_idx = 0;
+};
+
+struct document_view::members_range {
+    member_iterator first, last;
+    member_iterator begin() const noexcept {
+        return first;
+    }
+    member_iterator end() const noexcept {
+        return last;
+    }
+};
+
+inline auto document_view::begin() const noexcept -> iterator {
+    return iterator(m_value, 0);
+}
+
+inline auto document_view::end() const noexcept -> iterator {
+    return iterator(m_value, (is_array() || is_object()) ? size() : 0);
+}
+
+inline auto document_view::members() const noexcept -> members_range {
+    return {member_iterator(m_value, 0), member_iterator(m_value, is_object() ? size() : 0)};
+}
+
+// A binary snapshot mapped from disk
+class mapped_document {
+public:
+    static std::optional<mapped_document> open(const std::string& path) {
+        mapped_document doc;
+        if(!doc.m_file.open(path, detail::mapped_file::access::random))
+            return {};
+        auto root = read_binary(doc.m_file.data(), doc.m_file.size());
+        if(!root)
+            return {};
+        doc.m_root = *root;
+        return doc;
+    }
+
+    document_view root() const noexcept {
+        return document_view(m_root);
+    }
+
+private:
+    mapped_document() = default;
+    detail::mapped_file m_file;
+    binary_value m_root;
+};
+
+// Writes a snapshot of p to path.
+// The file is written next to path, flushed to disk then renamed, so processes that have the
+// previous version mapped keep reading consistent data, and a crash never leaves a partial
+// snapshot behind. Returns false if the snapshot could not be written or made durable.
+template<typename types>
+bool save_document(const std::string& path, const basic_property<types>& p) {
+    binary_writer writer;
+    if(!writer.write(p))
+        return false;
+    return detail::replace_file(path, writer.buffer().data(), writer.buffer().size());
+}
+
+}    // namespace banshee
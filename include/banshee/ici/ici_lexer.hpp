@@ -0,0 +1,309 @@
+#pragma once
+#include <banshee/lexer.hpp>
+#include <banshee/property.hpp>
+namespace banshee {
+
+namespace detail {
+
+    template<typename property_type = banshee::property>
+    struct ici_token {
+        enum TokenKind {
+            tok_eof = 0,
+            tok_invalid,
+            tok_id,
+            tok_lparen,
+            tok_rparen,
+            tok_lbrace,
+            tok_rbrace,
+            tok_lsquare,
+            tok_rsquare,
+            tok_string,
+            tok_double,
+            tok_integer,
+            tok_colon,
+            tok_dot,
+            tok_comma,
+            tok_equal,
+            tok_star_equal,
+            tok_minus_equal,
+            tok_plus_equal,
+            tok_for,
+            tok_if,
+            tok_else,
+            tok_unset,
+            tok_reserved,
+            tok_true,
+            tok_false,
+            tok_null,
+            tok_and,
+            tok_or,
+            tok_include,
+        };
+        static constexpr const char* token_names[] = {
+            "eof",        "invalid",    "id",          "lparen",     "rparen",  "lbrace",
+            "rbrace",     "lsquare",    "rsquare",     "string",     "double",  "integer",
+            "colon",      "dot",        "comma",       "equal",      "star_equal",
+            "minus_equal", "plus_equal", "for",        "if",         "else",    "unset",
+            "reserved",   "true",       "false",       "null",       "and",     "or",
+            "include"};
+        // Strings also accept the escape sequences of ici_escape_table and \0
+        static constexpr bool extended_escapes = true;
+
+        using property_t = property_type;
+        using string_t = typename property_type::string_t;
+        using integral_t = typename property_type::integral_t;
+        using floating_t = typename property_type::floating_t;
+        using char_type = typename string_t::value_type;
+
+        TokenKind kind = TokenKind::tok_invalid;
+        // The name of identifiers, the value of strings and numbers
+        std::variant<integral_t, floating_t, string_t> value;
+        // Offset of the first character of the token, see lexer_base_view::position
+        std::size_t offset = 0;
+        explicit operator bool() const {
+            return kind != TokenKind::tok_eof && kind != TokenKind::tok_invalid;
+        }
+        operator TokenKind() const {
+            return kind;
+        }
+        auto as_integer() const {
+            return std::get<integral_t>(value);
+        }
+
+        auto as_double() const {
+            return std::get<floating_t>(value);
+        }
+
+        const auto& as_string() const {
+            return std::get<string_t>(value);
+        }
+    };
+    template<typename property_type>
+    std::ostream& operator<<(std::ostream& os, const ici_token<property_type>& tok) {
+        os << ici_token<property_type>::token_names[tok.kind] << " : " << tok.offset;
+        return os;
+    }
+    template<typename property_type>
+    bool is_eof_token(const ici_token<property_type>& t) {
+        return t.kind == ici_token<property_type>::tok_eof;
+    }
+
+    // Returns the keyword spelled by [s, s + size), or tok_id.
+    // Keywords are told apart by their length and first character, so at most one comparison
+    // is made.
+    template<typename TokenKind>
+    constexpr TokenKind ici_keyword(const char* s, std::size_t size) noexcept {
+        auto is = [&](const char* keyword, TokenKind kind) {
+            for(std::size_t i = 1; i < size; i++) {
+                if(s[i] != keyword[i])
+                    return TokenKind::tok_id;
+            }
+            return kind;
+        };
+        switch(size) {
+            case 2:
+                switch(s[0]) {
+                    case 'i': return is("if", TokenKind::tok_if);
+                    case 'o': return is("or", TokenKind::tok_or);
+                }
+                break;
+            case 3:
+                if(s[0] == 'a')
+                    return is("and", TokenKind::tok_and);
+                break;
+            case 4:
+                switch(s[0]) {
+                    case 'e': return is("else", TokenKind::tok_else);
+                    case 't': return is("true", TokenKind::tok_true);
+                    case 'n': return is("null", TokenKind::tok_null);
+                }
+                break;
+            case 5:
+                switch(s[0]) {
+                    case 'u': return is("unset", TokenKind::tok_unset);
+                    case 'f': return is("false", TokenKind::tok_false);
+                    case 'l': return is("local", TokenKind::tok_reserved);
+                }
+                break;
+            case 7:
+                switch(s[0]) {
+                    case 'f': return is("foreach", TokenKind::tok_for);
+                    case 'i': return is("include", TokenKind::tok_include);
+                }
+                break;
+        }
+        return TokenKind::tok_id;
+    }
+
+    constexpr bool is_ici_identifier_start(char32_t c) noexcept {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c > 0x7F;
+    }
+    constexpr bool is_ici_identifier_char(char32_t c) noexcept {
+        return is_ici_identifier_start(c) || (c >= '0' && c <= '9');
+    }
+
+}    // namespace detail
+
+// Tokens of ICI configuration files.
+// Strings are quoted with ' or ", or with """ for long strings spanning several lines.
+// Comments start with # and run to the end of the line. Identifiers may contain non ascii
+// characters.
+template<typename Rng, typename PropertyType = banshee::property,
+         CONCEPT_REQUIRES_(cedilla::detail::concepts::CodepointInputRange<Rng>())>
+class ici_token_view : public lexer_base_view<Rng, ici_token_view<Rng, PropertyType>,
+                                              detail::ici_token<PropertyType>, PropertyType> {
+
+    using base = lexer_base_view<Rng, ici_token_view<Rng, PropertyType>,
+                                 detail::ici_token<PropertyType>, PropertyType>;
+    using token_t = typename base::token_t;
+    using TokenKind = typename base::TokenKind;
+
+
+public:
+    ici_token_view(Rng&& rng) : base(std::forward<Rng>(rng)) {}
+    typename base::token_stream_t token_stream() {
+        while(!this->at_end()) {
+            const std::size_t offset = this->offset();
+            typename base::codepoint c = this->getchar();
+            switch(c) {
+                case '{': co_yield this->make_token(TokenKind::tok_lbrace, offset); break;
+                case '}': co_yield this->make_token(TokenKind::tok_rbrace, offset); break;
+                case '[': co_yield this->make_token(TokenKind::tok_lsquare, offset); break;
+                case ']': co_yield this->make_token(TokenKind::tok_rsquare, offset); break;
+                case '(': co_yield this->make_token(TokenKind::tok_lparen, offset); break;
+                case ')': co_yield this->make_token(TokenKind::tok_rparen, offset); break;
+                case '=': co_yield this->make_token(TokenKind::tok_equal, offset); break;
+                case ':': co_yield this->make_token(TokenKind::tok_colon, offset); break;
+                case '.': co_yield this->make_token(TokenKind::tok_dot, offset); break;
+                case ',': co_yield this->make_token(TokenKind::tok_comma, offset); break;
+                case '*':
+                case '+':
+                    if(this->peekchar() != '=') {
+                        co_yield this->make_token(TokenKind::tok_invalid, offset);
+                        co_return;
+                    }
+                    this->getchar();
+                    co_yield this->make_token(
+                        c == '*' ? TokenKind::tok_star_equal : TokenKind::tok_plus_equal, offset);
+                    break;
+
+                case '\t':
+                case '\f':
+                case '\r':
+                case '\n':
+                case ' ': break;
+                case '#':
+                    while(!this->at_end() && this->peekchar() != '\n')
+                        this->getchar();
+                    break;
+                case '"':
+                case '\'': {
+                    const bool long_string =
+                        c == '"' && this->peekchar(1) == '"' && this->peekchar(2) == '"';
+                    if(long_string) {
+                        this->getchar();
+                        this->getchar();
+                    }
+                    typename base::buffer_t str;
+                    if(!this->parse_string(str, c, long_string)) {
+                        co_yield this->make_token(TokenKind::tok_invalid, offset);
+                        co_return;
+                    }
+                    co_yield this->make_token(TokenKind::tok_string, std::move(str), offset);
+                    break;
+                }
+                case '-':
+                    if(this->peekchar() == '=') {
+                        this->getchar();
+                        co_yield this->make_token(TokenKind::tok_minus_equal, offset);
+                        break;
+                    }
+                    [[fallthrough]];
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9': {
+                    typename base::integral_t i;
+                    typename base::floating_t d;
+                    switch(this->parse_number(i, d, c)) {
+                        case detail::number_kind::integral:
+                            co_yield this->make_token(TokenKind::tok_integer, std::move(i), offset);
+                            break;
+                        case detail::number_kind::floating:
+                            co_yield this->make_token(TokenKind::tok_double, std::move(d), offset);
+                            break;
+                        case detail::number_kind::invalid:
+                            co_yield this->make_token(TokenKind::tok_invalid, offset);
+                            co_return;
+                    }
+                    break;
+                }
+                default: {
+                    if(!detail::is_ici_identifier_start(c)) {
+                        co_yield this->make_token(TokenKind::tok_invalid, offset);
+                        co_return;
+                    }
+                    typename base::buffer_t name;
+                    const TokenKind kind = read_identifier(name, c);
+                    if(kind == TokenKind::tok_id)
+                        co_yield this->make_token(kind, std::move(name), offset);
+                    else
+                        co_yield this->make_token(kind, offset);
+                    break;
+                }
+            }    // switch
+        }        // while
+        // A source which ended early may still look like a complete document
+        if(this->source_failed()) {
+            co_yield this->make_token(TokenKind::tok_invalid, this->offset());
+            co_return;
+        }
+        co_yield this->make_token(TokenKind::tok_eof, this->offset());
+    }
+
+private:
+    // Reads the rest of an identifier into a local buffer which is appended to name in bulk.
+    // Keywords are recognized before anything is appended, so they cost no allocation.
+    TokenKind read_identifier(typename base::buffer_t& name, typename base::codepoint c) {
+        constexpr std::size_t run_size = 64;
+        char run[run_size];
+        std::size_t size = 0;
+        bool ascii = true;
+        for(;;) {
+            if(c < 0x80) {
+                run[size++] = char(c);
+            } else if constexpr(sizeof(typename token_t::char_type) == 1) {
+                size += banshee::encode_utf8(run + size, c);
+                ascii = false;
+            } else {
+                name.append(run, run + size);
+                size = 0;
+                banshee::push_back(name, c);
+                ascii = false;
+            }
+            if(this->at_end() || !detail::is_ici_identifier_char(this->peekchar()))
+                break;
+            c = this->getchar();
+            if(size + 4 > run_size) {
+                name.append(run, run + size);
+                size = 0;
+            }
+        }
+        if(ascii && name.empty()) {
+            const TokenKind kind = detail::ici_keyword<TokenKind>(run, size);
+            if(kind != TokenKind::tok_id)
+                return kind;
+        }
+        name.append(run, run + size);
+        return TokenKind::tok_id;
+    }
+};
+
+
+}    // namespace banshee
@@ -0,0 +1,294 @@
+#pragma once
+#include <banshee/ici/ici_plan.hpp>
+#include <banshee/detail/thread_pool.hpp>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sys/stat.h>
+
+namespace banshee {
+
+// Loads ICI files along with the files they include.
+// Each file is read, parsed and compiled once per loader, and its plan is shared by all the
+// files including it. Files are identified by their canonical path. A file loaded by an
+// earlier call is reused if neither it nor any file it includes, directly or not, was
+// modified since (different inode or modification time); files which failed to load are
+// loaded again.
+// The files included by a file are queued on a thread pool as soon as the include
+// statements are read, so independent includes load concurrently. A file needed before a
+// thread of the pool took it is loaded by the thread needing it, so loads also complete with
+// no threads. Include paths are relative to the directory of the including file.
+// Loading fails on unreadable or malformed files and on include cycles, see error().
+// A loader is not meant to be used by several threads at once.
+template<typename Property = banshee::property>
+class basic_ici_loader {
+public:
+    // Runs the loads on threads threads in addition to the calling one
+    explicit basic_ici_loader(std::size_t threads = std::thread::hardware_concurrency()) :
+        m_pool(threads) {}
+
+    // Returns the object built by the file when evaluated with a null environment
+    std::optional<Property> load(const std::string& path) {
+        const auto f = get(path);
+        if(!f)
+            return {};
+        return f->result;
+    }
+
+    // Returns the plan of the file, which runs the plans of its includes, or nullptr.
+    // Plans can be evaluated again with other environments, see ici_plan.
+    std::shared_ptr<const ici_plan<Property>> compile(const std::string& path) {
+        const auto f = get(path);
+        if(!f)
+            return nullptr;
+        return f->plan;
+    }
+
+    // Why the last load failed
+    const std::string& error() const noexcept {
+        return m_error;
+    }
+
+    // Forgets the files loaded so far
+    void clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_files.clear();
+    }
+
+private:
+    struct file {
+        std::string path;
+        dev_t device;
+        ino_t inode;
+        struct timespec modified;
+        // The load() which last checked that the file and its includes are unchanged
+        std::uint64_t checked = 0;
+        // Files included by this one, added before they are waited for
+        std::vector<std::shared_ptr<file>> includes;
+        // Set by the thread loading the file
+        std::atomic<bool> claimed{false};
+        std::atomic<bool> done{false};
+        std::shared_ptr<const ici_plan<Property>> plan;
+        std::optional<Property> result;
+        std::string error;
+    };
+
+    // Loads the file, returns nullptr and sets m_error on failure
+    std::shared_ptr<const file> get(const std::string& path) {
+        m_error.clear();
+        std::string canonical;
+        struct stat st;
+        if(!identify(path, canonical, st)) {
+            m_error = path + ": cannot open file";
+            return nullptr;
+        }
+        std::shared_ptr<file> f;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_generation++;
+            f = find_or_add(canonical, st);
+        }
+        await(*f);
+        settle();
+        if(!f->result) {
+            m_error = f->error;
+            return nullptr;
+        }
+        return f;
+    }
+
+    static bool identify(const std::string& path, std::string& canonical, struct stat& st) {
+        char resolved[PATH_MAX];
+        if(!::realpath(path.c_str(), resolved) || ::stat(resolved, &st) != 0)
+            return false;
+        canonical = resolved;
+        return true;
+    }
+
+    static bool same_file(const file& f, const struct stat& st) noexcept {
+        return f.device == st.st_dev && f.inode == st.st_ino &&
+               f.modified.tv_sec == st.st_mtim.tv_sec && f.modified.tv_nsec == st.st_mtim.tv_nsec;
+    }
+
+    // Whether a file can be reused: it was added by the current load(), or it was loaded and
+    // neither it nor the files it includes changed since. Must be called with m_mutex held.
+    bool up_to_date(file& f, const struct stat& st) {
+        if(f.checked == m_generation)
+            return true;
+        if(!f.result || !same_file(f, st))
+            return false;
+        for(const auto& include : f.includes) {
+            struct stat include_st;
+            if(::stat(include->path.c_str(), &include_st) != 0 || !up_to_date(*include, include_st))
+                return false;
+        }
+        f.checked = m_generation;
+        return true;
+    }
+
+    // Returns the entry of the file, queuing the file for loading if it is not up to date.
+    // Replaced entries stay alive as long as files including them do.
+    // Must be called with m_mutex held.
+    std::shared_ptr<file> find_or_add(const std::string& canonical, const struct stat& st) {
+        auto& entry = m_files[canonical];
+        if(entry && up_to_date(*entry, st))
+            return entry;
+        entry = std::make_shared<file>();
+        entry->path = canonical;
+        entry->device = st.st_dev;
+        entry->inode = st.st_ino;
+        entry->modified = st.st_mtim;
+        entry->checked = m_generation;
+        m_running++;
+        m_queued.push_back(entry);
+        if(m_pool.size()) {
+            m_pool.submit([this, f = entry] {
+                if(!f->claimed.exchange(true))
+                    run(*f);
+            });
+        }
+        m_cv.notify_all();
+        return entry;
+    }
+
+    // Whether to can be reached from from through include edges. Must be called with m_mutex
+    // held.
+    static bool reaches(const file* from, const file* to) {
+        std::vector<const file*> stack{from};
+        std::vector<const file*> seen;
+        while(!stack.empty()) {
+            const file* f = stack.back();
+            stack.pop_back();
+            if(f == to)
+                return true;
+            if(std::find(seen.begin(), seen.end(), f) != seen.end())
+                continue;
+            seen.push_back(f);
+            for(const auto& include : f->includes)
+                stack.push_back(include.get());
+        }
+        return false;
+    }
+
+    // Loads the file on the calling thread, unless another thread already does. Threads only
+    // ever wait for the includes of the file they load, and includes cannot form cycles, so
+    // waiting cannot deadlock, whatever the number of threads and the shape of the includes.
+    void await(file& f) {
+        if(!f.claimed.exchange(true))
+            return run(f);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [&f] { return f.done.load(); });
+    }
+
+    // Loads the files nobody waited for, as their includer failed first, and waits for the
+    // loads still running: no load outlives the load() which started it
+    void settle() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for(;;) {
+            m_cv.wait(lock, [this] { return m_running == 0 || !m_queued.empty(); });
+            if(m_queued.empty())
+                return;
+            const auto f = std::move(m_queued.back());
+            m_queued.pop_back();
+            lock.unlock();
+            if(!f->claimed.exchange(true))
+                run(*f);
+            lock.lock();
+        }
+    }
+
+    // Results are set by the caller, failures only set the error
+    void finish(file& f, std::string error = {}) {
+        f.error = std::move(error);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            f.done.store(true);
+            m_running--;
+        }
+        m_cv.notify_all();
+    }
+
+    void run(file& f) {
+        std::ifstream in(f.path, std::ios::binary);
+        if(!in)
+            return finish(f, f.path + ": cannot read file");
+        const std::string bytes((std::istreambuf_iterator<char>(in)),
+                                std::istreambuf_iterator<char>());
+        std::u32string text;
+        const std::size_t bom = bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+        if(!decode_utf8(bytes.data() + bom, bytes.data() + bytes.size(), text))
+            return finish(f, f.path + ": invalid utf-8");
+
+        auto tokens = ici_token_view<std::u32string, Property>(std::move(text));
+        ici_parser<decltype(tokens)> parser(tokens);
+        auto document = parser.parse();
+        if(!document) {
+            const text_position at = tokens.position(parser.last_offset());
+            return finish(f, f.path + ":" + std::to_string(at.line) + ":" +
+                                 std::to_string(at.column) + ": syntax error");
+        }
+
+        // Queue all the includes before waiting for any of them
+        const std::string directory = f.path.substr(0, f.path.rfind('/') + 1);
+        std::vector<std::shared_ptr<file>> includes;
+        for(const auto& include : document->includes) {
+            const std::string path = !include.empty() && include[0] == '/' ? include
+                                                                             : directory + include;
+            std::string canonical;
+            struct stat st;
+            if(!identify(path, canonical, st))
+                return finish(f, f.path + ": cannot open included file " + include);
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto target = find_or_add(canonical, st);
+            if(target.get() == &f || reaches(target.get(), &f)) {
+                lock.unlock();
+                return finish(f, f.path + ": include cycle through " + target->path);
+            }
+            f.includes.push_back(target);
+            includes.push_back(target);
+        }
+
+        std::vector<std::shared_ptr<const ici_plan<Property>>> plans;
+        for(const auto& include : includes) {
+            await(*include);
+            if(!include->result)
+                return finish(f, include->error);
+            plans.push_back(include->plan);
+        }
+        auto plan = ici_plan<Property>::compile(*document, std::move(plans));
+        if(!plan)
+            return finish(f, f.path + ": cannot compile");
+        Property result;
+        if(!plan->evaluate(Property{}, result))
+            return finish(f, f.path + ": evaluation failed");
+        f.plan = std::make_shared<const ici_plan<Property>>(std::move(*plan));
+        f.result = std::move(result);
+        finish(f);
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::unordered_map<std::string, std::shared_ptr<file>> m_files;
+    // Files queued by the current load(), and how many of them are not done
+    std::vector<std::shared_ptr<file>> m_queued;
+    std::size_t m_running = 0;
+    std::uint64_t m_generation = 0;
+    std::string m_error;
+    // Last, so that the threads stop before the state they use is destroyed
+    detail::thread_pool m_pool;
+};
+
+using ici_loader = basic_ici_loader<>;
+
+}    // namespace banshee
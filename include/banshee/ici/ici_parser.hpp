@@ -0,0 +1,281 @@
+#pragma once
+#include <banshee/ici/ici_lexer.hpp>
+#include <banshee/parser.hpp>
+#include <banshee/property.hpp>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace banshee {
+
+// ICI files are sequences of statements building an object:
+//   name = value              assigns a member, name may be a dotted path (a.b.c)
+//   name += value             appends to arrays, concatenates strings, adds numbers and
+//                             merges objects; -= removes from arrays or subtracts; *= multiplies
+//   name { statements }       evaluates statements inside the object name, creating it if needed
+//   unset name                removes a member
+//   include "file"            merges the object built by another file
+//   if value { statements } else { statements }
+//                             else is optional and may be followed by another if
+//   foreach name : value { statements }
+//                             runs statements for each element of an array, or each member
+//                             name of an object
+// Values are literals, arrays ([1, 2]), objects ({ statements }), names of members defined
+// earlier, looked up in the loop variables, then from the innermost object outward, then in
+// the environment, and values combined with and / or, which like in python evaluate to the
+// operand deciding the result. null and false are false, every other value is true.
+// Parsing produces an ici_document, which is compiled to an ici_plan once the files it
+// includes are (see ici_plan.hpp).
+
+template<typename Property>
+struct ici_statement;
+
+template<typename Property>
+struct ici_value {
+    enum class kind : std::uint8_t { literal, reference, array, object, conjunction, disjunction };
+    kind k = kind::literal;
+    Property literal;
+    // Path of a reference
+    std::vector<typename Property::key_t> path;
+    // Elements of arrays, operands of and / or
+    std::vector<ici_value> elements;
+    std::vector<ici_statement<Property>> statements;
+};
+
+template<typename Property>
+struct ici_statement {
+    enum class op : std::uint8_t {
+        assign,
+        add,
+        subtract,
+        multiply,
+        block,
+        unset,
+        include,
+        if_,
+        foreach,
+    };
+    op o = op::assign;
+    // The loop variable of foreach statements
+    std::vector<typename Property::key_t> path;
+    // The object of block statements holds their statements. The condition of if statements,
+    // the sequence of foreach statements.
+    ici_value<Property> value;
+    // Statements of if and foreach statements, and of the else branch
+    std::vector<ici_statement> body;
+    std::vector<ici_statement> alternative;
+    // Index in ici_document::includes of include statements
+    std::size_t include = 0;
+};
+
+template<typename Property>
+struct ici_document {
+    std::vector<ici_statement<Property>> statements;
+    // Paths of the included files, as written
+    std::vector<std::string> includes;
+};
+
+template<typename Rng>
+class ici_parser : public parser_base<Rng> {
+    using base = parser_base<Rng>;
+
+public:
+    using property_t = typename ranges::range_value_type_t<Rng>::property_t;
+    using document_t = ici_document<property_t>;
+    using statement_t = ici_statement<property_t>;
+    using value_t = ici_value<property_t>;
+    using TK = typename base::token_t::TokenKind;
+
+    ici_parser(Rng& rng) : base(rng) {}
+
+    std::optional<document_t> parse() {
+        document_t document;
+        m_document = &document;
+        if(!parse_statements(document.statements, TK::tok_eof))
+            return {};
+        return document;
+    }
+
+private:
+    // Reads statements up to and including end
+    bool parse_statements(std::vector<statement_t>& statements, TK end) {
+        for(;;) {
+            const auto& next = this->peek_token();
+            if(next == end) {
+                this->eat_token();
+                return true;
+            }
+            if(next == TK::tok_comma) {
+                this->eat_token();
+                continue;
+            }
+            if(!next || !parse_statement(statements.emplace_back()))
+                return false;
+        }
+    }
+
+    bool parse_statement(statement_t& s) {
+        using op = typename statement_t::op;
+        const auto token = this->peek_token();
+        if(token == TK::tok_include) {
+            this->eat_token();
+            const auto file = this->next_token();
+            if(file != TK::tok_string)
+                return false;
+            s.o = op::include;
+            s.include = m_document->includes.size();
+            m_document->includes.push_back(to_utf8(file.as_string()));
+            return true;
+        }
+        if(token == TK::tok_unset) {
+            this->eat_token();
+            s.o = op::unset;
+            return parse_path(s.path);
+        }
+        if(token == TK::tok_if) {
+            this->eat_token();
+            s.o = op::if_;
+            if(!parse_expression(s.value) || this->next_token() != TK::tok_lbrace ||
+               !parse_statements(s.body, TK::tok_rbrace))
+                return false;
+            if(this->peek_token() != TK::tok_else)
+                return true;
+            this->eat_token();
+            if(this->peek_token() == TK::tok_if)
+                return parse_statement(s.alternative.emplace_back());
+            return this->next_token() == TK::tok_lbrace &&
+                   parse_statements(s.alternative, TK::tok_rbrace);
+        }
+        if(token == TK::tok_for) {
+            this->eat_token();
+            s.o = op::foreach;
+            auto variable = this->next_token();
+            if(variable != TK::tok_id || this->next_token() != TK::tok_colon)
+                return false;
+            s.path.push_back(std::get<typename property_t::string_t>(std::move(variable.value)));
+            return parse_expression(s.value) && this->next_token() == TK::tok_lbrace &&
+                   parse_statements(s.body, TK::tok_rbrace);
+        }
+        if(!parse_path(s.path))
+            return false;
+        switch(this->next_token()) {
+            case TK::tok_equal: s.o = op::assign; break;
+            case TK::tok_plus_equal: s.o = op::add; break;
+            case TK::tok_minus_equal: s.o = op::subtract; break;
+            case TK::tok_star_equal: s.o = op::multiply; break;
+            case TK::tok_lbrace:
+                s.o = op::block;
+                s.value.k = value_t::kind::object;
+                return parse_statements(s.value.statements, TK::tok_rbrace);
+            default: return false;
+        }
+        return parse_expression(s.value);
+    }
+
+    bool parse_path(std::vector<typename property_t::key_t>& path) {
+        for(;;) {
+            auto key = this->next_token();
+            if(key != TK::tok_id && key != TK::tok_string)
+                return false;
+            path.push_back(std::get<typename property_t::string_t>(std::move(key.value)));
+            if(this->peek_token() != TK::tok_dot)
+                return true;
+            this->eat_token();
+        }
+    }
+
+    // or binds looser than and
+    bool parse_expression(value_t& v) {
+        return parse_operation(v, TK::tok_or);
+    }
+    bool parse_operation(value_t& v, TK op) {
+        auto operand = [&](value_t& o) {
+            return op == TK::tok_or ? parse_operation(o, TK::tok_and) : parse_value(o);
+        };
+        if(!operand(v))
+            return false;
+        if(this->peek_token() != op)
+            return true;
+        value_t first = std::move(v);
+        v = value_t{};
+        v.k = op == TK::tok_or ? value_t::kind::disjunction : value_t::kind::conjunction;
+        v.elements.push_back(std::move(first));
+        while(this->peek_token() == op) {
+            this->eat_token();
+            if(!operand(v.elements.emplace_back()))
+                return false;
+        }
+        return true;
+    }
+
+    bool parse_value(value_t& v) {
+        using kind = typename value_t::kind;
+        auto token = this->peek_token();
+        switch(token) {
+            case TK::tok_lparen:
+                this->eat_token();
+                return parse_expression(v) && this->next_token() == TK::tok_rparen;
+            case TK::tok_id: v.k = kind::reference; return parse_path(v.path);
+            case TK::tok_lbrace:
+                this->eat_token();
+                v.k = kind::object;
+                return parse_statements(v.statements, TK::tok_rbrace);
+            case TK::tok_lsquare: this->eat_token(); return parse_array(v);
+            default: break;
+        }
+        this->eat_token();
+        switch(token) {
+            case TK::tok_string: v.literal = token.as_string(); return true;
+            case TK::tok_integer: v.literal = token.as_integer(); return true;
+            case TK::tok_double: v.literal = token.as_double(); return true;
+            case TK::tok_true: v.literal = true; return true;
+            case TK::tok_false: v.literal = false; return true;
+            case TK::tok_null: return true;
+            default: return false;
+        }
+    }
+
+    // Arrays of literals are folded into a literal
+    bool parse_array(value_t& v) {
+        using kind = typename value_t::kind;
+        v.k = kind::array;
+        bool literal = true;
+        while(this->peek_token() != TK::tok_rsquare) {
+            auto& e = v.elements.emplace_back();
+            if(!parse_expression(e))
+                return false;
+            literal &= e.k == kind::literal;
+            if(this->peek_token() != TK::tok_comma)
+                break;
+            this->eat_token();
+        }
+        if(this->next_token() != TK::tok_rsquare)
+            return false;
+        if(literal) {
+            typename property_t::array_t array;
+            array.reserve(v.elements.size());
+            for(auto& e : v.elements)
+                array.push_back(std::move(e.literal));
+            v.elements.clear();
+            v.k = kind::literal;
+            v.literal = std::move(array);
+        }
+        return true;
+    }
+
+    template<typename String>
+    static std::string to_utf8(const String& s) {
+        if constexpr(std::is_same_v<typename String::value_type, char>) {
+            return std::string(s.begin(), s.end());
+        } else {
+            std::string out;
+            for(auto c : s)
+                banshee::push_back(out, codepoint(c));
+            return out;
+        }
+    }
+
+    document_t* m_document = nullptr;
+};
+
+}    // namespace banshee
@@ -0,0 +1,513 @@
+#pragma once
+#include <banshee/ici/ici_parser.hpp>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace banshee {
+
+// An ICI document compiled to a flat array of instructions for a small stack machine.
+// Compiling resolves the structure of the document once: evaluating the plan only moves
+// values between a stack and the result, jumping over branches and back to the start of
+// loops, so it can cheaply be repeated against different environments.
+// Plans are immutable and may be evaluated by several threads at once.
+// An included plan is evaluated once per evaluation, however many times it is included:
+// files included along several paths do not make evaluation exponential.
+template<typename Property>
+class ici_plan {
+public:
+    using property_t = Property;
+    using key_t = typename Property::key_t;
+    using array_t = typename Property::array_t;
+    using object_t = typename Property::object_t;
+    using document_t = ici_document<Property>;
+    using statement_t = ici_statement<Property>;
+    using value_t = ici_value<Property>;
+
+    // includes holds the plans of the files of document.includes, in the same order
+    static std::optional<ici_plan>
+    compile(const document_t& document,
+            std::vector<std::shared_ptr<const ici_plan>> includes = {}) {
+        ici_plan plan;
+        plan.m_includes = std::move(includes);
+        for(const auto& include : plan.m_includes) {
+            if(!include)
+                return {};
+        }
+        if(!plan.compile_statements(document.statements))
+            return {};
+        return plan;
+    }
+
+    // Builds the object described by the plan into result, replacing its value.
+    // Names which are not defined by the plan are looked up in environment.
+    // Fails when a name is not defined, when a path goes through something that is not an
+    // object, when foreach is given something else than an array or an object, and when the
+    // operands of an operator do not match.
+    bool evaluate(const Property& environment, Property& result) const {
+        included_t included;
+        return evaluate(environment, result, included);
+    }
+
+    // Number of instructions
+    std::size_t size() const noexcept {
+        return m_code.size();
+    }
+
+private:
+    using op = typename statement_t::op;
+    // Results of the plans included so far in an evaluation, empty if they failed
+    using included_t = std::unordered_map<const ici_plan*, std::optional<Property>>;
+
+    bool evaluate(const Property& environment, Property& result, included_t& included) const {
+        machine m{*this, environment, included};
+        return m.run(result);
+    }
+
+    enum class opcode : std::uint8_t {
+        push_constant,     // a: constant
+        push_reference,    // a: path
+        make_array,        // a: number of elements, popped
+        begin_object,      // pushes an empty object and evaluates the following statements in it
+        end_object,        // closes the object, which stays on the stack
+        store,             // a: path, operation: how to combine the popped value
+        enter,             // a: path of the object in which the following statements run
+        leave,             // returns to the enclosing object
+        unset,             // a: path
+        include,           // a: include
+        jump,              // a: target
+        jump_if_false,     // a: target, pops the condition
+        and_jump,          // a: target, jumps keeping the value if it is false, pops it otherwise
+        or_jump,           // a: target, jumps keeping the value if it is true, pops it otherwise
+        foreach_begin,     // a: path of the variable, b: end of the loop, pops the sequence
+        foreach_next,      // a: start of the loop body
+    };
+    struct instruction {
+        opcode code;
+        op operation;
+        std::uint32_t a;
+        std::uint32_t b;
+    };
+
+    std::size_t emit(opcode code, std::uint32_t a = 0, std::uint32_t b = 0,
+                     op operation = op::assign) {
+        m_code.push_back(instruction{code, operation, a, b});
+        return m_code.size() - 1;
+    }
+    std::uint32_t here() const noexcept {
+        return std::uint32_t(m_code.size());
+    }
+    // The value stack is allocated once, its depth is tracked as instructions are emitted
+    void grow(int n) {
+        m_depth = std::size_t(int(m_depth) + n);
+        if(m_depth > m_max_depth)
+            m_max_depth = m_depth;
+    }
+    std::uint32_t add_path(const std::vector<key_t>& path) {
+        m_paths.push_back(path);
+        return std::uint32_t(m_paths.size() - 1);
+    }
+
+    bool compile_statements(const std::vector<statement_t>& statements) {
+        for(const auto& s : statements) {
+            if(!compile_statement(s))
+                return false;
+        }
+        return true;
+    }
+
+    bool compile_statement(const statement_t& s) {
+        switch(s.o) {
+            case op::include:
+                if(s.include >= m_includes.size())
+                    return false;
+                emit(opcode::include, std::uint32_t(s.include));
+                return true;
+            case op::unset: emit(opcode::unset, add_path(s.path)); return true;
+            case op::block:
+                emit(opcode::enter, add_path(s.path));
+                if(!compile_statements(s.value.statements))
+                    return false;
+                emit(opcode::leave);
+                return true;
+            case op::if_: {
+                if(!compile_value(s.value))
+                    return false;
+                const std::size_t branch = emit(opcode::jump_if_false);
+                grow(-1);
+                if(!compile_statements(s.body))
+                    return false;
+                if(s.alternative.empty()) {
+                    m_code[branch].a = here();
+                    return true;
+                }
+                const std::size_t skip = emit(opcode::jump);
+                m_code[branch].a = here();
+                if(!compile_statements(s.alternative))
+                    return false;
+                m_code[skip].a = here();
+                return true;
+            }
+            case op::foreach: {
+                if(!compile_value(s.value))
+                    return false;
+                const std::size_t begin = emit(opcode::foreach_begin, add_path(s.path));
+                grow(-1);
+                const std::uint32_t body = here();
+                if(!compile_statements(s.body))
+                    return false;
+                emit(opcode::foreach_next, body);
+                m_code[begin].b = here();
+                return true;
+            }
+            default:
+                if(!compile_value(s.value))
+                    return false;
+                emit(opcode::store, add_path(s.path), 0, s.o);
+                grow(-1);
+                return true;
+        }
+    }
+
+    bool compile_value(const value_t& v) {
+        switch(v.k) {
+            case value_t::kind::literal:
+                m_constants.push_back(v.literal);
+                emit(opcode::push_constant, std::uint32_t(m_constants.size() - 1));
+                grow(1);
+                return true;
+            case value_t::kind::reference:
+                emit(opcode::push_reference, add_path(v.path));
+                grow(1);
+                return true;
+            case value_t::kind::array:
+                for(const auto& e : v.elements) {
+                    if(!compile_value(e))
+                        return false;
+                }
+                emit(opcode::make_array, std::uint32_t(v.elements.size()));
+                grow(1 - int(v.elements.size()));
+                return true;
+            case value_t::kind::object:
+                emit(opcode::begin_object);
+                grow(1);
+                if(!compile_statements(v.statements))
+                    return false;
+                emit(opcode::end_object);
+                return true;
+            case value_t::kind::conjunction:
+            case value_t::kind::disjunction: {
+                const opcode code =
+                    v.k == value_t::kind::conjunction ? opcode::and_jump : opcode::or_jump;
+                std::vector<std::size_t> jumps;
+                for(std::size_t i = 0; i < v.elements.size(); i++) {
+                    if(i) {
+                        jumps.push_back(emit(code));
+                        grow(-1);
+                    }
+                    if(!compile_value(v.elements[i]))
+                        return false;
+                }
+                for(std::size_t jump : jumps)
+                    m_code[jump].a = here();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    class machine {
+    public:
+        machine(const ici_plan& plan, const Property& environment, included_t& included) :
+            m_plan(plan),
+            m_environment(environment),
+            m_included(included) {
+            m_values.reserve(plan.m_max_depth);
+        }
+
+        bool run(Property& result) {
+            result = object_t{};
+            m_scopes.push_back(&result);
+            const auto& code = m_plan.m_code;
+            std::size_t pc = 0;
+            while(pc < code.size()) {
+                const instruction& i = code[pc++];
+                switch(i.code) {
+                    case opcode::push_constant:
+                        m_values.push_back(m_plan.m_constants[i.a]);
+                        break;
+                    case opcode::push_reference: {
+                        const Property* p = lookup(m_plan.m_paths[i.a]);
+                        if(!p)
+                            return false;
+                        m_values.push_back(*p);
+                        break;
+                    }
+                    case opcode::make_array: {
+                        array_t array;
+                        array.reserve(i.a);
+                        for(auto it = m_values.end() - i.a; it != m_values.end(); ++it)
+                            array.push_back(std::move(*it));
+                        m_values.resize(m_values.size() - i.a);
+                        m_values.push_back(std::move(array));
+                        break;
+                    }
+                    case opcode::begin_object:
+                        m_values.push_back(object_t{});
+                        m_scopes.push_back(&m_values.back());
+                        break;
+                    case opcode::end_object:
+                    case opcode::leave: m_scopes.pop_back(); break;
+                    case opcode::store: {
+                        Property* target = walk(m_plan.m_paths[i.a], true);
+                        if(!target || !apply(i.operation, *target, std::move(m_values.back())))
+                            return false;
+                        m_values.pop_back();
+                        break;
+                    }
+                    case opcode::enter: {
+                        Property* target = walk(m_plan.m_paths[i.a], true);
+                        if(!target)
+                            return false;
+                        if(!target->is_object()) {
+                            if(!target->is_null())
+                                return false;
+                            *target = object_t{};
+                        }
+                        m_scopes.push_back(target);
+                        break;
+                    }
+                    case opcode::unset: {
+                        const auto& path = m_plan.m_paths[i.a];
+                        Property* parent = walk(path, false, 1);
+                        if(parent && parent->is_object())
+                            std::get<object_t>(parent->value).erase(path.back());
+                        break;
+                    }
+                    case opcode::include: {
+                        const ici_plan* include = m_plan.m_includes[i.a].get();
+                        auto it = m_included.find(include);
+                        if(it == m_included.end()) {
+                            std::optional<Property> result(std::in_place);
+                            if(!include->evaluate(m_environment, *result, m_included))
+                                result.reset();
+                            it = m_included.emplace(include, std::move(result)).first;
+                        }
+                        if(!it->second)
+                            return false;
+                        merge(*m_scopes.back(), *it->second);
+                        break;
+                    }
+                    case opcode::jump: pc = i.a; break;
+                    case opcode::jump_if_false: {
+                        const bool condition = truth(m_values.back());
+                        m_values.pop_back();
+                        if(!condition)
+                            pc = i.a;
+                        break;
+                    }
+                    case opcode::and_jump:
+                    case opcode::or_jump:
+                        if(truth(m_values.back()) == (i.code == opcode::or_jump))
+                            pc = i.a;
+                        else
+                            m_values.pop_back();
+                        break;
+                    case opcode::foreach_begin: {
+                        Property sequence = std::move(m_values.back());
+                        m_values.pop_back();
+                        if(sequence.is_object()) {
+                            array_t names;
+                            for(const auto& member : std::get<object_t>(sequence.value))
+                                names.push_back(member.first);
+                            sequence = std::move(names);
+                        } else if(!sequence.is_array()) {
+                            return false;
+                        }
+                        if(std::get<array_t>(sequence.value).empty()) {
+                            pc = i.b;
+                            break;
+                        }
+                        m_loops.push_back(loop{std::move(sequence), 0, &m_plan.m_paths[i.a][0]});
+                        break;
+                    }
+                    case opcode::foreach_next: {
+                        loop& l = m_loops.back();
+                        if(++l.index < std::get<array_t>(l.sequence.value).size())
+                            pc = i.a;
+                        else
+                            m_loops.pop_back();
+                        break;
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        struct loop {
+            Property sequence;
+            std::size_t index;
+            const key_t* variable;
+        };
+
+        static bool truth(const Property& p) {
+            return bool(static_cast<typename Property::bool_t>(p));
+        }
+
+        // Returns the member at the path, but for its last skip components, in the current
+        // object. Creates the missing objects if create is set.
+        // Returns nullptr if a value along the path is not an object.
+        Property* walk(const std::vector<key_t>& path, bool create, std::size_t skip = 0) {
+            Property* p = m_scopes.back();
+            for(std::size_t i = 0; i + skip < path.size(); i++) {
+                if(p->is_null() && create)
+                    *p = object_t{};
+                if(!p->is_object())
+                    return nullptr;
+                auto& object = detail::mutable_container(std::get<object_t>(p->value));
+                if(!create) {
+                    auto it = object.find(path[i]);
+                    if(it == object.end())
+                        return nullptr;
+                    p = &it->second;
+                } else {
+                    p = &object[path[i]];
+                }
+            }
+            return p;
+        }
+
+        const Property* lookup(const std::vector<key_t>& path) const {
+            const Property* p = nullptr;
+            for(auto l = m_loops.rbegin(); l != m_loops.rend() && !p; ++l) {
+                if(*l->variable == path[0])
+                    p = &std::get<array_t>(l->sequence.value)[l->index];
+            }
+            for(auto scope = m_scopes.rbegin(); scope != m_scopes.rend() && !p; ++scope)
+                p = (*scope)->find(path[0]);
+            if(!p)
+                p = m_environment.find(path[0]);
+            for(std::size_t i = 1; p && i < path.size(); i++)
+                p = p->find(path[i]);
+            return p;
+        }
+
+        // Recursively merges the members of from into to, other values are replaced
+        static void merge(Property& to, const Property& from) {
+            if(!to.is_object() || !from.is_object()) {
+                to = from;
+                return;
+            }
+            auto& object = std::get<object_t>(to.value);
+            for(const auto& member : std::get<object_t>(from.value))
+                merge(object[member.first], member.second);
+        }
+
+        // Integers which overflow fail, rather than losing precision as doubles
+        static bool arithmetic(op o, Property& target, const Property& v) {
+            if(!target.is_number() || !v.is_number())
+                return false;
+            using integral_t = typename Property::integral_t;
+            using floating_t = typename Property::floating_t;
+            if(target.is_integral() && v.is_integral()) {
+                const integral_t a = std::get<integral_t>(target.value);
+                const integral_t b = std::get<integral_t>(v.value);
+                integral_t r;
+                const bool overflow = o == op::add        ? __builtin_add_overflow(a, b, &r)
+                                      : o == op::subtract ? __builtin_sub_overflow(a, b, &r)
+                                                          : __builtin_mul_overflow(a, b, &r);
+                if(overflow)
+                    return false;
+                target = r;
+                return true;
+            }
+            const floating_t a = floating_t(target), b = floating_t(v);
+            target = o == op::add ? a + b : o == op::subtract ? a - b : a * b;
+            return true;
+        }
+
+        // Whether subtracting v from an array removes e
+        static bool removes(const Property& v, const Property& e) {
+            if(!v.is_array())
+                return v == e;
+            for(const auto& r : std::get<array_t>(v.value)) {
+                if(r == e)
+                    return true;
+            }
+            return false;
+        }
+
+        static bool apply(op o, Property& target, Property&& v) {
+            if(o == op::assign || (o == op::add && target.is_null())) {
+                target = std::move(v);
+                return true;
+            }
+            switch(o) {
+                case op::add:
+                    if(target.is_array()) {
+                        auto& array = std::get<array_t>(target.value);
+                        if(v.is_array()) {
+                            for(const auto& e : std::get<array_t>(v.value))
+                                array.push_back(e);
+                        } else {
+                            array.push_back(std::move(v));
+                        }
+                        return true;
+                    }
+                    if(target.is_string() && v.is_string()) {
+                        std::get<typename Property::string_t>(target.value) +=
+                            std::get<typename Property::string_t>(v.value);
+                        return true;
+                    }
+                    if(target.is_object() && v.is_object()) {
+                        merge(target, v);
+                        return true;
+                    }
+                    return arithmetic(o, target, v);
+                case op::subtract:
+                    if(target.is_array()) {
+                        array_t kept;
+                        for(const auto& e : std::get<array_t>(target.value)) {
+                            if(!removes(v, e))
+                                kept.push_back(e);
+                        }
+                        target = std::move(kept);
+                        return true;
+                    }
+                    return arithmetic(o, target, v);
+                case op::multiply: return arithmetic(o, target, v);
+                default: return false;
+            }
+        }
+
+        const ici_plan& m_plan;
+        const Property& m_environment;
+        included_t& m_included;
+        std::vector<Property> m_values;
+        std::vector<Property*> m_scopes;
+        std::vector<loop> m_loops;
+    };
+
+    std::vector<instruction> m_code;
+    std::vector<Property> m_constants;
+    std::vector<std::vector<key_t>> m_paths;
+    std::vector<std::shared_ptr<const ici_plan>> m_includes;
+    std::size_t m_depth = 0;
+    std::size_t m_max_depth = 0;
+};
+
+// Evaluates a document which includes no other file
+template<typename Property>
+std::optional<Property> evaluate(const ici_document<Property>& document,
+                                 const Property& environment = {}) {
+    auto plan = ici_plan<Property>::compile(document);
+    Property result;
+    if(!plan || !plan->evaluate(environment, result))
+        return {};
+    return result;
+}
+
+}    // namespace banshee
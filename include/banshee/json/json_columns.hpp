@@ -0,0 +1,428 @@
+#pragma once
+#include <banshee/json/json_parser.hpp>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace banshee {
+
+// Columnar reading of arrays of records, such as [{"ts": 1, "host": "a"}, {"ts": 2, ...}].
+// Each member becomes a column holding one value per row in a contiguous vector of its type,
+// so that analytics code can loop over it without building a property per row.
+
+namespace detail {
+    class column_builder;
+}
+
+enum class column_type : std::uint8_t {
+    // Type not known yet, all the values read so far are null
+    null,
+    boolean,
+    integral,
+    floating,
+    string,
+};
+
+struct column_spec {
+    std::string name;
+    // column_type::null lets the parser infer the type of the column
+    column_type type = column_type::null;
+};
+
+class json_column {
+public:
+    explicit json_column(std::string name, column_type type = column_type::null) :
+        m_name(std::move(name)),
+        m_type(type),
+        m_fixed_type(type != column_type::null) {}
+
+    const std::string& name() const noexcept {
+        return m_name;
+    }
+    column_type type() const noexcept {
+        return m_type;
+    }
+    std::size_t size() const noexcept {
+        return m_size;
+    }
+
+    // One bit per row, least significant bit first, set when the row holds a value
+    const std::vector<std::uint64_t>& validity() const noexcept {
+        return m_validity;
+    }
+    bool is_null(std::size_t row) const noexcept {
+        return !((m_validity[row / 64] >> (row % 64)) & 1);
+    }
+    std::size_t null_count() const noexcept {
+        return m_null_count;
+    }
+
+    // The values of the column, as per type(). Null rows hold 0.
+    const std::vector<std::uint8_t>& booleans() const noexcept {
+        return m_booleans;
+    }
+    const std::vector<std::int64_t>& integers() const noexcept {
+        return m_integers;
+    }
+    const std::vector<double>& doubles() const noexcept {
+        return m_doubles;
+    }
+    // Strings are dictionary encoded: the code of each row indexes the dictionary, which holds
+    // each distinct string once, in order of first appearance.
+    const std::vector<std::uint32_t>& codes() const noexcept {
+        return m_codes;
+    }
+    const std::vector<std::string>& dictionary() const noexcept {
+        return m_dictionary;
+    }
+    std::string_view string(std::size_t row) const noexcept {
+        return m_dictionary[m_codes[row]];
+    }
+
+private:
+    friend class detail::column_builder;
+
+    void push_validity(bool valid) {
+        if(m_size % 64 == 0)
+            m_validity.push_back(0);
+        if(valid)
+            m_validity.back() |= std::uint64_t(1) << (m_size % 64);
+        else
+            m_null_count++;
+        m_size++;
+    }
+
+    // Adopts type when the column has none yet, integral columns are promoted to floating
+    bool set_type(column_type type) {
+        if(m_type == type)
+            return true;
+        if(m_type == column_type::integral && type == column_type::floating && !m_fixed_type) {
+            m_doubles.assign(m_integers.begin(), m_integers.end());
+            m_integers = {};
+            m_type = type;
+            return true;
+        }
+        if(m_type != column_type::null)
+            return false;
+        m_type = type;
+        switch(type) {
+            case column_type::boolean: m_booleans.resize(m_size); break;
+            case column_type::integral: m_integers.resize(m_size); break;
+            case column_type::floating: m_doubles.resize(m_size); break;
+            case column_type::string: m_codes.resize(m_size); break;
+            case column_type::null: break;
+        }
+        return true;
+    }
+
+    void push_null() {
+        switch(m_type) {
+            case column_type::boolean: m_booleans.push_back(0); break;
+            case column_type::integral: m_integers.push_back(0); break;
+            case column_type::floating: m_doubles.push_back(0); break;
+            case column_type::string: m_codes.push_back(0); break;
+            case column_type::null: break;
+        }
+        push_validity(false);
+    }
+    bool push_boolean(bool b) {
+        if(!set_type(column_type::boolean))
+            return false;
+        m_booleans.push_back(b);
+        push_validity(true);
+        return true;
+    }
+    bool push_integer(std::int64_t i) {
+        if(m_type == column_type::floating)
+            return push_double(double(i));
+        if(!set_type(column_type::integral))
+            return false;
+        m_integers.push_back(i);
+        push_validity(true);
+        return true;
+    }
+    bool push_double(double d) {
+        if(!set_type(column_type::floating))
+            return false;
+        m_doubles.push_back(d);
+        push_validity(true);
+        return true;
+    }
+    bool push_string(const std::string& s) {
+        if(!set_type(column_type::string))
+            return false;
+        auto it = m_dictionary_index.find(s);
+        if(it == m_dictionary_index.end()) {
+            it = m_dictionary_index.emplace(s, std::uint32_t(m_dictionary.size())).first;
+            m_dictionary.push_back(s);
+        }
+        m_codes.push_back(it->second);
+        push_validity(true);
+        return true;
+    }
+
+    std::string m_name;
+    column_type m_type;
+    bool m_fixed_type;
+    std::size_t m_size = 0;
+    std::size_t m_null_count = 0;
+    std::vector<std::uint64_t> m_validity;
+    std::vector<std::uint8_t> m_booleans;
+    std::vector<std::int64_t> m_integers;
+    std::vector<double> m_doubles;
+    std::vector<std::uint32_t> m_codes;
+    std::vector<std::string> m_dictionary;
+    std::unordered_map<std::string, std::uint32_t> m_dictionary_index;
+};
+
+class json_column_table {
+public:
+    std::size_t rows() const noexcept {
+        return m_rows;
+    }
+    const std::vector<json_column>& columns() const noexcept {
+        return m_columns;
+    }
+    // Returns nullptr if there is no such column
+    const json_column* find(std::string_view name) const noexcept {
+        for(const auto& column : m_columns) {
+            if(column.name() == name)
+                return &column;
+        }
+        return nullptr;
+    }
+
+private:
+    friend class detail::column_builder;
+
+    std::size_t m_rows = 0;
+    std::vector<json_column> m_columns;
+};
+
+namespace detail {
+    // Fills a json_column_table row by row
+    class column_builder {
+    public:
+        explicit column_builder(bool infer) : m_infer(infer) {}
+
+        // Returns nullptr if there already is a column of that name
+        json_column* add_column(const std::string& name, column_type type) {
+            if(!m_index.emplace(name, m_table.m_columns.size()).second)
+                return nullptr;
+            return &m_table.m_columns.emplace_back(name, type);
+        }
+
+        // Members usually come in the same order in every row, so the column following the
+        // previous member is tried before the index.
+        json_column* lookup(const std::string& name, std::size_t& hint) {
+            auto& columns = m_table.m_columns;
+            if(hint < columns.size() && columns[hint].name() == name)
+                return &columns[hint++];
+            auto it = m_index.find(name);
+            if(it != m_index.end()) {
+                hint = it->second + 1;
+                return &columns[it->second];
+            }
+            if(!m_infer)
+                return nullptr;
+            json_column* column = add_column(name, column_type::null);
+            for(std::size_t i = 0; i < m_table.m_rows; i++)
+                column->push_null();
+            hint = columns.size();
+            return column;
+        }
+
+        // Whether the column has no value in the current row yet
+        bool is_unset(const json_column& column) const noexcept {
+            return column.size() == m_table.m_rows;
+        }
+
+        void end_row() {
+            for(auto& column : m_table.m_columns) {
+                if(is_unset(column))
+                    column.push_null();
+            }
+            m_table.m_rows++;
+        }
+
+        static void push_null(json_column& column) {
+            column.push_null();
+        }
+        static bool push_boolean(json_column& column, bool b) {
+            return column.push_boolean(b);
+        }
+        static bool push_integer(json_column& column, std::int64_t i) {
+            return column.push_integer(i);
+        }
+        static bool push_double(json_column& column, double d) {
+            return column.push_double(d);
+        }
+        static bool push_string(json_column& column, const std::string& s) {
+            return column.push_string(s);
+        }
+
+        json_column_table release() {
+            return std::move(m_table);
+        }
+
+    private:
+        json_column_table m_table;
+        std::unordered_map<std::string, std::size_t> m_index;
+        bool m_infer;
+    };
+}    // namespace detail
+
+// Parses an array of objects into a json_column_table.
+// Without a schema, there is a column for every member name met, whose type is inferred from
+// its values. With a schema, only the listed members are read and the others are skipped.
+// A member missing from a row is null in that row. Integers read into a floating column are
+// converted; a column holding integers is converted to floating when a double is met, unless
+// the schema says otherwise.
+// Parsing fails on malformed json, skipped members included, on rows that are not objects, on
+// arrays or objects as values of a column, on values of different types in one column, on
+// duplicated members and on schemas listing a name twice.
+template<typename Rng, CONCEPT_REQUIRES_(concepts::JsonTokenInputRange<Rng>())>
+class json_column_parser : public parser_base<Rng> {
+    using base = parser_base<Rng>;
+
+public:
+    using property_t = typename ranges::range_value_type_t<Rng>::property_t;
+    using TK = typename base::token_t::TokenKind;
+    static_assert(std::is_same_v<typename property_t::string_t, std::string>,
+                  "columns hold utf-8 strings");
+
+    explicit json_column_parser(Rng& rng) : base(rng), m_builder(true) {}
+    json_column_parser(Rng& rng, const std::vector<column_spec>& schema) :
+        base(rng),
+        m_builder(false) {
+        for(const auto& spec : schema) {
+            if(!m_builder.add_column(spec.name, spec.type))
+                m_valid_schema = false;
+        }
+    }
+
+    std::optional<json_column_table> parse() {
+        if(!m_valid_schema || this->next_token() != TK::tok_lsquare)
+            return {};
+        if(this->peek_token() == TK::tok_rsquare) {
+            this->eat_token();
+        } else {
+            for(;;) {
+                if(!parse_row())
+                    return {};
+                const auto separator = this->next_token();
+                if(separator == TK::tok_rsquare)
+                    break;
+                if(separator != TK::tok_comma)
+                    return {};
+            }
+        }
+        // Nothing but the end of the input may follow the array
+        if(!this->eof() && this->peek_token() != TK::tok_eof)
+            return {};
+        return m_builder.release();
+    }
+
+private:
+    using builder = detail::column_builder;
+
+    bool parse_row() {
+        if(this->next_token() != TK::tok_lbrace)
+            return false;
+        std::size_t hint = 0;
+        if(this->peek_token() == TK::tok_rbrace) {
+            this->eat_token();
+        } else {
+            for(;;) {
+                const auto key = this->next_token();
+                if(key != TK::tok_string || this->next_token() != TK::tok_colon)
+                    return false;
+                json_column* column = m_builder.lookup(key.as_string(), hint);
+                if(!column) {
+                    if(!skip_value())
+                        return false;
+                } else if(!m_builder.is_unset(*column) || !read_value(*column)) {
+                    return false;
+                }
+                const auto separator = this->next_token();
+                if(separator == TK::tok_rbrace)
+                    break;
+                if(separator != TK::tok_comma)
+                    return false;
+            }
+        }
+        m_builder.end_row();
+        return true;
+    }
+
+    bool read_value(json_column& column) {
+        const auto value = this->next_token();
+        switch(value) {
+            case TK::tok_null: builder::push_null(column); return true;
+            case TK::tok_true: return builder::push_boolean(column, true);
+            case TK::tok_false: return builder::push_boolean(column, false);
+            case TK::tok_integer:
+                return builder::push_integer(column, std::int64_t(value.as_integer()));
+            case TK::tok_double: return builder::push_double(column, double(value.as_double()));
+            case TK::tok_string: return builder::push_string(column, value.as_string());
+            default: return false;
+        }
+    }
+
+    // Skips a value, checking its syntax. The open containers are kept on a stack rather than
+    // parsed recursively.
+    bool skip_value() {
+        m_skip_stack.clear();
+        for(;;) {
+            const auto token = this->next_token();
+            switch(token) {
+                case TK::tok_lbrace:
+                case TK::tok_lsquare: {
+                    const auto close = token == TK::tok_lbrace ? TK::tok_rbrace : TK::tok_rsquare;
+                    if(this->peek_token() == close) {
+                        this->eat_token();
+                        break;
+                    }
+                    m_skip_stack.push_back(token.kind);
+                    if(token == TK::tok_lbrace && !skip_key())
+                        return false;
+                    continue;
+                }
+                case TK::tok_null:
+                case TK::tok_true:
+                case TK::tok_false:
+                case TK::tok_integer:
+                case TK::tok_double:
+                case TK::tok_string: break;
+                default: return false;
+            }
+            // After a value, either the next element follows or containers are closed
+            for(;;) {
+                if(m_skip_stack.empty())
+                    return true;
+                const bool object = m_skip_stack.back() == TK::tok_lbrace;
+                const auto separator = this->next_token();
+                if(separator == TK::tok_comma) {
+                    if(object && !skip_key())
+                        return false;
+                    break;
+                }
+                if(separator != (object ? TK::tok_rbrace : TK::tok_rsquare))
+                    return false;
+                m_skip_stack.pop_back();
+            }
+        }
+    }
+    bool skip_key() {
+        return this->next_token() == TK::tok_string && this->next_token() == TK::tok_colon;
+    }
+
+    detail::column_builder m_builder;
+    std::vector<TK> m_skip_stack;
+    bool m_valid_schema = true;
+};
+
+}    // namespace banshee
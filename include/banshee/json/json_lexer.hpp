@@ -28,6 +28,8 @@ namespace detail {
             "eof",    "invalid", "lbrace", "rbrace", "lsquare", "rsquare", "string",
             "double", "integer", "colon",  "comma",  "true",    "false",   "null"};
         //#endif
+        // Only the escape sequences of json_escape_table and \u are valid in strings
+        static constexpr bool extended_escapes = false;
 
         using property_t = property_type;
         using string_t = typename property_type::string_t;
@@ -37,7 +39,8 @@ namespace detail {
 
         TokenKind kind = TokenKind::tok_invalid;
         std::variant<integral_t, floating_t, string_t> value;
-        Pos begin, end;
+        // Offset of the first character of the token, see lexer_base_view::position
+        std::size_t offset = 0;
         explicit operator bool() const {
             return kind != TokenKind::tok_eof && kind != TokenKind::tok_invalid;
         }
@@ -58,8 +61,7 @@ namespace detail {
     };
     template<typename property_type>
     std::ostream& operator<<(std::ostream& os, const json_token<property_type>& tok) {
-        os << json_token<property_type>::token_names[tok.kind] << " : "
-           << " ( " << tok.begin << " ) " << tok.end << " )";
+        os << json_token<property_type>::token_names[tok.kind] << " : " << tok.offset;
         return os;
     }
     template<typename property_type>
@@ -79,130 +81,98 @@ class json_token_view : public lexer_base_view<Rng, json_token_view<Rng, Propert
                                  detail::json_token<PropertyType>, PropertyType>;
     using token_t = typename base::token_t;
     using TokenKind = typename base::TokenKind;
-    using Pos = typename base::Pos;
 
 
 public:
     json_token_view(Rng&& rng) : base(std::forward<Rng>(rng)) {}
     typename base::token_stream_t token_stream() {
-        try {
-            bool long_string = false;
-            while(!this->at_end()) {
-                long_string = false;
-                typename base::codepoint c = this->getchar();
-                switch(c) {
-                    case '{': co_yield this->make_token(TokenKind::tok_lbrace); break;
-                    case '}': co_yield this->make_token(TokenKind::tok_rbrace); break;
-                    case '[': co_yield this->make_token(TokenKind::tok_lsquare); break;
-                    case ']': co_yield this->make_token(TokenKind::tok_rsquare); break;
-                    case ':': co_yield this->make_token(TokenKind::tok_colon); break;
-                    case ',': co_yield this->make_token(TokenKind::tok_comma); break;
-
-                    case '\t':
-                    case '\r':
-                    case ' ': break;
-                    case '\n':
-                        this->pos = 0;
-                        this->line++;
-                        break;
-                    case '"': {
-                        Pos begin{this->line, this->pos};
-                        typename base::string_t str;
-                        str.reserve(10);
-                        bool escaped = false;
-                        char b = c;
+        while(!this->at_end()) {
+            const std::size_t offset = this->offset();
+            typename base::codepoint c = this->getchar();
+            switch(c) {
+                case '{': co_yield this->make_token(TokenKind::tok_lbrace, offset); break;
+                case '}': co_yield this->make_token(TokenKind::tok_rbrace, offset); break;
+                case '[': co_yield this->make_token(TokenKind::tok_lsquare, offset); break;
+                case ']': co_yield this->make_token(TokenKind::tok_rsquare, offset); break;
+                case ':': co_yield this->make_token(TokenKind::tok_colon, offset); break;
+                case ',': co_yield this->make_token(TokenKind::tok_comma, offset); break;
+
+                case '\t':
+                case '\r':
+                case '\n':
+                case ' ': break;
+                case '"': {
+                    typename base::buffer_t str;
+                    if(!this->parse_string(str, c)) {
+                        co_yield this->make_token(TokenKind::tok_invalid, offset);
+                        co_return;
+                    }
+                    co_yield this->make_token(TokenKind::tok_string, std::move(str), offset);
+                    break;
+                }
+                case '-':
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9': {
+                    typename base::integral_t i;
+                    typename base::floating_t d;
+                    switch(this->parse_number(i, d, c)) {
+                        case detail::number_kind::integral:
+                            co_yield this->make_token(TokenKind::tok_integer, std::move(i), offset);
+                            break;
+                        case detail::number_kind::floating:
+                            co_yield this->make_token(TokenKind::tok_double, std::move(d), offset);
+                            break;
+                        case detail::number_kind::invalid:
+                            co_yield this->make_token(TokenKind::tok_invalid, offset);
+                            co_return;
+                    }
+                    break;
+                }
+                default: {
+                    if(c < 0x80 && (std::isalpha(c) || c == '_')) {
+                        typename base::buffer_t buf;
+                        buf.reserve(10);
+
+                        banshee::push_back(buf, c);
                         while(!this->at_end()) {
-                            c = this->getchar();
-                            if(c == '\\') {
-                                escaped = !escaped;
-                                continue;
-                            }
-                            if(escaped) {
-                                if(!this->parse_escape_sequence(str, c)) {
-                                    co_yield this->make_token(TokenKind::tok_invalid);
-                                    break;
-                                }
-                                escaped = false;
-                                continue;
-                            } else if(c <= 0x001F) {
-                                co_yield this->make_token(TokenKind::tok_invalid);
+                            c = this->peekchar();
+                            if(!(c < 0x80 && (isalnum(c) || c == '_')))
                                 break;
-                            }
-
-                            else if(c == b) {
-                                Pos end{this->line, this->pos};
-                                co_yield this->make_token(TokenKind::tok_string, std::move(str),
-                                                          begin, end);
-                                break;
-                            }
-                            banshee::push_back(str, c);
+                            c = this->getchar();
+                            banshee::push_back(buf, c);
+                        };
+                        if(buf.compare("false") == 0) {
+                            co_yield this->make_token(TokenKind::tok_false, offset);
+                            break;
                         }
-                        // co_yield make_token(TokenKind::tok_invalid); //uncomplete string
-                        break;
-                    }
-                    case '-':
-                    case '0':
-                    case '1':
-                    case '2':
-                    case '3':
-                    case '4':
-                    case '5':
-                    case '6':
-                    case '7':
-                    case '8':
-                    case '9': {
-                        Pos begin{this->line, this->pos};
-                        typename base::floating_t d;
-                        if(!this->parse_number(d, c)) {
-                            co_yield this->make_token(TokenKind::tok_invalid);
+                        if(buf.compare("true") == 0) {
+                            co_yield this->make_token(TokenKind::tok_true, offset);
                             break;
                         }
-
-
-                        co_yield this->make_token(TokenKind::tok_double, std::move(d), begin,
-                                                  Pos{this->line, this->pos});
-                        continue;
-                    }
-                    default: {
-                        if(std::isalpha(c) || c == '_' /*|| !c.is_ascii()*/) {
-                            Pos begin{base::line, base::pos};
-                            typename base::string_t buf;
-                            buf.reserve(10);
-
-                            banshee::push_back(buf, c);
-                            while(!this->at_end()) {
-                                // std::cout << c << std::flush;
-                                c = this->peekchar();
-                                if(!(isalnum(c) || c == '_' /*|| c.is_ascii()*/))
-                                    break;
-                                c = this->getchar();
-                                banshee::push_back(buf, c);
-                            };
-                            //  std::cout << buf << std::endl;
-                            Pos end{this->line, this->pos};
-                            if(buf.compare("false") == 0) {
-                                co_yield this->make_token(TokenKind::tok_false, begin, end);
-                                break;
-                            }
-                            if(buf.compare("true") == 0) {
-                                co_yield this->make_token(TokenKind::tok_true, begin, end);
-                                break;
-                            }
-                            if(buf.compare("null") == 0) {
-                                co_yield this->make_token(TokenKind::tok_null, begin, end);
-                                break;
-                            }
-                            co_yield this->make_token(TokenKind::tok_invalid);
+                        if(buf.compare("null") == 0) {
+                            co_yield this->make_token(TokenKind::tok_null, offset);
                             break;
                         }
-                        co_yield this->make_token(TokenKind::tok_invalid);
                     }
-                }    // switch
-            }        // while
-        } catch(...) {
-            co_yield this->make_token(TokenKind::tok_eof);
+                    co_yield this->make_token(TokenKind::tok_invalid, offset);
+                    co_return;
+                }
+            }    // switch
+        }        // while
+        // A source which ended early may still look like a complete document
+        if(this->source_failed()) {
+            co_yield this->make_token(TokenKind::tok_invalid, this->offset());
+            co_return;
         }
-        co_yield this->make_token(TokenKind::tok_eof);
+        co_yield this->make_token(TokenKind::tok_eof, this->offset());
     }
 };
 
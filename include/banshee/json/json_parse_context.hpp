@@ -0,0 +1,169 @@
+#pragma once
+#include <banshee/json/json_schema.hpp>
+#include <banshee/json/json_tape.hpp>
+#include <banshee/detail/charconv.hpp>
+#include <banshee/detail/escape.hpp>
+#include <banshee/unicode.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace banshee {
+
+// Parses json documents held in contiguous utf-8 memory, such as network messages, into a
+// json tape.
+// The context is meant to be long lived: the tape and the scratch buffer it decodes strings
+// into keep their capacity from one parse to the next, so that once they have grown to the
+// size of the largest message, parsing does not allocate. There is no coroutine frame, token
+// or parser stack per document either, the characters are lexed straight into the tape.
+// The tape holds the last document parsed until the next call to parse.
+template<typename PropertyType = banshee::property>
+class basic_parse_context {
+public:
+    using property_t = PropertyType;
+    using tape_t = basic_json_tape<PropertyType>;
+    using TokenKind = typename tape_t::TokenKind;
+
+    static_assert(std::is_same_v<typename property_t::string_t, std::string>,
+                  "the parse context decodes utf-8 strings");
+
+    basic_parse_context() = default;
+
+    // Returns false if text is not exactly one json value, the tape is then left incomplete
+    bool parse(std::string_view text) {
+        typename tape_t::builder b(m_tape);
+        return run(text, b);
+    }
+
+    // Also checks the document against the schema of validator as it is read, stopping at the
+    // first violation, see validator.error()
+    bool parse(std::string_view text, basic_schema_validator<property_t>& validator) {
+        validator.reset();
+        checked_builder b{typename tape_t::builder(m_tape), validator};
+        return run(text, b);
+    }
+
+    const tape_t& tape() const noexcept {
+        return m_tape;
+    }
+
+    // Builds the document parsed last
+    property_t to_property() const {
+        return m_tape.to_property();
+    }
+
+private:
+    // Feeds both the tape and a validator, in that order so that structural errors are
+    // reported by the tape
+    struct checked_builder {
+        typename tape_t::builder tape;
+        basic_schema_validator<property_t>& validator;
+
+        bool open(TokenKind k) {
+            return tape.open(k) && validator.open(k);
+        }
+        bool close(TokenKind k) {
+            return tape.close(k) && validator.close();
+        }
+        bool colon() {
+            return tape.colon();
+        }
+        bool comma() {
+            return tape.comma();
+        }
+        bool string(std::string_view s) {
+            return tape.string(s) && validator.string(s);
+        }
+        bool literal(TokenKind k) {
+            return tape.literal(k) && validator.literal(k);
+        }
+        bool integral(typename property_t::integral_t i) {
+            return tape.integral(i) && validator.integral(i);
+        }
+        bool floating(typename property_t::floating_t d) {
+            return tape.floating(d) && validator.floating(d);
+        }
+        bool done() const noexcept {
+            return tape.done();
+        }
+    };
+
+    template<typename Builder>
+    bool run(std::string_view text, Builder& b) {
+        const char* p = text.data();
+        const char* const end = p + text.size();
+        while(p != end) {
+            const char c = *p++;
+            bool ok;
+            switch(c) {
+                case ' ':
+                case '\t':
+                case '\r':
+                case '\n': continue;
+                case '{': ok = b.open(TokenKind::tok_lbrace); break;
+                case '[': ok = b.open(TokenKind::tok_lsquare); break;
+                case '}': ok = b.close(TokenKind::tok_lbrace); break;
+                case ']': ok = b.close(TokenKind::tok_lsquare); break;
+                case ':': ok = b.colon(); break;
+                case ',': ok = b.comma(); break;
+                case '"': ok = string(p, end, b); break;
+                case 't': ok = match(p, end, "rue") && b.literal(TokenKind::tok_true); break;
+                case 'f': ok = match(p, end, "alse") && b.literal(TokenKind::tok_false); break;
+                case 'n': ok = match(p, end, "ull") && b.literal(TokenKind::tok_null); break;
+                case '-':
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9': ok = number(p - 1, p, end, b); break;
+                default: return false;
+            }
+            if(!ok)
+                return false;
+        }
+        return b.done();
+    }
+
+    // Checks that [p, end) starts with the rest of a literal, and skips it
+    static bool match(const char*& p, const char* end, std::string_view rest) noexcept {
+        if(std::size_t(end - p) < rest.size() || rest.compare(0, rest.size(), p, rest.size()))
+            return false;
+        p += rest.size();
+        return true;
+    }
+
+    // decode_string copies non ascii characters unchecked, the decoded string is checked
+    template<typename Builder>
+    bool string(const char*& p, const char* end, Builder& b) {
+        m_scratch.clear();
+        if(!detail::decode_string(p, end, m_scratch))
+            return false;
+        const char* last = m_scratch.data() + m_scratch.size();
+        return find_invalid_utf8(m_scratch.data(), last) == last && b.string(m_scratch);
+    }
+
+    template<typename Builder>
+    static bool number(const char* first, const char*& p, const char* end, Builder& b) {
+        while(p != end && detail::is_number_char(std::uint8_t(*p)))
+            ++p;
+        typename property_t::integral_t i;
+        typename property_t::floating_t d;
+        switch(detail::parse_number(first, p, i, d)) {
+            case detail::number_kind::integral: return b.integral(i);
+            case detail::number_kind::floating: return b.floating(d);
+            default: return false;
+        }
+    }
+
+    tape_t m_tape;
+    std::string m_scratch;
+};
+
+using parse_context = basic_parse_context<>;
+
+}    // namespace banshee
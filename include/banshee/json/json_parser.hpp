@@ -1,6 +1,7 @@
 #pragma once
 #include <banshee/json/json_lexer.hpp>
 #include <banshee/parser.hpp>
+#include <banshee/value_pool.hpp>
 #include <stack>
 #include <optional>
 
@@ -36,6 +37,11 @@ class json_parser : public parser_base<Rng> {
 public:
     using property_t = typename ranges::range_value_type_t<Rng>::property_t;
     json_parser(Rng& rng) : parser_base<Rng>(rng) {}
+    // Arrays and objects are interned into pool as they are closed, so that identical
+    // subtrees share their storage, see basic_value_pool.
+    json_parser(Rng& rng, basic_value_pool<property_t>& pool) :
+        parser_base<Rng>(rng),
+        m_pool(&pool) {}
 
     using maybe_property = std::optional<property_t>;
     using TK = typename base::token_t::TokenKind;
@@ -45,24 +51,25 @@ public:
         enum state { parsing_object, parsing_list, parsing_value };
         struct frame {
             state s;
-            property p;
-            property::key_t k;
+            property_t p;
+            typename property_t::key_t k;
 
             frame(state s) : s(s) {}
-            frame(state s, property p) : s(s), p(p) {}
+            frame(state s, property_t p) : s(s), p(std::move(p)) {}
 
-            void set_value(property&& v) {
+            void set_value(property_t&& v) {
                 if(s == parsing_object) {
                     // assert(!k.empty());
-                    p[std::move(k)] = std::move(v);
+                    std::get<typename property_t::object_t>(p.value).insert_or_assign(
+                        std::move(k), std::move(v));
                 } else if(s == parsing_list) {
-                    ((property::array_t&)p).push_back(std::move(v));
+                    std::get<typename property_t::array_t>(p.value).push_back(std::move(v));
                 } else {
                     p = std::move(v);
-                    if(v.is_array()) {
+                    if(p.is_array()) {
                         s = parsing_list;
                         assert(p.is_empty());
-                    } else if(v.is_object()) {
+                    } else if(p.is_object()) {
                         assert(p.is_empty());
                         s = parsing_object;
                     }
@@ -81,10 +88,10 @@ public:
         auto& top = stack.top();
         switch(stack.top().s) {
             case parsing_object: {
-                stack.emplace(parsing_value);
                 switch(token) {
-                    case TK::tok_rbrace: goto up;
+                    case TK::tok_rbrace: this->eat_token(); goto up;
                     case TK::tok_string: {
+                        stack.emplace(parsing_value);
                         top.k = token.as_string();
                         this->eat_token();
                         auto colon = this->next_token();
@@ -98,20 +105,22 @@ public:
                 }
             }
             case parsing_list: {
-                stack.emplace(parsing_value);
-                if(token == TK::tok_rsquare)
+                if(token == TK::tok_rsquare) {
+                    this->eat_token();
                     goto up;
+                }
+                stack.emplace(parsing_value);
                 goto begin;
             }
             case parsing_value: {
                 switch(token) {
                     case TK::tok_lsquare: {
-                        top.set_value(property::array_t{});
+                        top.set_value(typename property_t::array_t{});
                         this->eat_token();
                         goto begin;
                     }
                     case TK::tok_lbrace: {
-                        top.set_value(property::object_t{});
+                        top.set_value(typename property_t::object_t{});
                         this->eat_token();
                         goto begin;
                     }
@@ -120,7 +129,7 @@ public:
                     case TK::tok_false: top.set_value(false); break;
                     case TK::tok_integer: top.set_value(token.as_integer()); break;
                     case TK::tok_double: top.set_value(token.as_double()); break;
-                    case TK::tok_null: top.set_value(property{}); break;
+                    case TK::tok_null: top.set_value(property_t{}); break;
                     default: { return {}; }
                 }
                 this->eat_token();
@@ -132,8 +141,14 @@ public:
         auto s = stack.top().s;
         auto nt = this->peek_token();
 
+        if constexpr(detail::is_shared_property_v<property_t>) {
+            auto& p = stack.top().p;
+            if(m_pool && (p.is_array() || p.is_object()))
+                p = m_pool->intern(std::move(p));
+        }
+
         if(stack.size() == 1)
-            return stack.top().p;
+            return std::move(stack.top().p);
 
         auto current_property = std::move(stack.top().p);
         stack.pop();
@@ -169,6 +184,9 @@ public:
             return {};
         return res;
     }
+
+private:
+    basic_value_pool<property_t>* m_pool = nullptr;
 };
 
 }    // namespace banshee
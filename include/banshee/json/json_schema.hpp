@@ -0,0 +1,574 @@
+#pragma once
+#include <banshee/json/json_lexer.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace banshee {
+
+// A JSON Schema compiled to a flat program: one node per (sub)schema, pointing into shared
+// tables of member names, required names, allowed values and patterns.
+// The supported keywords are type, properties, additionalProperties, required, items, enum,
+// const, minimum, maximum, exclusiveMinimum, exclusiveMaximum, minLength, maxLength,
+// minItems, maxItems, minProperties, maxProperties and pattern, as well as the true and false
+// schemas. Annotations and unknown keywords are ignored; a schema using another validation
+// keyword does not compile, rather than accepting documents it should reject.
+// enum and const only list scalars. Patterns are ECMAScript regular expressions searched in
+// the utf-8 encoded strings; with BANSHEE_NO_EXCEPTIONS, schemas using pattern do not compile.
+// Documents are checked as they are parsed by a basic_schema_validator.
+template<typename Property = banshee::property>
+class basic_json_schema {
+public:
+    using property_t = Property;
+    using string_t = typename Property::string_t;
+    using array_t = typename Property::array_t;
+    using object_t = typename Property::object_t;
+
+    static_assert(std::is_same_v<string_t, std::string>, "schemas match utf-8 strings");
+
+    // Returns nothing if schema is not a valid schema or uses unsupported keywords
+    static std::optional<basic_json_schema> compile(const Property& schema) {
+        basic_json_schema s;
+        s.m_nodes.resize(2);
+        s.m_nodes[nothing].types = 0;
+        const auto root = s.compile_node(schema);
+        if(!root)
+            return {};
+        s.m_root = *root;
+        return s;
+    }
+
+private:
+    template<typename>
+    friend class basic_schema_validator;
+
+    enum type : std::uint8_t {
+        type_null = 1,
+        type_boolean = 2,
+        type_integer = 4,
+        type_number = 8,
+        type_string = 16,
+        type_array = 32,
+        type_object = 64,
+        type_any = 127,
+    };
+    // Nodes of the true and false schemas
+    static constexpr std::uint32_t any = 0;
+    static constexpr std::uint32_t nothing = 1;
+
+    struct range {
+        std::uint32_t begin = 0;
+        std::uint32_t end = 0;
+    };
+    struct node {
+        std::uint8_t types = type_any;
+        double minimum = -std::numeric_limits<double>::infinity();
+        double maximum = std::numeric_limits<double>::infinity();
+        double exclusive_minimum = -std::numeric_limits<double>::infinity();
+        double exclusive_maximum = std::numeric_limits<double>::infinity();
+        // Strings count code points, arrays elements and objects members
+        std::uint64_t min_size = 0;
+        std::uint64_t max_size = std::numeric_limits<std::uint64_t>::max();
+        range properties;
+        range required;
+        range values;
+        std::uint32_t items = any;
+        std::uint32_t additional = any;
+        std::int32_t pattern = -1;
+    };
+    struct member {
+        std::string name;
+        std::uint32_t node;
+    };
+
+    std::optional<std::uint32_t> compile_node(const Property& schema) {
+        if(schema.is_boolean())
+            return std::get<typename Property::bool_t>(schema.value) ? any : nothing;
+        if(!schema.is_object())
+            return {};
+        node n;
+        for(const auto& [keyword, value] : std::get<object_t>(schema.value)) {
+            if(!compile_keyword(n, keyword, value))
+                return {};
+        }
+        // Draft 4 spelled exclusive bounds as flags on minimum and maximum
+        if(auto* flag = schema.find("exclusiveMinimum"); flag && flag->is_boolean() &&
+                                                         bool(typename Property::bool_t(*flag)))
+            n.exclusive_minimum = std::exchange(n.minimum, -std::numeric_limits<double>::infinity());
+        if(auto* flag = schema.find("exclusiveMaximum"); flag && flag->is_boolean() &&
+                                                         bool(typename Property::bool_t(*flag)))
+            n.exclusive_maximum = std::exchange(n.maximum, std::numeric_limits<double>::infinity());
+        m_nodes.push_back(n);
+        return std::uint32_t(m_nodes.size() - 1);
+    }
+
+    bool compile_keyword(node& n, std::string_view keyword, const Property& value) {
+        if(keyword == "type")
+            return compile_type(n, value);
+        if(keyword == "properties") {
+            if(!value.is_object())
+                return false;
+            std::vector<member> members;
+            for(const auto& [name, schema] : std::get<object_t>(value.value)) {
+                const auto child = compile_node(schema);
+                if(!child)
+                    return false;
+                members.push_back(member{std::string(name), *child});
+            }
+            std::sort(members.begin(), members.end(),
+                      [](const member& a, const member& b) { return a.name < b.name; });
+            n.properties.begin = std::uint32_t(m_members.size());
+            std::move(members.begin(), members.end(), std::back_inserter(m_members));
+            n.properties.end = std::uint32_t(m_members.size());
+            return true;
+        }
+        if(keyword == "required") {
+            if(!value.is_array())
+                return false;
+            n.required.begin = std::uint32_t(m_required.size());
+            for(const auto& name : std::get<array_t>(value.value)) {
+                if(!name.is_string())
+                    return false;
+                m_required.push_back(std::get<string_t>(name.value));
+            }
+            n.required.end = std::uint32_t(m_required.size());
+            return true;
+        }
+        if(keyword == "items" || keyword == "additionalProperties") {
+            const auto child = compile_node(value);
+            if(!child)
+                return false;
+            (keyword == "items" ? n.items : n.additional) = *child;
+            return true;
+        }
+        if(keyword == "enum" || keyword == "const") {
+            const bool list = keyword == "enum";
+            if(list && !value.is_array())
+                return false;
+            n.values.begin = std::uint32_t(m_values.size());
+            if(list)
+                m_values.insert(m_values.end(), std::get<array_t>(value.value).begin(),
+                                std::get<array_t>(value.value).end());
+            else
+                m_values.push_back(value);
+            n.values.end = std::uint32_t(m_values.size());
+            return std::all_of(m_values.begin() + n.values.begin, m_values.end(),
+                               [](const Property& v) { return !v.is_array() && !v.is_object(); });
+        }
+        if(keyword == "minimum" || keyword == "maximum" || keyword == "exclusiveMinimum" ||
+           keyword == "exclusiveMaximum") {
+            if(value.is_boolean() && keyword[0] == 'e')
+                return true;    // see compile_node
+            if(!value.is_number())
+                return false;
+            double& bound = keyword == "minimum"            ? n.minimum
+                            : keyword == "maximum"          ? n.maximum
+                            : keyword == "exclusiveMinimum" ? n.exclusive_minimum
+                                                            : n.exclusive_maximum;
+            bound = double(value);
+            return true;
+        }
+        if(keyword == "minLength" || keyword == "minItems" || keyword == "minProperties" ||
+           keyword == "maxLength" || keyword == "maxItems" || keyword == "maxProperties") {
+            if(!value.is_integral() || std::get<typename Property::integral_t>(value.value) < 0)
+                return false;
+            const auto size = std::uint64_t(std::get<typename Property::integral_t>(value.value));
+            (keyword.substr(0, 3) == "min" ? n.min_size : n.max_size) = size;
+            return true;
+        }
+        if(keyword == "pattern") {
+            if(!value.is_string())
+                return false;
+#ifdef BANSHEE_NO_EXCEPTIONS
+            // std::regex reports invalid patterns by throwing, which would abort
+            return false;
+#else
+            // std::regex reports invalid patterns by throwing
+            try {
+                m_patterns.emplace_back(std::get<string_t>(value.value), std::regex::ECMAScript);
+            } catch(const std::regex_error&) {
+                return false;
+            }
+            n.pattern = std::int32_t(m_patterns.size() - 1);
+            return true;
+#endif
+        }
+        return !is_unsupported(keyword);
+    }
+
+    bool compile_type(node& n, const Property& value) {
+        auto bit = [](const Property& name) -> std::uint8_t {
+            if(!name.is_string())
+                return 0;
+            const auto& s = std::get<string_t>(name.value);
+            if(s == "null")
+                return type_null;
+            if(s == "boolean")
+                return type_boolean;
+            if(s == "integer")
+                return type_integer;
+            if(s == "number")
+                return type_number | type_integer;
+            if(s == "string")
+                return type_string;
+            if(s == "array")
+                return type_array;
+            if(s == "object")
+                return type_object;
+            return 0;
+        };
+        n.types = 0;
+        if(!value.is_array()) {
+            n.types = bit(value);
+            return n.types != 0;
+        }
+        for(const auto& name : std::get<array_t>(value.value)) {
+            const std::uint8_t b = bit(name);
+            if(!b)
+                return false;
+            n.types |= b;
+        }
+        return true;
+    }
+
+    static bool is_unsupported(std::string_view keyword) {
+        constexpr std::string_view keywords[] = {
+            "$ref",          "allOf",          "anyOf",         "oneOf",
+            "not",           "if",             "then",          "else",
+            "multipleOf",    "uniqueItems",    "contains",      "prefixItems",
+            "additionalItems", "patternProperties", "propertyNames", "dependencies",
+            "dependentRequired", "dependentSchemas", "unevaluatedItems",
+            "unevaluatedProperties", "minContains", "maxContains"};
+        return std::find(std::begin(keywords), std::end(keywords), keyword) != std::end(keywords);
+    }
+
+    std::vector<node> m_nodes;
+    std::vector<member> m_members;
+    std::vector<std::string> m_required;
+    std::vector<Property> m_values;
+    std::vector<std::regex> m_patterns;
+    std::uint32_t m_root = any;
+};
+
+// Checks a document against a schema from the stream of its tokens, without building it.
+// Feed every token, or call the member matching each token; the first violation makes every
+// later call return false, and error() names the keyword that rejected the document.
+// Structural errors are left to the parser, which sees the same tokens.
+// The validator keeps its stacks between documents, see reset().
+template<typename Property = banshee::property>
+class basic_schema_validator {
+public:
+    using schema_t = basic_json_schema<Property>;
+    using token_t = detail::json_token<Property>;
+    using TokenKind = typename token_t::TokenKind;
+    using integral_t = typename Property::integral_t;
+    using floating_t = typename Property::floating_t;
+
+    explicit basic_schema_validator(const schema_t& schema) : m_schema(&schema) {}
+
+    // Prepares the validator for a new document, against another schema if one is given
+    void reset() noexcept {
+        m_frames.clear();
+        m_seen.clear();
+        m_error = nullptr;
+        m_started = false;
+    }
+    void reset(const schema_t& schema) noexcept {
+        m_schema = &schema;
+        reset();
+    }
+
+    bool feed(const token_t& token) {
+        switch(token.kind) {
+            case TokenKind::tok_lbrace:
+            case TokenKind::tok_lsquare: return open(token.kind);
+            case TokenKind::tok_rbrace:
+            case TokenKind::tok_rsquare: return close();
+            case TokenKind::tok_string: return string(token.as_string());
+            case TokenKind::tok_integer: return integral(token.as_integer());
+            case TokenKind::tok_double: return floating(token.as_double());
+            case TokenKind::tok_true:
+            case TokenKind::tok_false:
+            case TokenKind::tok_null: return literal(token.kind);
+            default: return !m_error;
+        }
+    }
+
+    bool open(TokenKind k) {
+        const node_t* n = value_node();
+        if(!n)
+            return false;
+        const bool object = k == TokenKind::tok_lbrace;
+        if(!(n->types & (object ? schema_t::type_object : schema_t::type_array)))
+            return fail("type");
+        frame f;
+        f.node = std::uint32_t(n - m_schema->m_nodes.data());
+        f.object = object;
+        f.seen = m_seen.size();
+        if(object)
+            m_seen.resize(m_seen.size() + (n->required.end - n->required.begin));
+        m_frames.push_back(f);
+        return true;
+    }
+
+    bool close() {
+        if(m_error || m_frames.empty())
+            return !m_error;
+        const frame f = m_frames.back();
+        m_frames.pop_back();
+        const node_t& n = m_schema->m_nodes[f.node];
+        if(f.count < n.min_size || f.count > n.max_size)
+            return fail(f.object ? "minProperties/maxProperties" : "minItems/maxItems");
+        if(f.object) {
+            const bool complete =
+                std::all_of(m_seen.begin() + std::ptrdiff_t(f.seen), m_seen.end(),
+                            [](std::uint8_t seen) { return seen != 0; });
+            m_seen.resize(f.seen);
+            if(!complete)
+                return fail("required");
+        }
+        return true;
+    }
+
+    // Keys and string values
+    bool string(std::string_view s) {
+        if(m_error)
+            return false;
+        if(!m_frames.empty() && m_frames.back().object && m_frames.back().expect_key)
+            return key(s);
+        const node_t* n = value_node();
+        if(!n)
+            return false;
+        if(!(n->types & schema_t::type_string))
+            return fail("type");
+        const auto length = std::uint64_t(
+            std::count_if(s.begin(), s.end(), [](char c) { return (std::uint8_t(c) & 0xC0) != 0x80; }));
+        if(length < n->min_size || length > n->max_size)
+            return fail("minLength/maxLength");
+        if(n->pattern >= 0 &&
+           !std::regex_search(s.begin(), s.end(), m_schema->m_patterns[std::size_t(n->pattern)]))
+            return fail("pattern");
+        return check_values(*n, [&](const Property& v) {
+            return v.is_string() && std::get<typename Property::string_t>(v.value) == s;
+        });
+    }
+
+    bool integral(integral_t i) {
+        const node_t* n = value_node();
+        if(!n)
+            return false;
+        if(!(n->types & schema_t::type_integer))
+            return fail("type");
+        return check_number(*n, double(i), [&](const Property& v) {
+            if(v.is_integral())
+                return std::get<integral_t>(v.value) == i;
+            return v.is_double() && std::get<floating_t>(v.value) == double(i);
+        });
+    }
+
+    bool floating(floating_t d) {
+        const node_t* n = value_node();
+        if(!n)
+            return false;
+        // Numbers without a fractional part are integers
+        const bool integer = std::isfinite(d) && std::trunc(d) == d;
+        if(!(n->types & (integer ? schema_t::type_integer : schema_t::type_number)))
+            return fail("type");
+        return check_number(*n, d, [&](const Property& v) { return v.is_number() && double(v) == d; });
+    }
+
+    // true, false and null
+    bool literal(TokenKind k) {
+        const node_t* n = value_node();
+        if(!n)
+            return false;
+        const bool null = k == TokenKind::tok_null;
+        if(!(n->types & (null ? schema_t::type_null : schema_t::type_boolean)))
+            return fail("type");
+        return check_values(*n, [&](const Property& v) {
+            if(null)
+                return v.is_null();
+            return v.is_boolean() &&
+                   std::get<typename Property::bool_t>(v.value) == (k == TokenKind::tok_true);
+        });
+    }
+
+    // Whether no token broke the schema so far
+    explicit operator bool() const noexcept {
+        return !m_error;
+    }
+    // The keyword the document breaks, or nullptr
+    const char* error() const noexcept {
+        return m_error;
+    }
+
+private:
+    using node_t = typename schema_t::node;
+
+    struct frame {
+        std::uint32_t node = 0;
+        // Schema of the value of the last key read
+        std::uint32_t child = 0;
+        // Number of elements or members
+        std::uint64_t count = 0;
+        // Offset in m_seen of the flags of the required members
+        std::size_t seen = 0;
+        bool object = false;
+        bool expect_key = true;
+    };
+
+    bool fail(const char* keyword) noexcept {
+        m_error = keyword;
+        return false;
+    }
+
+    // Returns the schema of the value starting, nullptr once the document is rejected
+    const node_t* value_node() {
+        if(m_error)
+            return nullptr;
+        if(m_frames.empty()) {
+            if(std::exchange(m_started, true)) {
+                fail("document");
+                return nullptr;
+            }
+            return &m_schema->m_nodes[m_schema->m_root];
+        }
+        frame& top = m_frames.back();
+        const node_t& parent = m_schema->m_nodes[top.node];
+        if(top.object) {
+            top.expect_key = true;
+            return &m_schema->m_nodes[top.child];
+        }
+        top.count++;
+        return &m_schema->m_nodes[parent.items];
+    }
+
+    bool key(std::string_view s) {
+        frame& top = m_frames.back();
+        const node_t& n = m_schema->m_nodes[top.node];
+        top.expect_key = false;
+        top.count++;
+        const auto& members = m_schema->m_members;
+        const auto first = members.begin() + n.properties.begin;
+        const auto last = members.begin() + n.properties.end;
+        const auto it = std::lower_bound(first, last, s, [](const auto& m, std::string_view name) {
+            return std::string_view(m.name) < name;
+        });
+        top.child = it != last && it->name == s ? it->node : n.additional;
+        if(top.child == schema_t::nothing)
+            return fail("additionalProperties");
+        for(std::uint32_t i = n.required.begin; i < n.required.end; i++) {
+            if(m_schema->m_required[i] == s)
+                m_seen[top.seen + (i - n.required.begin)] = 1;
+        }
+        return true;
+    }
+
+    template<typename Equal>
+    bool check_number(const node_t& n, double d, Equal&& equal) {
+        if(d < n.minimum || d <= n.exclusive_minimum)
+            return fail("minimum");
+        if(d > n.maximum || d >= n.exclusive_maximum)
+            return fail("maximum");
+        return check_values(n, equal);
+    }
+
+    template<typename Equal>
+    bool check_values(const node_t& n, Equal&& equal) {
+        if(n.values.begin == n.values.end)
+            return true;
+        const auto first = m_schema->m_values.begin() + n.values.begin;
+        const auto last = m_schema->m_values.begin() + n.values.end;
+        if(std::find_if(first, last, equal) == last)
+            return fail("enum");
+        return true;
+    }
+
+    const schema_t* m_schema;
+    std::vector<frame> m_frames;
+    std::vector<std::uint8_t> m_seen;
+    const char* m_error = nullptr;
+    bool m_started = false;
+};
+
+// Passes the tokens of Rng through, checking them against a schema on the way.
+// The first token breaking the schema is replaced by an invalid token, so the parser reading
+// the view stops there and builds nothing more of a document it would have to throw away.
+template<typename Rng>
+class schema_checked_view : public ranges::v3::view_facade<schema_checked_view<Rng>,
+                                                             ranges::finite> {
+public:
+    using token_t = ranges::range_value_type_t<Rng>;
+    using property_t = typename token_t::property_t;
+    using validator_t = basic_schema_validator<property_t>;
+
+    schema_checked_view(Rng& rng, validator_t& validator) :
+        m_rng(&rng),
+        m_validator(&validator) {}
+
+    struct cursor {
+        using iterator_t = decltype(std::begin(std::declval<Rng&>()));
+        using sentinel_t = decltype(std::end(std::declval<Rng&>()));
+
+        cursor() = default;
+        cursor(Rng& rng, validator_t& validator) :
+            m_it(std::begin(rng)),
+            m_end(std::end(rng)),
+            m_validator(&validator) {
+            load();
+        }
+
+        bool equal(ranges::v3::default_sentinel) const {
+            return m_done;
+        }
+        token_t read() const {
+            return m_token;
+        }
+        void next() {
+            if(m_token.kind == token_t::tok_invalid) {
+                m_done = true;
+                return;
+            }
+            ++m_it;
+            load();
+        }
+
+    private:
+        void load() {
+            if(m_it == m_end) {
+                m_done = true;
+                return;
+            }
+            m_token = *m_it;
+            if(!m_validator->feed(m_token))
+                m_token = token_t{token_t::tok_invalid, {}, m_token.offset};
+        }
+
+        iterator_t m_it;
+        sentinel_t m_end;
+        validator_t* m_validator = nullptr;
+        token_t m_token;
+        bool m_done = false;
+    };
+
+    cursor begin_cursor() {
+        return cursor(*m_rng, *m_validator);
+    }
+
+private:
+    Rng* m_rng;
+    validator_t* m_validator;
+};
+
+using json_schema = basic_json_schema<>;
+using schema_validator = basic_schema_validator<>;
+
+}    // namespace banshee
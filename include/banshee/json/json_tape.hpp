@@ -0,0 +1,414 @@
+#pragma once
+#include <banshee/json/json_lexer.hpp>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace banshee {
+
+template<typename PropertyType>
+class basic_parse_context;
+
+// A json document lexed into a flat, contiguous array of entries.
+// Punctuation is not stored: the tape only holds values, keys and brackets, and each
+// opening bracket knows the index of its closing bracket (and vice versa) so consumers can
+// skip whole subtrees in constant time.
+// Strings are stored back to back in a single buffer, entries hold their offset and length.
+template<typename PropertyType = banshee::property>
+class basic_json_tape {
+public:
+    using property_t = PropertyType;
+    using token_t = detail::json_token<PropertyType>;
+    using TokenKind = typename token_t::TokenKind;
+    using string_t = typename property_t::string_t;
+    using integral_t = typename property_t::integral_t;
+    using floating_t = typename property_t::floating_t;
+    using char_type = typename string_t::value_type;
+    using string_view_t = std::basic_string_view<char_type>;
+    static_assert(std::is_trivially_copyable_v<floating_t>,
+                  "the tape stores converted numbers, raw numbers are not supported");
+
+    enum flags : std::uint8_t {
+        // The entry is a key of an object
+        flag_key = 1,
+        // The entry is preceded by a comma
+        flag_follows_value = 2,
+    };
+
+    struct entry {
+        std::uint8_t kind;
+        std::uint8_t flags;
+        // Length of a string in code units, number of elements or members of a container
+        std::uint32_t length;
+        union {
+            integral_t integral;
+            floating_t floating;
+            // Offset of a string in the string buffer
+            std::uint64_t offset;
+            // Index of the matching bracket
+            std::uint64_t match;
+        };
+    };
+
+    class token_view;
+
+    // Fills the tape from a range of json tokens, validating the structure of the document.
+    // Returns false if the tokens do not form exactly one json value.
+    template<typename Rng>
+    bool assign(Rng&& tokens);
+
+    void clear() noexcept {
+        m_entries.clear();
+        m_strings.clear();
+        m_stack.clear();
+    }
+
+    std::size_t size() const noexcept {
+        return m_entries.size();
+    }
+    bool empty() const noexcept {
+        return m_entries.empty();
+    }
+    const entry& operator[](std::size_t index) const noexcept {
+        return m_entries[index];
+    }
+    TokenKind kind(std::size_t index) const noexcept {
+        return TokenKind(m_entries[index].kind);
+    }
+    string_view_t string(std::size_t index) const noexcept {
+        const entry& e = m_entries[index];
+        return string_view_t(m_strings.data() + e.offset, e.length);
+    }
+
+    // Index of the closing bracket of a container, or of the opening bracket of a closing one
+    std::size_t match(std::size_t index) const noexcept {
+        return std::size_t(m_entries[index].match);
+    }
+
+    // Index of the entry following the value starting at index, skipping its children
+    std::size_t skip(std::size_t index) const noexcept {
+        const auto k = kind(index);
+        if(k == TokenKind::tok_lbrace || k == TokenKind::tok_lsquare)
+            return match(index) + 1;
+        return index + 1;
+    }
+
+    // Builds the value starting at index
+    property_t to_property(std::size_t index = 0) const;
+
+    // A range of json tokens replaying the tape, with the punctuation restored
+    token_view tokens() const {
+        return token_view(this);
+    }
+
+private:
+    std::size_t push(TokenKind k, std::uint8_t flags = 0) {
+        entry e;
+        e.kind = std::uint8_t(k);
+        e.flags = flags;
+        e.length = 0;
+        e.offset = 0;
+        m_entries.push_back(e);
+        return m_entries.size() - 1;
+    }
+    token_t token(std::size_t index) const;
+
+    class builder;
+    template<typename>
+    friend class basic_parse_context;
+
+    std::vector<entry> m_entries;
+    string_t m_strings;
+    std::vector<std::size_t> m_stack;
+};
+
+template<typename PropertyType>
+class basic_json_tape<PropertyType>::token_view
+    : public ranges::v3::view_facade<token_view, ranges::finite> {
+    using tape_t = basic_json_tape<PropertyType>;
+
+public:
+    token_view() = default;
+    explicit token_view(const tape_t* tape) : m_tape(tape) {}
+
+    struct cursor {
+        cursor() = default;
+        explicit cursor(const tape_t* tape) : m_tape(tape) {
+            settle();
+        }
+
+        bool equal(ranges::v3::default_sentinel) const {
+            return !m_tape || m_index > m_tape->size();
+        }
+
+        token_t read() const {
+            if(m_index == m_tape->size())
+                return token_t{TokenKind::tok_eof, {}};
+            if(m_phase == phase_comma)
+                return token_t{TokenKind::tok_comma, {}};
+            if(m_phase == phase_colon)
+                return token_t{TokenKind::tok_colon, {}};
+            return m_tape->token(m_index);
+        }
+
+        void next() {
+            if(m_index >= m_tape->size()) {
+                m_index++;
+                return;
+            }
+            if(++m_phase > phase_colon) {
+                m_phase = phase_comma;
+                m_index++;
+            }
+            settle();
+        }
+
+    private:
+        enum : std::uint8_t { phase_comma, phase_entry, phase_colon };
+
+        // Skips the punctuation phases that do not apply to the current entry
+        void settle() {
+            while(m_index < m_tape->size()) {
+                const auto flags = (*m_tape)[m_index].flags;
+                if(m_phase == phase_comma && !(flags & flag_follows_value)) {
+                    m_phase = phase_entry;
+                } else if(m_phase == phase_colon && !(flags & flag_key)) {
+                    m_phase = phase_comma;
+                    m_index++;
+                } else {
+                    return;
+                }
+            }
+        }
+
+        const tape_t* m_tape = nullptr;
+        std::size_t m_index = 0;
+        std::uint8_t m_phase = phase_comma;
+    };
+
+    cursor begin_cursor() const {
+        return cursor(m_tape);
+    }
+
+private:
+    const tape_t* m_tape = nullptr;
+};
+
+// Appends entries to a tape one token at a time, validating the structure of the document.
+// Every call returns false when the token cannot appear at this point.
+template<typename PropertyType>
+class basic_json_tape<PropertyType>::builder {
+public:
+    explicit builder(basic_json_tape& tape) : m_tape(tape) {
+        m_tape.clear();
+    }
+
+    bool open(TokenKind k) {
+        if(m_state != expect::value && m_state != expect::value_or_close)
+            return false;
+        count_value();
+        m_tape.m_stack.push_back(m_tape.push(k, flags()));
+        m_state = k == TokenKind::tok_lbrace ? expect::key_or_close : expect::value_or_close;
+        m_after_comma = false;
+        return true;
+    }
+
+    // k is the kind of the opening bracket
+    bool close(TokenKind k) {
+        const expect first = k == TokenKind::tok_lbrace ? expect::key_or_close
+                                                        : expect::value_or_close;
+        if(m_state != first && m_state != expect::comma_or_close)
+            return false;
+        auto& stack = m_tape.m_stack;
+        if(stack.empty() || m_tape.kind(stack.back()) != k)
+            return false;
+        const std::size_t open_index = stack.back();
+        stack.pop_back();
+        const std::size_t index = m_tape.push(
+            k == TokenKind::tok_lbrace ? TokenKind::tok_rbrace : TokenKind::tok_rsquare);
+        auto& entries = m_tape.m_entries;
+        entries[open_index].match = index;
+        entries[index].match = open_index;
+        m_state = after_value();
+        return true;
+    }
+
+    bool colon() {
+        if(m_state != expect::colon)
+            return false;
+        m_state = expect::value;
+        return true;
+    }
+
+    bool comma() {
+        if(m_state != expect::comma_or_close)
+            return false;
+        m_state = m_tape.kind(m_tape.m_stack.back()) == TokenKind::tok_lbrace ? expect::key
+                                                                              : expect::value;
+        m_after_comma = true;
+        return true;
+    }
+
+    bool string(string_view_t str) {
+        const bool is_key = m_state == expect::key || m_state == expect::key_or_close;
+        if(!is_key && m_state != expect::value && m_state != expect::value_or_close)
+            return false;
+        if(!is_key)
+            count_value();
+        const std::size_t index =
+            m_tape.push(TokenKind::tok_string, flags() | (is_key ? flag_key : 0));
+        m_tape.m_entries[index].offset = m_tape.m_strings.size();
+        m_tape.m_entries[index].length = std::uint32_t(str.size());
+        m_tape.m_strings.append(str);
+        m_state = is_key ? expect::colon : after_value();
+        m_after_comma = false;
+        return true;
+    }
+
+    // true, false and null
+    bool literal(TokenKind k) {
+        return scalar(k) != npos;
+    }
+    bool integral(integral_t i) {
+        const std::size_t index = scalar(TokenKind::tok_integer);
+        if(index != npos)
+            m_tape.m_entries[index].integral = i;
+        return index != npos;
+    }
+    bool floating(floating_t d) {
+        const std::size_t index = scalar(TokenKind::tok_double);
+        if(index != npos)
+            m_tape.m_entries[index].floating = d;
+        return index != npos;
+    }
+
+    // Whether the tokens seen so far form exactly one json value
+    bool done() const noexcept {
+        return m_state == expect::done;
+    }
+
+private:
+    enum class expect { value, value_or_close, comma_or_close, key, key_or_close, colon, done };
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    std::uint8_t flags() const noexcept {
+        return m_after_comma ? flag_follows_value : 0;
+    }
+    expect after_value() const noexcept {
+        return m_tape.m_stack.empty() ? expect::done : expect::comma_or_close;
+    }
+    // Members are counted by their values, not by their keys
+    void count_value() {
+        if(!m_tape.m_stack.empty())
+            m_tape.m_entries[m_tape.m_stack.back()].length++;
+    }
+    std::size_t scalar(TokenKind k) {
+        if(m_state != expect::value && m_state != expect::value_or_close)
+            return npos;
+        count_value();
+        const std::size_t index = m_tape.push(k, flags());
+        m_state = after_value();
+        m_after_comma = false;
+        return index;
+    }
+
+    basic_json_tape& m_tape;
+    expect m_state = expect::value;
+    bool m_after_comma = false;
+};
+
+template<typename PropertyType>
+template<typename Rng>
+bool basic_json_tape<PropertyType>::assign(Rng&& tokens) {
+    builder b(*this);
+    for(auto&& token : tokens) {
+        bool ok;
+        switch(token.kind) {
+            case TokenKind::tok_lbrace:
+            case TokenKind::tok_lsquare: ok = b.open(token.kind); break;
+            case TokenKind::tok_rbrace: ok = b.close(TokenKind::tok_lbrace); break;
+            case TokenKind::tok_rsquare: ok = b.close(TokenKind::tok_lsquare); break;
+            case TokenKind::tok_colon: ok = b.colon(); break;
+            case TokenKind::tok_comma: ok = b.comma(); break;
+            case TokenKind::tok_string: ok = b.string(token.as_string()); break;
+            case TokenKind::tok_integer: ok = b.integral(token.as_integer()); break;
+            case TokenKind::tok_double: ok = b.floating(token.as_double()); break;
+            case TokenKind::tok_true:
+            case TokenKind::tok_false:
+            case TokenKind::tok_null: ok = b.literal(token.kind); break;
+            case TokenKind::tok_eof: return b.done();
+            default: return false;
+        }
+        if(!ok)
+            return false;
+    }
+    return b.done();
+}
+
+template<typename PropertyType>
+auto basic_json_tape<PropertyType>::token(std::size_t index) const -> token_t {
+    const entry& e = m_entries[index];
+    switch(TokenKind(e.kind)) {
+        case TokenKind::tok_string: return token_t{TokenKind::tok_string, string_t(string(index))};
+        case TokenKind::tok_integer: return token_t{TokenKind::tok_integer, e.integral};
+        case TokenKind::tok_double: return token_t{TokenKind::tok_double, e.floating};
+        default: return token_t{TokenKind(e.kind), {}};
+    }
+}
+
+template<typename PropertyType>
+auto basic_json_tape<PropertyType>::to_property(std::size_t index) const -> property_t {
+    struct frame {
+        property_t p;
+        string_t k;
+    };
+    std::vector<frame> stack;
+    property_t current;
+    const std::size_t last = skip(index);
+
+    for(std::size_t i = index; i < last; i++) {
+        const entry& e = m_entries[i];
+        switch(TokenKind(e.kind)) {
+            case TokenKind::tok_lbrace:
+                stack.push_back(frame{typename property_t::object_t{}, {}});
+                continue;
+            case TokenKind::tok_lsquare: {
+                typename property_t::array_t array;
+                array.reserve(e.length);
+                stack.push_back(frame{std::move(array), {}});
+                continue;
+            }
+            case TokenKind::tok_string:
+                if(e.flags & flag_key) {
+                    stack.back().k = string_t(string(i));
+                    continue;
+                }
+                current = string_t(string(i));
+                break;
+            case TokenKind::tok_integer: current = e.integral; break;
+            case TokenKind::tok_double: current = e.floating; break;
+            case TokenKind::tok_true: current = true; break;
+            case TokenKind::tok_false: current = false; break;
+            case TokenKind::tok_null: current = property_t{}; break;
+            case TokenKind::tok_rbrace:
+            case TokenKind::tok_rsquare:
+                current = std::move(stack.back().p);
+                stack.pop_back();
+                break;
+            default: break;
+        }
+        if(stack.empty())
+            return current;
+        frame& top = stack.back();
+        if(top.p.is_object())
+            top.p[std::move(top.k)] = std::move(current);
+        else
+            std::get<typename property_t::array_t>(top.p.value).push_back(std::move(current));
+    }
+    return current;
+}
+
+using json_tape = basic_json_tape<>;
+
+}    // namespace banshee
@@ -0,0 +1,222 @@
+#pragma once
+#include <banshee/detail/charconv.hpp>
+#include <banshee/detail/escape.hpp>
+#include <banshee/unicode.hpp>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#if defined(__SSE2__)
+#    include <emmintrin.h>
+#endif
+
+namespace banshee {
+
+namespace detail {
+    // Returns the first byte of [p, end) which ends a run of verbatim string content: a double
+    // quote, a backslash, a control character or the start of a non ascii character.
+    inline const char* find_string_stop(const char* p, const char* end) noexcept {
+#if defined(__SSE2__)
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i space = _mm_set1_epi8(0x20);
+        while(end - p >= 16) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            // Bytes past 0x7F are negative, the signed comparison catches them with the
+            // control characters
+            const __m128i stop = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                _mm_cmplt_epi8(v, space));
+            const auto mask = std::uint32_t(_mm_movemask_epi8(stop));
+            if(mask)
+                return p + __builtin_ctz(mask);
+            p += 16;
+        }
+#endif
+        while(p != end && std::uint8_t(*p) < 0x80 && !string_stop_table[std::uint8_t(*p)])
+            ++p;
+        return p;
+    }
+}    // namespace detail
+
+// Checks that a utf-8 buffer holds exactly one json value, without building it: no string is
+// decoded, no number converted and no container allocated.
+// Strings must be valid utf-8 and escaped surrogates must be paired, so that the documents
+// accepted are the ones parse_context parses.
+// The validator keeps the stack of open containers between calls, a long lived instance does
+// not allocate once it has seen the deepest document.
+class json_validator {
+public:
+    bool validate(std::string_view text) {
+        enum class expect { value, value_or_close, comma_or_close, key, key_or_close, colon, done };
+        m_stack.clear();
+        const char* const begin = text.data();
+        const char* const end = begin + text.size();
+        const char* p = begin;
+        expect state = expect::value;
+
+        auto fail = [&](const char* at) {
+            m_error_offset = std::size_t(at - begin);
+            return false;
+        };
+        auto after_value = [this] {
+            return m_stack.empty() ? expect::done : expect::comma_or_close;
+        };
+        auto expects_value = [&] {
+            return state == expect::value || state == expect::value_or_close;
+        };
+
+        for(;;) {
+            while(p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t'))
+                ++p;
+            if(p == end)
+                break;
+            switch(*p) {
+                case '{':
+                case '[':
+                    if(!expects_value())
+                        return fail(p);
+                    m_stack.push_back(*p);
+                    state = *p == '{' ? expect::key_or_close : expect::value_or_close;
+                    ++p;
+                    break;
+                case '}':
+                case ']': {
+                    const char open = *p == '}' ? '{' : '[';
+                    const expect first = *p == '}' ? expect::key_or_close : expect::value_or_close;
+                    if((state != first && state != expect::comma_or_close) || m_stack.empty() ||
+                       m_stack.back() != open)
+                        return fail(p);
+                    m_stack.pop_back();
+                    state = after_value();
+                    ++p;
+                    break;
+                }
+                case ':':
+                    if(state != expect::colon)
+                        return fail(p);
+                    state = expect::value;
+                    ++p;
+                    break;
+                case ',':
+                    if(state != expect::comma_or_close)
+                        return fail(p);
+                    state = m_stack.back() == '{' ? expect::key : expect::value;
+                    ++p;
+                    break;
+                case '"': {
+                    const bool is_key = state == expect::key || state == expect::key_or_close;
+                    if(!is_key && !expects_value())
+                        return fail(p);
+                    ++p;
+                    if(!skip_string(p, end))
+                        return fail(p);
+                    state = is_key ? expect::colon : after_value();
+                    break;
+                }
+                case 't':
+                case 'f':
+                case 'n': {
+                    if(!expects_value())
+                        return fail(p);
+                    const std::string_view literal =
+                        *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+                    for(char c : literal) {
+                        if(p == end || *p != c)
+                            return fail(p);
+                        ++p;
+                    }
+                    state = after_value();
+                    break;
+                }
+                case '-':
+                case '0':
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                case '5':
+                case '6':
+                case '7':
+                case '8':
+                case '9': {
+                    if(!expects_value())
+                        return fail(p);
+                    const char* number_end = detail::match_number(p, end);
+                    if(number_end == p)
+                        return fail(p);
+                    if(number_end != end && detail::is_number_char(std::uint8_t(*number_end)))
+                        return fail(number_end);
+                    p = number_end;
+                    state = after_value();
+                    break;
+                }
+                default: return fail(p);
+            }
+        }
+        if(state != expect::done)
+            return fail(end);
+        return true;
+    }
+
+    // Offset of the first byte which cannot be part of a valid document, the size of the text
+    // if it ends too early. Only meaningful after validate returned false.
+    std::size_t error_offset() const noexcept {
+        return m_error_offset;
+    }
+
+private:
+    // p points past the opening quote. On success, p points past the closing quote, otherwise
+    // at the start of the offending character or escape sequence.
+    static bool skip_string(const char*& p, const char* end) noexcept {
+        for(;;) {
+            p = detail::find_string_stop(p, end);
+            if(p == end)
+                return false;
+            const auto c = std::uint8_t(*p);
+            if(c == '"') {
+                ++p;
+                return true;
+            }
+            if(c >= 0x80) {
+                const char* sequence = p;
+                codepoint decoded;
+                if(!next_utf8(p, end, decoded)) {
+                    p = sequence;
+                    return false;
+                }
+                continue;
+            }
+            if(c != '\\' || !skip_escape(p, end))
+                return false;
+        }
+    }
+
+    // p points at a backslash, it is advanced past the escape sequence on success
+    static bool skip_escape(const char*& p, const char* end) noexcept {
+        if(end - p < 2)
+            return false;
+        const auto e = std::uint8_t(p[1]);
+        if(e < 0x80 && detail::json_escape_table[e]) {
+            p += 2;
+            return true;
+        }
+        const char* it = p + 2;
+        char32_t unit;
+        if(e != 'u' || !detail::decode_hex4(it, end, unit) || detail::is_low_surrogate(unit))
+            return false;
+        if(detail::is_high_surrogate(unit)) {
+            if(end - it < 6 || it[0] != '\\' || it[1] != 'u')
+                return false;
+            it += 2;
+            if(!detail::decode_hex4(it, end, unit) || !detail::is_low_surrogate(unit))
+                return false;
+        }
+        p = it;
+        return true;
+    }
+
+    std::vector<char> m_stack;
+    std::size_t m_error_offset = 0;
+};
+
+}    // namespace banshee
@@ -0,0 +1,364 @@
+#pragma once
+#include <banshee/property.hpp>
+#include <banshee/detail/charconv.hpp>
+#include <banshee/detail/escape.hpp>
+#include <charconv>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <unistd.h>
+#include <vector>
+
+namespace banshee {
+
+// Sinks receive the output of a json writer in large chunks.
+// A sink is anything with a bool write(const char* data, std::size_t size) member; returning
+// false stops the writer. A sink that blocks until the data is consumed throttles the writer,
+// whose memory use does not depend on the size of the output.
+
+// A sink can also take the buffers over instead of copying them, by providing
+//   bool exchange(std::unique_ptr<char[]>& buffer, std::size_t size, std::size_t capacity)
+// which consumes the first size bytes of buffer and replaces it by an empty buffer of the same
+// capacity, and bool wait() which returns once all the data is written (see async_file_sink).
+
+namespace detail {
+    template<typename Sink, typename = void>
+    struct is_exchange_sink : std::false_type {};
+    template<typename Sink>
+    struct is_exchange_sink<Sink, std::void_t<decltype(std::declval<Sink&>().exchange(
+                                      std::declval<std::unique_ptr<char[]>&>(), std::size_t(),
+                                      std::size_t()))>> : std::true_type {};
+
+    template<typename Sink, typename = void>
+    struct is_waitable_sink : std::false_type {};
+    template<typename Sink>
+    struct is_waitable_sink<Sink, std::void_t<decltype(std::declval<Sink&>().wait())>>
+        : std::true_type {};
+}    // namespace detail
+
+// Writes to a file descriptor, retrying on partial writes and interruptions
+class fd_sink {
+public:
+    explicit fd_sink(int fd) noexcept : m_fd(fd) {}
+
+    bool write(const char* data, std::size_t size) noexcept {
+        while(size) {
+            const ssize_t written = ::write(m_fd, data, size);
+            if(written < 0) {
+                if(errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += written;
+            size -= std::size_t(written);
+        }
+        return true;
+    }
+
+private:
+    int m_fd;
+};
+
+// Adapts a callable bool(const char*, std::size_t)
+template<typename F>
+class function_sink {
+public:
+    explicit function_sink(F f) : m_f(std::move(f)) {}
+    bool write(const char* data, std::size_t size) {
+        return m_f(data, size);
+    }
+
+private:
+    F m_f;
+};
+
+// Incremental json output.
+// Values are formatted into a fixed size buffer which is handed to the sink when full.
+// A stack with one entry per open array or object checks that calls form a single well
+// formed document: a misplaced call, a non finite number, or a sink failure puts the writer
+// in a failed state in which every call returns false and nothing more is written.
+template<typename Sink>
+class basic_json_writer {
+public:
+    static constexpr std::size_t default_buffer_size = 64 * 1024;
+
+    explicit basic_json_writer(Sink sink, std::size_t buffer_size = default_buffer_size) :
+        m_sink(std::move(sink)),
+        m_buffer(new char[buffer_size]),
+        m_capacity(buffer_size) {}
+    basic_json_writer(const basic_json_writer&) = delete;
+    basic_json_writer& operator=(const basic_json_writer&) = delete;
+
+    // Flushes what is buffered only if it completes the document: a writer destroyed in a
+    // failed state or with arrays or objects still open drops its buffer. Output flushed
+    // before then is not taken back, finish() tells whether the document was written.
+    ~basic_json_writer() {
+        if(m_stack.empty() && m_done)
+            flush();
+    }
+
+    bool begin_object() {
+        return open(state::object_first);
+    }
+    bool end_object() {
+        return close(state::object_first, state::object_key);
+    }
+    bool begin_array() {
+        return open(state::array_first);
+    }
+    bool end_array() {
+        return close(state::array_first, state::array);
+    }
+
+    bool key(std::string_view k) {
+        if(!m_good || m_stack.empty())
+            return fail();
+        state& s = m_stack.back();
+        if(s != state::object_first && s != state::object_key)
+            return fail();
+        if(s == state::object_key)
+            put(',');
+        s = state::object_value;
+        write_string(k);
+        put(':');
+        return m_good;
+    }
+
+    bool value(std::nullptr_t) {
+        return before_value() && put("null", 4);
+    }
+    bool value(bool b) {
+        return before_value() && (b ? put("true", 4) : put("false", 5));
+    }
+    template<typename T,
+             std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    bool value(T i) {
+        if(!before_value())
+            return false;
+        char digits[24];
+        const auto result = std::to_chars(digits, digits + sizeof(digits), i);
+        return put(digits, std::size_t(result.ptr - digits));
+    }
+    template<typename T, std::enable_if_t<std::is_floating_point_v<T>, int> = 0>
+    bool value(T d) {
+        if(!std::isfinite(d))
+            return fail();
+        if(!before_value())
+            return false;
+        char digits[32];
+        return put(digits, detail::format_double(double(d), digits));
+    }
+    // Writes the source text of the number verbatim
+    bool value(const raw_number& n) {
+        if(n.text().empty())
+            return fail();
+        if(!before_value())
+            return false;
+        return put(n.text().data(), n.text().size());
+    }
+    bool value(std::string_view s) {
+        if(!before_value())
+            return false;
+        write_string(s);
+        return m_good;
+    }
+    bool value(const char* s) {
+        return value(std::string_view(s));
+    }
+
+    // Writes a whole property
+    template<typename types>
+    bool value(const basic_property<types>& p);
+
+    // Hands the buffered output to the sink
+    bool flush() {
+        if(m_size && m_good) {
+            bool written;
+            if constexpr(detail::is_exchange_sink<Sink>::value)
+                written = m_sink.exchange(m_buffer, m_size, m_capacity);
+            else
+                written = m_sink.write(m_buffer.get(), m_size);
+            m_good = written;
+        }
+        m_size = 0;
+        return m_good;
+    }
+
+    // Checks that exactly one complete value was written, then flushes and waits for the sink
+    bool finish() {
+        if(!m_good || !m_stack.empty() || !m_done || !flush())
+            return fail();
+        if constexpr(detail::is_waitable_sink<Sink>::value) {
+            if(!m_sink.wait())
+                return fail();
+        }
+        return true;
+    }
+
+    bool good() const noexcept {
+        return m_good;
+    }
+    // Number of arrays and objects open
+    std::size_t depth() const noexcept {
+        return m_stack.size();
+    }
+
+private:
+    enum class state : std::uint8_t { array_first, array, object_first, object_key, object_value };
+
+    bool fail() noexcept {
+        m_good = false;
+        return false;
+    }
+
+    bool before_value() {
+        if(!m_good)
+            return false;
+        if(m_stack.empty()) {
+            if(m_done)
+                return fail();
+            m_done = true;
+            return true;
+        }
+        state& s = m_stack.back();
+        switch(s) {
+            case state::array: put(','); break;
+            case state::array_first: s = state::array; break;
+            case state::object_value: s = state::object_key; break;
+            default: return fail();
+        }
+        return m_good;
+    }
+
+    bool open(state s) {
+        if(!before_value())
+            return false;
+        m_stack.push_back(s);
+        return put(s == state::array_first ? '[' : '{');
+    }
+
+    bool close(state first, state next) {
+        if(!m_good || m_stack.empty() || (m_stack.back() != first && m_stack.back() != next))
+            return fail();
+        m_stack.pop_back();
+        return put(first == state::array_first ? ']' : '}');
+    }
+
+    bool put(char c) {
+        if(m_size == m_capacity && !flush())
+            return false;
+        m_buffer[m_size++] = c;
+        return true;
+    }
+    bool put(const char* data, std::size_t size) {
+        if(size > m_capacity - m_size) {
+            if(!flush())
+                return false;
+            // Too large to be buffered
+            if(size > m_capacity) {
+                if(!m_sink.write(data, size))
+                    return fail();
+                return true;
+            }
+        }
+        std::memcpy(m_buffer.get() + m_size, data, size);
+        m_size += size;
+        return true;
+    }
+
+    // Runs of characters that need no escaping are copied in one go
+    void write_string(std::string_view s) {
+        put('"');
+        std::size_t run = 0;
+        for(std::size_t i = 0; i < s.size(); i++) {
+            const auto c = static_cast<unsigned char>(s[i]);
+            if(c >= 0x80 || !detail::string_stop_table[c])
+                continue;
+            put(s.data() + run, i - run);
+            run = i + 1;
+            char escape[6] = {'\\', 0, '0', '0', 0, 0};
+            std::size_t size = 2;
+            switch(c) {
+                case '"': escape[1] = '"'; break;
+                case '\\': escape[1] = '\\'; break;
+                case '\b': escape[1] = 'b'; break;
+                case '\f': escape[1] = 'f'; break;
+                case '\n': escape[1] = 'n'; break;
+                case '\r': escape[1] = 'r'; break;
+                case '\t': escape[1] = 't'; break;
+                default:
+                    escape[1] = 'u';
+                    escape[4] = "0123456789abcdef"[c >> 4];
+                    escape[5] = "0123456789abcdef"[c & 0xF];
+                    size = 6;
+            }
+            put(escape, size);
+        }
+        put(s.data() + run, s.size() - run);
+        put('"');
+    }
+
+    Sink m_sink;
+    std::unique_ptr<char[]> m_buffer;
+    std::size_t m_capacity;
+    std::size_t m_size = 0;
+    std::vector<state> m_stack;
+    bool m_done = false;
+    bool m_good = true;
+};
+
+template<typename Sink>
+template<typename types>
+bool basic_json_writer<Sink>::value(const basic_property<types>& p) {
+    using property_t = basic_property<types>;
+    return std::visit(
+        detail::overloaded{
+            [this](const std::monostate&) { return value(nullptr); },
+            [this](const typename property_t::bool_t& b) { return value(bool(b)); },
+            [this](const typename property_t::integral_t& i) { return value(i); },
+            [this](const typename property_t::floating_t& d) { return value(d); },
+            [this](const typename property_t::string_t& s) { return value(std::string_view(s)); },
+            [this](const typename property_t::array_t& array) {
+                if(!begin_array())
+                    return false;
+                // Packed numbers are written without making a property of each
+                if constexpr(detail::is_packed_array_v<typename property_t::array_t>) {
+                    if(!array.integers().empty() || !array.doubles().empty()) {
+                        for(const auto i : array.integers()) {
+                            if(!value(i))
+                                return false;
+                        }
+                        for(const auto d : array.doubles()) {
+                            if(!value(d))
+                                return false;
+                        }
+                        return end_array();
+                    }
+                }
+                for(const auto& e : array) {
+                    if(!value(e))
+                        return false;
+                }
+                return end_array();
+            },
+            [this](const typename property_t::object_t& object) {
+                if(!begin_object())
+                    return false;
+                for(const auto& member : object) {
+                    if(!key(member.first) || !value(member.second))
+                        return false;
+                }
+                return end_object();
+            }},
+        p.value);
+}
+
+using json_writer = basic_json_writer<fd_sink>;
+
+}    // namespace banshee
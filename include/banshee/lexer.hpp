@@ -3,27 +3,25 @@
 #include <variant>
 #include <string_view>
 #include <vector>
+#include <array>
+#include <cassert>
 #include <map>
 #include <utility>
 #include <iostream>
 #include <range/v3/view_facade.hpp>
+#include <range/v3/utility/iterator_concepts.hpp>
 #include <cedilla/detail/unicode_base_view.hpp>
 #include <banshee/detail/generator.hpp>
+#include <banshee/detail/charconv.hpp>
+#include <banshee/detail/escape.hpp>
+#include <banshee/line_index.hpp>
+#include <banshee/raw_number.hpp>
 #include <banshee/unicode.hpp>
 
 
 namespace banshee {
 
 namespace detail {
-    struct Pos {
-        std::size_t line, pos;
-    };
-    inline std::ostream& operator<<(std::ostream& os, const Pos& pos) {
-        os << pos.line << ":" << pos.pos;
-        return os;
-    }
-
-
     struct basic_types {
         using bool_t = bool;
         using char_t = char;
@@ -40,6 +38,8 @@ public:
     using token_t = Token;
     using token_stream_t = cppcoro::generator<const token_t>;
     using string_t = typename Types::string_t;
+    // Strings are read into a plain string, then moved into string_t
+    using buffer_t = std::basic_string<typename string_t::value_type>;
     using floating_t = typename Types::floating_t;
     using integral_t = typename Types::integral_t;
     using codepoint = typename ranges::v3::value_type_t<Rng>;
@@ -51,53 +51,127 @@ protected:
     using sentinel_t = decltype(std::end(m_rng));
 
     token_stream_t m_stream;
+    iterator_t m_first;
     iterator_t m_it;
     sentinel_t m_end;
-    std::size_t line = 0;
-    std::size_t pos = 0;
-    std::vector<codepoint> m_parsed;
 
-    bool at_end() {
-        return m_it == m_end && m_parsed.empty();
+    // Lookahead: random access ranges are read in place, other ranges push the characters
+    // they peek at into a small ring.
+    static constexpr bool direct_lookahead =
+        ranges::RandomAccessIterator<iterator_t>() && ranges::SizedSentinel<sentinel_t, iterator_t>();
+    static constexpr std::size_t lookahead_size = 4;
+    std::array<codepoint, lookahead_size> m_lookahead;
+    std::uint8_t m_lookahead_begin = 0;
+    std::uint8_t m_lookahead_count = 0;
+
+    // Positions are not tracked: random access ranges compute offsets from their iterators,
+    // other ranges count the characters read.
+    std::size_t m_consumed = 0;
+    // Built on the first call to position(). Ranges with data() are searched in place.
+    template<typename R, typename = void>
+    struct is_contiguous : std::false_type {};
+    template<typename R>
+    struct is_contiguous<R, std::void_t<decltype(std::declval<R&>().data())>> : std::true_type {};
+    static constexpr bool contiguous = is_contiguous<std::remove_reference_t<Rng>>::value;
+    using line_index_t = line_index<std::conditional_t<contiguous, const codepoint*, iterator_t>>;
+    std::optional<line_index_t> m_lines;
+
+    // Sources which can end early, such as files read through a stream buffer, have a
+    // failed() member: once their end is reached, the lexers emit tok_invalid instead of tok_eof.
+    template<typename R, typename = void>
+    struct can_fail : std::false_type {};
+    template<typename R>
+    struct can_fail<R, std::void_t<decltype(std::declval<const R&>().failed())>>
+        : std::true_type {};
+    bool source_failed() const {
+        if constexpr(can_fail<std::remove_reference_t<Rng>>::value)
+            return m_rng.failed();
+        else
+            return false;
     }
-    codepoint getchar() {
-        codepoint c;
-        if(!m_parsed.empty()) {
-            c = m_parsed.back();
-            m_parsed.pop_back();
-        } else {
-            c = *m_it;
-            ++m_it;
+
+    bool at_end() noexcept {
+        if constexpr(direct_lookahead)
+            return m_it == m_end;
+        else
+            return m_lookahead_count == 0 && m_it == m_end;
+    }
+    codepoint getchar() noexcept {
+        if constexpr(!direct_lookahead) {
+            m_consumed++;
+            if(m_lookahead_count) {
+                const codepoint c = m_lookahead[m_lookahead_begin];
+                m_lookahead_begin = (m_lookahead_begin + 1) % lookahead_size;
+                m_lookahead_count--;
+                return c;
+            }
         }
-        line++;
+        const codepoint c = *m_it;
+        ++m_it;
         return c;
     }
-    codepoint peekchar(std::size_t n = 1) {
-        while(m_parsed.size() < n) {
-            m_parsed.insert(m_parsed.begin(), *m_it);
-            m_it++;
+    // Returns the nth next character without consuming it, or 0 past the end of the input.
+    codepoint peekchar(std::size_t n = 1) noexcept {
+        assert(n > 0 && n <= lookahead_size);
+        if constexpr(direct_lookahead) {
+            return std::size_t(m_end - m_it) >= n ? m_it[n - 1] : codepoint(0);
+        } else {
+            while(m_lookahead_count < n) {
+                if(m_it == m_end)
+                    return codepoint(0);
+                m_lookahead[(m_lookahead_begin + m_lookahead_count) % lookahead_size] = *m_it;
+                ++m_it;
+                m_lookahead_count++;
+            }
+            return m_lookahead[(m_lookahead_begin + n - 1) % lookahead_size];
         }
-        return m_parsed[m_parsed.size() - n];
     }
 
 
-    bool parse_escape_sequence(string_t& out, const codepoint& starting_with);
-    bool parse_number(double_t& d, const codepoint& starting_with);
-    using Pos = detail::Pos;
+    bool parse_string(buffer_t& out, const codepoint& quote, bool long_string = false) noexcept;
+    bool parse_escape_sequence(buffer_t& out, const codepoint& starting_with) noexcept;
+    bool parse_hex4(char32_t& out) noexcept;
+    detail::number_kind parse_number(integral_t& i, floating_t& d,
+                                     const codepoint& starting_with) noexcept;
     using TokenKind = typename token_t::TokenKind;
-    token_t make_token(TokenKind tk) const;
+    token_t make_token(TokenKind tk, std::size_t offset) const;
     template<typename Value>
-    token_t make_token(TokenKind, Value&& v, Pos begin, Pos end) const;
-    token_t make_token(TokenKind, Pos begin, Pos end) const;
+    token_t make_token(TokenKind, Value&& v, std::size_t offset) const;
 
 public:
     lexer_base_view(Rng&& rng) :
         m_rng(std::forward<Rng>(rng)),
-        m_it(std::begin(m_rng)),
+        m_first(std::begin(m_rng)),
+        m_it(m_first),
         m_end(std::end(m_rng)) {
         m_stream = static_cast<Derived*>(this)->token_stream();
     }
 
+    // Offset of the next character to read, counted in characters of the range. Once parsing
+    // stops, this is where it stopped.
+    std::size_t offset() const noexcept {
+        if constexpr(direct_lookahead)
+            return std::size_t(m_it - m_first);
+        else
+            return m_consumed;
+    }
+
+    // Line and column of an offset, such as the offset of a token.
+    // Only random access ranges have positions, calling this on other ranges does not compile:
+    // their characters are gone once read, and positions are not tracked while lexing. Callers
+    // which need positions in such a range keep its text and build a line_index over it.
+    text_position position(std::size_t offset) {
+        static_assert(direct_lookahead,
+                      "position() needs a random access range, use a line_index over the text");
+        if(!m_lines) {
+            if constexpr(contiguous)
+                m_lines.emplace(m_rng.data(), m_rng.data() + (m_end - m_first));
+            else
+                m_lines.emplace(m_first, m_first + (m_end - m_first));
+        }
+        return m_lines->position(offset);
+    }
+
     struct cursor {
         token_stream_t* m_stream = nullptr;
 
@@ -129,70 +203,147 @@ public:
 };
 
 template<typename Rng, typename Derived, typename Token, typename Types>
-bool lexer_base_view<Rng, Derived, Token, Types>::parse_number(double_t& d,
-                                                               const codepoint& starting_with) {
-    std::string buffer;
-    buffer.reserve(5);
-    char c = starting_with;
-    bool leading = c == '0';
-    bool previous_isDigit = isdigit(c);
-
-    while(true) {
-        buffer.push_back(c);
-        if(this->at_end())
+detail::number_kind lexer_base_view<Rng, Derived, Token, Types>::parse_number(
+    integral_t& i, floating_t& d, const codepoint& starting_with) noexcept {
+    char buffer[detail::max_number_length];
+    std::size_t size = 0;
+    buffer[size++] = char(starting_with);
+    while(!this->at_end()) {
+        const codepoint c = peekchar();
+        if(!detail::is_number_char(c))
             break;
-        c = peekchar();
-        const bool isDigit = isdigit(c);
-        const bool isExp = c == 'E' || c == 'e';
-
-        if(!(isDigit || isExp || c == '.' || c == '-' || c == '+'))
-            break;
-
-        const char previous = buffer[buffer.size() - 1];
-
-        if(leading && previous == '0' && isDigit)
-            return false;
+        if(size == detail::max_number_length)
+            return detail::number_kind::invalid;
+        buffer[size++] = char(this->getchar());
+    }
+    // Raw numbers are only checked, they are converted when read
+    if constexpr(detail::is_raw_number_v<floating_t>) {
+        auto number = raw_number::parse(std::string_view(buffer, size));
+        if(!number)
+            return detail::number_kind::invalid;
+        d = std::move(*number);
+        return detail::number_kind::floating;
+    } else {
+        return detail::parse_number(buffer, buffer + size, i, d);
+    }
+}
 
-        if(isExp && previous == '.')
+template<typename Rng, typename Derived, typename Token, typename Types>
+bool lexer_base_view<Rng, Derived, Token, Types>::parse_hex4(char32_t& out) noexcept {
+    char32_t value = 0;
+    for(int i = 0; i < 4; i++) {
+        if(this->at_end())
             return false;
-
-        if(c == '.' && !previous_isDigit)
+        const int digit = detail::hex_digit_value(this->getchar());
+        if(digit < 0)
             return false;
+        value = (value << 4) | char32_t(digit);
+    }
+    out = value;
+    return true;
+}
 
-        if(c != '0')
-            leading = false;
-        previous_isDigit = isDigit;
+// Reads a string up to and including the closing quote.
+// Code points are utf-8 encoded into a local buffer which is appended to out in bulk.
+// Long strings end with three quotes and may contain line breaks, tabs and lone quotes.
+template<typename Rng, typename Derived, typename Token, typename Types>
+bool lexer_base_view<Rng, Derived, Token, Types>::parse_string(buffer_t& out,
+                                                               const codepoint& quote,
+                                                               bool long_string) noexcept {
+    using char_type = typename buffer_t::value_type;
+    constexpr std::size_t run_size = 64;
+    char_type run[run_size];
+    std::size_t size = 0;
+    char32_t high_surrogate = 0;
+
+    auto flush = [&] {
+        out.append(run, size);
+        size = 0;
+    };
+    auto put = [&](codepoint c) {
+        if constexpr(sizeof(char_type) == 1) {
+            if(size + 4 > run_size)
+                flush();
+            size += banshee::encode_utf8(run + size, c);
+        } else {
+            flush();
+            banshee::push_back(out, c);
+        }
+    };
 
-        c = this->getchar();
+    while(!this->at_end()) {
+        const codepoint c = this->getchar();
+        if(c < 0x80 && !detail::string_stop_table[c] && c != quote && !high_surrogate) {
+            run[size++] = char_type(c);
+            if(size == run_size)
+                flush();
+            continue;
+        }
+        if(c == '\\' && !this->at_end()) {
+            const codepoint e = this->getchar();
+            if(e == 'u') {
+                char32_t unit;
+                if(!parse_hex4(unit))
+                    return false;
+                // Surrogates must come in pairs, lone ones cannot be encoded in utf-8
+                if(high_surrogate) {
+                    if(!detail::is_low_surrogate(unit))
+                        return false;
+                    put(surrogate_pair_to_codepoint(std::exchange(high_surrogate, 0), unit));
+                    continue;
+                }
+                if(detail::is_low_surrogate(unit))
+                    return false;
+                if(detail::is_high_surrogate(unit))
+                    high_surrogate = unit;
+                else
+                    put(unit);
+                continue;
+            }
+            if(high_surrogate)
+                return false;
+            if(e < 0x80 && detail::json_escape_table[e]) {
+                put(codepoint(detail::json_escape_table[e]));
+                continue;
+            }
+            flush();
+            if(!Token::extended_escapes || !parse_escape_sequence(out, e))
+                return false;
+            continue;
+        }
+        if(high_surrogate)
+            return false;
+        if(c == quote) {
+            if(!long_string) {
+                flush();
+                return true;
+            }
+            if(peekchar(1) == quote && peekchar(2) == quote) {
+                this->getchar();
+                this->getchar();
+                flush();
+                return true;
+            }
+        } else if(c == '\\' || (c <= 0x1F && !long_string) ||
+                  (c <= 0x1F && c != '\n' && c != '\r' && c != '\t')) {
+            return false;
+        }
+        put(c);
     }
-    if(buffer.size() > 0 && buffer[buffer.size() - 1] == '.')
-        return false;
-    if(buffer.size() == 1 && buffer[0] == '-')
-        return false;
-
-    char* end;
-    d = std::strtold(buffer.c_str(), &end);    // may throw
-    return end == buffer.c_str() + buffer.size();
+    return false;
 }
 
-
 template<typename Rng, typename Derived, typename Token, typename Types>
 bool lexer_base_view<Rng, Derived, Token, Types>::parse_escape_sequence(
-    string_t& out, const codepoint& starting_with) {
+    buffer_t& out, const codepoint& starting_with) noexcept {
+    if(starting_with < 0x80 && detail::ici_escape_table[starting_with]) {
+        out.push_back(detail::ici_escape_table[starting_with]);
+        return true;
+    }
     switch(starting_with) {
-        case 'b': banshee::push_back(out, '\b'); return true;
-        case 'f': banshee::push_back(out, '\f'); return true;
-        case 'n': banshee::push_back(out, '\n'); return true;
-        case 'r': banshee::push_back(out, '\r'); return true;
-        case 't': banshee::push_back(out, '\t'); return true;
-        case 'v': banshee::push_back(out, '\v'); return true;
-        case '"': banshee::push_back(out, '"'); return true;
-        case '/': banshee::push_back(out, '/'); return true;
-        case '\'': banshee::push_back(out, '\''); return true;
-        case '\\': banshee::push_back(out, '\\'); return true;
         case '0': {
-            if(!std::isdigit(peekchar())) {
-                banshee::push_back(out, '\\');
+            if(this->at_end() || !std::isdigit(peekchar())) {
+                banshee::push_back(out, '\0');
                 return true;
             }
             // Octal
@@ -204,55 +355,41 @@ bool lexer_base_view<Rng, Derived, Token, Types>::parse_escape_sequence(
         }
         // unicode
         case 'u': {
-            std::string unicode(4, 0);
-            try {
-                size_t res = 0;
-                for(char i = 0; i < 4; i++)
-                    unicode[i] = this->getchar();
-                char32_t codepoint = std::stoul(unicode, &res, 16);
-                if(res != 4)
-                    return false;
-                if(peekchar(1) == '\\' && peekchar(2) == 'u') {
-                    this->getchar();
-                    this->getchar();
-                    for(char i = 0; i < 4; i++)
-                        unicode[i] = this->getchar();
-
-                    auto low = std::stoul(unicode, &res, 16);
-                    if(res != 4)
-                        return false;
-                    codepoint = surrogate_pair_to_codepoint(codepoint, low);
-                }
-                banshee::push_back(out, codepoint);
-            } catch(std::exception e) {
-                // std::cout << e.what() << unicode << std::endl;
+            char32_t codepoint;
+            if(!parse_hex4(codepoint))
+                return false;
+            if(detail::is_low_surrogate(codepoint))
                 return false;
+            // A high surrogate must be followed by an escaped low surrogate
+            if(detail::is_high_surrogate(codepoint)) {
+                if(peekchar(1) != '\\' || peekchar(2) != 'u')
+                    return false;
+                this->getchar();
+                this->getchar();
+                char32_t low;
+                if(!parse_hex4(low) || !detail::is_low_surrogate(low))
+                    return false;
+                codepoint = surrogate_pair_to_codepoint(codepoint, low);
             }
+            banshee::push_back(out, codepoint);
             return true;
         }
 
         default: return false;
     }
-    assert(false);
-    return false;
 }
 
 template<typename Rng, typename Derived, typename Token, typename Types>
-auto lexer_base_view<Rng, Derived, Token, Types>::make_token(TokenKind tk) const -> token_t {
-    return token_t{tk, {}, Pos{this->line, this->pos}, Pos{this->line, this->pos}};
+auto lexer_base_view<Rng, Derived, Token, Types>::make_token(TokenKind tk,
+                                                             std::size_t offset) const -> token_t {
+    return token_t{tk, {}, offset};
 }
 
 template<typename Rng, typename Derived, typename Token, typename Types>
 template<typename Value>
-auto lexer_base_view<Rng, Derived, Token, Types>::make_token(TokenKind tk, Value&& v, Pos begin,
-                                                             Pos end) const -> token_t {
-    return token_t{tk, std::forward<Value>(v), begin, end};
-}
-
-template<typename Rng, typename Derived, typename Token, typename Types>
-auto lexer_base_view<Rng, Derived, Token, Types>::make_token(TokenKind tk, Pos begin, Pos end) const
-    -> token_t {
-    return Token{tk, {}, begin, end};
+auto lexer_base_view<Rng, Derived, Token, Types>::make_token(TokenKind tk, Value&& v,
+                                                             std::size_t offset) const -> token_t {
+    return token_t{tk, std::forward<Value>(v), offset};
 }
 
 
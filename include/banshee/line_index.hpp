@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace banshee {
+
+// A line and a column, both counted from 1. Columns count the characters of the text.
+struct text_position {
+    std::size_t line = 1;
+    std::size_t column = 1;
+};
+inline std::ostream& operator<<(std::ostream& os, const text_position& p) {
+    return os << p.line << ':' << p.column;
+}
+
+namespace detail {
+    // Appends the offset following each '\n' of [first, last) to starts, first being at offset
+    // base. Compares 16 bytes at a time, and only visits the bytes which are line breaks.
+    template<typename CharT>
+    void find_line_starts(const CharT* first, const CharT* last, std::size_t base,
+                          std::vector<std::size_t>& starts) {
+        const CharT* p = first;
+#ifdef __SSE2__
+        constexpr std::size_t width = sizeof(CharT);
+        if constexpr(width == 1 || width == 2 || width == 4) {
+            constexpr std::size_t lanes = 16 / width;
+            // Each character sets width bits of the mask
+            constexpr unsigned lane_bits = (1u << width) - 1;
+            for(; std::size_t(last - p) >= lanes; p += lanes) {
+                const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                __m128i newlines;
+                if constexpr(width == 1)
+                    newlines = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n'));
+                else if constexpr(width == 2)
+                    newlines = _mm_cmpeq_epi16(chunk, _mm_set1_epi16('\n'));
+                else
+                    newlines = _mm_cmpeq_epi32(chunk, _mm_set1_epi32('\n'));
+                for(unsigned mask = unsigned(_mm_movemask_epi8(newlines)); mask;) {
+                    const unsigned bit = unsigned(__builtin_ctz(mask));
+                    starts.push_back(base + std::size_t(p - first) + bit / width + 1);
+                    mask &= ~(lane_bits << bit);
+                }
+            }
+        }
+#endif
+        for(; p != last; ++p) {
+            if(*p == '\n')
+                starts.push_back(base + std::size_t(p - first) + 1);
+        }
+    }
+}    // namespace detail
+
+// Maps offsets in a text to lines and columns, to report errors from the offsets carried by
+// tokens. Positions are not tracked while lexing: the text is only searched for line breaks
+// when a position is asked for, and only as far as needed. Texts given as pointers are
+// searched with SSE2.
+// The text must stay alive and unchanged while the index is used.
+template<typename Iterator>
+class line_index {
+public:
+    line_index(Iterator first, Iterator last) : m_first(first), m_size(std::size_t(last - first)) {}
+
+    // Offsets past the end of the text are clamped to it
+    text_position position(std::size_t offset) {
+        offset = std::min(offset, m_size);
+        scan(offset);
+        const auto next = std::upper_bound(m_starts.begin(), m_starts.end(), offset);
+        return text_position{std::size_t(next - m_starts.begin()), offset - next[-1] + 1};
+    }
+
+private:
+    // Finds the line breaks before offset, and some more so that looking up the following
+    // tokens does not search again
+    void scan(std::size_t offset) {
+        if(offset <= m_scanned)
+            return;
+        constexpr std::size_t step = 64 * 1024;
+        const std::size_t end = std::min(m_size, std::max(offset, m_scanned + step));
+        if constexpr(std::is_pointer_v<Iterator>) {
+            detail::find_line_starts(m_first + m_scanned, m_first + end, m_scanned, m_starts);
+        } else {
+            for(std::size_t i = m_scanned; i != end; i++) {
+                if(m_first[i] == '\n')
+                    m_starts.push_back(i + 1);
+            }
+        }
+        m_scanned = end;
+    }
+
+    Iterator m_first;
+    std::size_t m_size;
+    // Offsets of the first character of each line found so far
+    std::vector<std::size_t> m_starts{0};
+    std::size_t m_scanned = 0;
+};
+
+}    // namespace banshee
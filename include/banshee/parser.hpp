@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <range/v3/range_concepts.hpp>
 
 namespace banshee {
@@ -9,6 +10,12 @@ public:
     using token_t = typename ranges::range_value_type_t<Rng>;
     parser_base(Rng& rng) : m_rng(rng), m_it(std::begin(m_rng)), m_end(std::end(m_rng)) {}
 
+    // Offset of the last token read from the range. Parsers look at most one token ahead, so
+    // when parsing fails, this is the token it failed on.
+    std::size_t last_offset() const noexcept {
+        return m_last_offset;
+    }
+
 protected:
     std::vector<token_t> m_peeked;
     token_t next_token() {
@@ -20,11 +27,13 @@ protected:
         }
         auto token = std::move(*m_it);
         m_it++;
+        m_last_offset = token.offset;
         return std::move(token);
     }
     const token_t& peek_token() {
         if(m_peeked.empty()) {
             auto tok = std::move(*m_it);
+            m_last_offset = tok.offset;
             m_peeked.push_back(std::move(tok));
             m_it++;
         }
@@ -45,6 +54,7 @@ private:
     Rng& m_rng;
     decltype(std::begin(m_rng)) m_it;
     decltype(std::end(m_rng)) m_end;
+    std::size_t m_last_offset = 0;
 };
 
 }    // namespace banshee
@@ -0,0 +1,573 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <banshee/property.hpp>
+#include <banshee/detail/subtree_hash.hpp>
+
+// Structural diff and patch of property trees:
+//  - diff / apply_patch implement JSON Patch (RFC 6902), paths are JSON Pointers (RFC 6901)
+//  - create_merge_patch / merge_patch implement JSON Merge Patch (RFC 7396)
+
+namespace banshee {
+
+namespace detail {
+
+    // Appends "/token" to a json pointer, escaping '~' and '/'
+    template<typename String, typename Token>
+    void append_pointer_token(String& path, const Token& token) {
+        path.push_back('/');
+        for(auto c : token) {
+            if(c == '~') {
+                path.push_back('~');
+                path.push_back('0');
+            } else if(c == '/') {
+                path.push_back('~');
+                path.push_back('1');
+            } else {
+                path.push_back(c);
+            }
+        }
+    }
+
+    template<typename String>
+    void append_pointer_index(String& path, std::size_t index) {
+        char digits[20];
+        std::size_t size = 0;
+        do {
+            digits[size++] = char('0' + index % 10);
+            index /= 10;
+        } while(index);
+        path.push_back('/');
+        while(size)
+            path.push_back(digits[--size]);
+    }
+
+    // Splits a json pointer into its unescaped reference tokens.
+    // Returns false if the pointer is neither empty nor starts with '/', or has a bad escape.
+    template<typename Char, typename Key>
+    bool split_pointer(std::basic_string_view<Char> pointer, std::vector<Key>& tokens) {
+        tokens.clear();
+        if(pointer.empty())
+            return true;
+        if(pointer[0] != '/')
+            return false;
+        for(std::size_t i = 0; i < pointer.size(); i++) {
+            const Char c = pointer[i];
+            if(c == '/') {
+                tokens.emplace_back();
+            } else if(c == '~') {
+                if(++i == pointer.size() || (pointer[i] != '0' && pointer[i] != '1'))
+                    return false;
+                tokens.back().push_back(pointer[i] == '0' ? Char('~') : Char('/'));
+            } else {
+                tokens.back().push_back(c);
+            }
+        }
+        return true;
+    }
+
+    // Parses an array index token: digits without leading zeros, or "-" (the end of the array)
+    // when allow_end is set. The index must be less than size, or equal to it with allow_end.
+    template<typename Key>
+    bool parse_array_index(const Key& token, std::size_t size, bool allow_end, std::size_t& out) {
+        if(allow_end && token.size() == 1 && token[0] == '-') {
+            out = size;
+            return true;
+        }
+        if(token.empty() || token.size() > 19 || (token[0] == '0' && token.size() > 1))
+            return false;
+        std::size_t index = 0;
+        for(auto c : token) {
+            if(c < '0' || c > '9')
+                return false;
+            index = index * 10 + std::size_t(c - '0');
+        }
+        if(index > size || (index == size && !allow_end))
+            return false;
+        out = index;
+        return true;
+    }
+
+    // Equality as defined by JSON Patch: numbers are equal if their values are, whether they
+    // are integers or not, and so are arrays and objects holding such numbers
+    template<typename Property>
+    bool json_equal(const Property& a, const Property& b) {
+        using integral_t = typename Property::integral_t;
+        using floating_t = typename Property::floating_t;
+        using array_t = typename Property::array_t;
+        using object_t = typename Property::object_t;
+        if(a.is_number() && b.is_number() && a.is_integral() != b.is_integral()) {
+            const Property& i = a.is_integral() ? a : b;
+            const Property& f = a.is_integral() ? b : a;
+            const integral_t integral = std::get<integral_t>(i.value);
+            const double floating = double(std::get<floating_t>(f.value));
+            // Doubles at or beyond 2^63 are not integers of integral_t
+            return floating == double(integral) && floating < 0x1p63 && floating >= -0x1p63 &&
+                   integral_t(floating) == integral;
+        }
+        if(a.is_array() && b.is_array()) {
+            const auto& x = std::get<array_t>(a.value);
+            const auto& y = std::get<array_t>(b.value);
+            return x.size() == y.size() &&
+                   std::equal(x.begin(), x.end(), y.begin(),
+                              [](const Property& l, const Property& r) { return json_equal(l, r); });
+        }
+        if(a.is_object() && b.is_object()) {
+            const auto& x = std::get<object_t>(a.value);
+            const auto& y = std::get<object_t>(b.value);
+            if(x.size() != y.size())
+                return false;
+            for(const auto& member : x) {
+                const Property* other = b.find(member.first);
+                if(!other || !json_equal(member.second, *other))
+                    return false;
+            }
+            return true;
+        }
+        return a == b;
+    }
+
+    template<typename Property>
+    class patch_builder {
+    public:
+        using property_t = Property;
+        using string_t = typename property_t::string_t;
+        using key_t = typename property_t::key_t;
+        using array_t = typename property_t::array_t;
+        using object_t = typename property_t::object_t;
+
+        void diff(const property_t& from, const property_t& to) {
+            if(m_hasher.same(from, to))
+                return;
+            if(from.is_object() && to.is_object())
+                return diff_objects(std::get<object_t>(from.value), std::get<object_t>(to.value));
+            if(from.is_array() && to.is_array())
+                return diff_arrays(std::get<array_t>(from.value), std::get<array_t>(to.value));
+            push("replace", &to);
+        }
+
+        property_t release() {
+            return property_t(std::move(m_operations));
+        }
+
+    private:
+        // Members are sorted by key on both sides, walk them in lockstep
+        void diff_objects(const object_t& from, const object_t& to) {
+            const std::size_t size = m_path.size();
+            auto a = from.begin();
+            auto b = to.begin();
+            while(a != from.end() || b != to.end()) {
+                if(b == to.end() || (a != from.end() && a->first < b->first)) {
+                    append_pointer_token(m_path, a->first);
+                    push("remove", nullptr);
+                    ++a;
+                } else if(a == from.end() || b->first < a->first) {
+                    append_pointer_token(m_path, b->first);
+                    push("add", &b->second);
+                    ++b;
+                } else {
+                    append_pointer_token(m_path, a->first);
+                    diff(a->second, b->second);
+                    ++a;
+                    ++b;
+                }
+                m_path.resize(size);
+            }
+        }
+
+        // Elements equal at both ends are skipped, then the middles are aligned on the hashes
+        // of their elements with Myers' algorithm, in O((N + M) D) for D insertions and
+        // removals. Past max_edit_distance, the middles are diffed pairwise instead.
+        void diff_arrays(const array_t& from, const array_t& to) {
+            std::size_t first = 0;
+            std::size_t from_last = from.size();
+            std::size_t to_last = to.size();
+            while(first < from_last && first < to_last && m_hasher.same(from[first], to[first]))
+                first++;
+            while(from_last > first && to_last > first &&
+                  m_hasher.same(from[from_last - 1], to[to_last - 1])) {
+                from_last--;
+                to_last--;
+            }
+            if(first == from_last || first == to_last ||
+               !align(from, first, from_last, to, first, to_last))
+                pairwise(from, first, from_last, to, first, to_last, first);
+        }
+
+        enum class edit : std::uint8_t { keep, remove, insert };
+
+        // Computes the shortest edit script between from[a, a_last) and to[b, b_last)
+        // and emits it. Returns false if it is longer than max_edit_distance.
+        bool align(const array_t& from, std::size_t a, std::size_t a_last, const array_t& to,
+                   std::size_t b, std::size_t b_last) {
+            constexpr std::ptrdiff_t max_edit_distance = 256;
+            const std::ptrdiff_t n = std::ptrdiff_t(a_last - a);
+            const std::ptrdiff_t m = std::ptrdiff_t(b_last - b);
+            const std::ptrdiff_t max = std::min(n + m, max_edit_distance);
+
+            std::vector<std::uint64_t> from_hashes(std::size_t(n), 0);
+            std::vector<std::uint64_t> to_hashes(std::size_t(m), 0);
+            for(std::ptrdiff_t i = 0; i < n; i++)
+                from_hashes[std::size_t(i)] = m_hasher(from[a + std::size_t(i)]);
+            for(std::ptrdiff_t i = 0; i < m; i++)
+                to_hashes[std::size_t(i)] = m_hasher(to[b + std::size_t(i)]);
+
+            // v[k + max] is the furthest x reached on diagonal k, one copy is kept per step
+            const std::size_t width = std::size_t(2 * max + 1);
+            std::vector<std::ptrdiff_t> trace;
+            std::vector<std::ptrdiff_t> v(width + 2, 0);
+            std::ptrdiff_t d = 0;
+            for(;; d++) {
+                if(d > max)
+                    return false;
+                trace.insert(trace.end(), v.begin() + 1, v.end() - 1);
+                bool done = false;
+                for(std::ptrdiff_t k = -d; k <= d && !done; k += 2) {
+                    auto at = [&](std::ptrdiff_t diagonal) -> std::ptrdiff_t& {
+                        return v[std::size_t(diagonal + max + 1)];
+                    };
+                    std::ptrdiff_t x =
+                        (k == -d || (k != d && at(k - 1) < at(k + 1))) ? at(k + 1) : at(k - 1) + 1;
+                    std::ptrdiff_t y = x - k;
+                    while(x < n && y < m &&
+                          from_hashes[std::size_t(x)] == to_hashes[std::size_t(y)]) {
+                        x++;
+                        y++;
+                    }
+                    at(k) = x;
+                    done = x >= n && y >= m;
+                }
+                if(done)
+                    break;
+            }
+
+            // Walk the trace backwards to recover the script
+            // Built backwards; nested diffs run during the replay, so it cannot be shared
+            std::vector<edit> script;
+            std::ptrdiff_t x = n, y = m;
+            for(; d > 0; d--) {
+                const std::ptrdiff_t* prev = trace.data() + std::size_t(d) * width;
+                auto at = [&](std::ptrdiff_t diagonal) { return prev[diagonal + max]; };
+                const std::ptrdiff_t k = x - y;
+                const bool down = k == -d || (k != d && at(k - 1) < at(k + 1));
+                const std::ptrdiff_t prev_k = down ? k + 1 : k - 1;
+                const std::ptrdiff_t prev_x = at(prev_k);
+                const std::ptrdiff_t prev_y = prev_x - prev_k;
+                while(x > prev_x + (down ? 0 : 1) && y > prev_y + (down ? 1 : 0)) {
+                    script.push_back(edit::keep);
+                    x--;
+                    y--;
+                }
+                script.push_back(down ? edit::insert : edit::remove);
+                x = prev_x;
+                y = prev_y;
+            }
+            for(; x > 0 && y > 0; x--, y--)
+                script.push_back(edit::keep);
+
+            // Replay the script forwards, index is the position in the patched array
+            std::reverse(script.begin(), script.end());
+            const std::size_t size = m_path.size();
+            std::size_t index = a;
+            for(std::size_t i = 0; i < script.size();) {
+                if(script[i] == edit::keep) {
+                    // Equal hashes are confirmed here
+                    append_pointer_index(m_path, index);
+                    diff(from[a++], to[b++]);
+                    m_path.resize(size);
+                    index++;
+                    i++;
+                    continue;
+                }
+                // Removals and insertions between two kept elements replace each other
+                std::size_t removed = 0, inserted = 0;
+                for(; i < script.size() && script[i] != edit::keep; i++)
+                    (script[i] == edit::remove ? removed : inserted)++;
+                pairwise(from, a, a + removed, to, b, b + inserted, index);
+                a += removed;
+                b += inserted;
+                index += inserted;
+            }
+            return true;
+        }
+
+        // Diffs from[a, a_last) and to[b, b_last) element wise, then removes (from the back) or
+        // adds the rest. index is the position of from[a] in the patched array.
+        void pairwise(const array_t& from, std::size_t a, std::size_t a_last, const array_t& to,
+                      std::size_t b, std::size_t b_last, std::size_t index) {
+            const std::size_t size = m_path.size();
+            const std::size_t common = std::min(a_last - a, b_last - b);
+            for(std::size_t i = 0; i < common; i++) {
+                append_pointer_index(m_path, index + i);
+                diff(from[a + i], to[b + i]);
+                m_path.resize(size);
+            }
+            for(std::size_t i = a_last - a; i > common; i--) {
+                append_pointer_index(m_path, index + i - 1);
+                push("remove", nullptr);
+                m_path.resize(size);
+            }
+            for(std::size_t i = common; i < b_last - b; i++) {
+                append_pointer_index(m_path, index + i);
+                push("add", &to[b + i]);
+                m_path.resize(size);
+            }
+        }
+
+        void push(const char* op, const property_t* value) {
+            object_t operation;
+            operation.insert_or_assign(key_t("op"), property_t(string_t(op)));
+            operation.insert_or_assign(key_t("path"), property_t(string_t(m_path)));
+            if(value)
+                operation.insert_or_assign(key_t("value"), *value);
+            m_operations.push_back(property_t(std::move(operation)));
+        }
+
+        subtree_hasher<property_t> m_hasher;
+        std::basic_string<typename string_t::value_type> m_path;
+        array_t m_operations;
+    };
+
+    template<typename Property>
+    class patch_applier {
+    public:
+        using property_t = Property;
+        using string_t = typename property_t::string_t;
+        using key_t = typename property_t::key_t;
+        using key_view_t = typename property_t::key_view_t;
+        using array_t = typename property_t::array_t;
+        using object_t = typename property_t::object_t;
+
+        explicit patch_applier(property_t& document) : m_document(document) {}
+
+        bool apply(const property_t& operation) {
+            const property_t* op = operation.find("op");
+            const property_t* path = operation.find("path");
+            if(!op || !op->is_string() || !path || !path->is_string())
+                return false;
+            const auto& name = std::get<string_t>(op->value);
+            if(!split_pointer(key_view_t(std::get<string_t>(path->value)), m_path))
+                return false;
+
+            if(name == "add" || name == "replace" || name == "test") {
+                const property_t* value = operation.find("value");
+                if(!value)
+                    return false;
+                if(name == "add")
+                    return add(m_path, property_t(*value));
+                property_t* target = resolve(m_path);
+                if(!target)
+                    return false;
+                if(name == "test")
+                    return json_equal(*target, *value);
+                *target = *value;
+                return true;
+            }
+            if(name == "remove")
+                return remove(m_path, nullptr);
+
+            if(name == "move" || name == "copy") {
+                const property_t* from = operation.find("from");
+                if(!from || !from->is_string() ||
+                   !split_pointer(key_view_t(std::get<string_t>(from->value)), m_from))
+                    return false;
+                property_t value;
+                if(name == "copy") {
+                    const property_t* source = resolve(m_from);
+                    if(!source)
+                        return false;
+                    value = *source;
+                } else {
+                    // A value cannot be moved into one of its children
+                    if(m_from.size() < m_path.size() &&
+                       std::equal(m_from.begin(), m_from.end(), m_path.begin()))
+                        return false;
+                    if(!remove(m_from, &value))
+                        return false;
+                }
+                return add(m_path, std::move(value));
+            }
+            return false;
+        }
+
+    private:
+        using tokens_t = std::vector<std::basic_string<typename key_view_t::value_type>>;
+
+        property_t* resolve(const tokens_t& tokens, std::size_t count) {
+            property_t* p = &m_document;
+            for(std::size_t i = 0; i < count; i++) {
+                if(p->is_object()) {
+                    auto& object = mutable_container(std::get<object_t>(p->value));
+                    auto it = object.find(tokens[i]);
+                    if(it == object.end())
+                        return nullptr;
+                    p = &it->second;
+                } else if(p->is_array()) {
+                    auto& array = mutable_container(std::get<array_t>(p->value));
+                    std::size_t index;
+                    if(!parse_array_index(tokens[i], array.size(), false, index))
+                        return nullptr;
+                    p = &array[index];
+                } else {
+                    return nullptr;
+                }
+            }
+            return p;
+        }
+        property_t* resolve(const tokens_t& tokens) {
+            return resolve(tokens, tokens.size());
+        }
+
+        bool add(const tokens_t& tokens, property_t&& value) {
+            if(tokens.empty()) {
+                m_document = std::move(value);
+                return true;
+            }
+            property_t* parent = resolve(tokens, tokens.size() - 1);
+            if(!parent)
+                return false;
+            if(parent->is_object()) {
+                std::get<object_t>(parent->value).insert_or_assign(tokens.back(), std::move(value));
+                return true;
+            }
+            if(parent->is_array()) {
+                auto& array = mutable_container(std::get<array_t>(parent->value));
+                std::size_t index;
+                if(!parse_array_index(tokens.back(), array.size(), true, index))
+                    return false;
+                array.insert(array.begin() + index, std::move(value));
+                return true;
+            }
+            return false;
+        }
+
+        // Removes the value at tokens, moving it into removed if not null
+        bool remove(const tokens_t& tokens, property_t* removed) {
+            if(tokens.empty())
+                return false;
+            property_t* parent = resolve(tokens, tokens.size() - 1);
+            if(!parent)
+                return false;
+            if(parent->is_object()) {
+                auto& object = mutable_container(std::get<object_t>(parent->value));
+                auto it = object.find(tokens.back());
+                if(it == object.end())
+                    return false;
+                if(removed)
+                    *removed = std::move(it->second);
+                object.erase(it);
+                return true;
+            }
+            if(parent->is_array()) {
+                auto& array = mutable_container(std::get<array_t>(parent->value));
+                std::size_t index;
+                if(!parse_array_index(tokens.back(), array.size(), false, index))
+                    return false;
+                if(removed)
+                    *removed = std::move(array[index]);
+                array.erase(array.begin() + index);
+                return true;
+            }
+            return false;
+        }
+
+        property_t& m_document;
+        tokens_t m_path;
+        tokens_t m_from;
+    };
+
+    template<typename Property>
+    void merge_patch_into(Property& target, const Property& patch) {
+        using object_t = typename Property::object_t;
+        if(!patch.is_object()) {
+            target = patch;
+            return;
+        }
+        if(!target.is_object())
+            target = object_t{};
+        auto& object = std::get<object_t>(target.value);
+        for(const auto& member : std::get<object_t>(patch.value)) {
+            if(member.second.is_null()) {
+                object.erase(member.first);
+            } else {
+                merge_patch_into(object[member.first], member.second);
+            }
+        }
+    }
+
+    template<typename Property>
+    Property create_merge_patch(subtree_hasher<Property>& hasher, const Property& from,
+                                const Property& to) {
+        using object_t = typename Property::object_t;
+        if(!from.is_object() || !to.is_object())
+            return to;
+        const auto& a = std::get<object_t>(from.value);
+        const auto& b = std::get<object_t>(to.value);
+        object_t patch;
+        for(const auto& member : a) {
+            if(!b.count(member.first))
+                patch.insert_or_assign(member.first, Property{});
+        }
+        for(const auto& member : b) {
+            auto it = a.find(member.first);
+            if(it == a.end())
+                patch.insert_or_assign(member.first, member.second);
+            else if(!hasher.same(it->second, member.second))
+                patch.insert_or_assign(member.first,
+                                       create_merge_patch(hasher, it->second, member.second));
+        }
+        return Property(std::move(patch));
+    }
+
+}    // namespace detail
+
+// Returns a JSON Patch (an array of operations) transforming from into to.
+// Identical subtrees are detected by their hashes and produce no operation. Each subtree is
+// hashed once, and equal hashes are confirmed by a deep comparison, which together take time
+// linear in the size of both documents. On top of that, arrays that differ other than at their
+// ends are aligned in O((N + M) D) for N and M elements and D insertions and removals; past
+// D = 256, their elements are diffed pairwise instead.
+template<typename types>
+basic_property<types> diff(const basic_property<types>& from, const basic_property<types>& to) {
+    detail::patch_builder<basic_property<types>> builder;
+    builder.diff(from, to);
+    return builder.release();
+}
+
+// Applies a JSON Patch to document.
+// Operations are applied in sequence to a copy of the document; if any of them fails,
+// document is left untouched and false is returned.
+template<typename types>
+bool apply_patch(basic_property<types>& document, const basic_property<types>& patch) {
+    using array_t = typename basic_property<types>::array_t;
+    if(!patch.is_array())
+        return false;
+    basic_property<types> result = document;
+    detail::patch_applier<basic_property<types>> applier(result);
+    for(const auto& operation : std::get<array_t>(patch.value)) {
+        if(!operation.is_object() || !applier.apply(operation))
+            return false;
+    }
+    document = std::move(result);
+    return true;
+}
+
+// Applies a JSON Merge Patch to target
+template<typename types>
+void merge_patch(basic_property<types>& target, const basic_property<types>& patch) {
+    detail::merge_patch_into(target, patch);
+}
+
+// Returns a JSON Merge Patch transforming from into to.
+// Merge patches cannot set a member to null: null members of to are removed instead.
+template<typename types>
+basic_property<types> create_merge_patch(const basic_property<types>& from,
+                                         const basic_property<types>& to) {
+    detail::subtree_hasher<basic_property<types>> hasher;
+    return detail::create_merge_patch(hasher, from, to);
+}
+
+}    // namespace banshee
@@ -2,7 +2,13 @@
 #include <string>
 #include <map>
 #include <variant>
+#include <string_view>
+#include <banshee/detail/cow.hpp>
+#include <banshee/detail/indexed_map.hpp>
+#include <banshee/detail/packed_array.hpp>
+#include <banshee/detail/shared_string.hpp>
 #include <banshee/detail/util.hpp>
+#include <banshee/raw_number.hpp>
 namespace banshee {
 
 namespace detail {
@@ -16,20 +22,62 @@ namespace detail {
         using key_type = string_type;
         template<typename... Args>
         using array_type = std::vector<Args...>;
+        // Transparent, so that members can be looked up by string views
+        template<typename Key, typename T>
+        using object_type = std::map<Key, T, std::less<>>;
+    };
+
+    // Objects build a hash index when large ones are searched, see indexed_map
+    template<typename char_type>
+    struct indexed_types : types<char_type> {
+        template<typename... Args>
+        using object_type = indexed_map<Args...>;
+    };
+
+    // Strings, arrays and objects are shared between copies, containers are cloned on write
+    template<typename char_type>
+    struct cow_types : types<char_type> {
+        using string_type = shared_string<char_type>;
+        using key_type = string_type;
+        template<typename... Args>
+        using array_type = cow<std::vector<Args...>>;
+        template<typename Key, typename T>
+        using object_type = cow<std::map<Key, T, std::less<>>>;
+    };
+
+    // Numbers keep their source text and are converted when read, see raw_number.
+    // Every number parsed is a floating_type, raw_number::is_integral tells integers apart.
+    template<typename char_type>
+    struct raw_number_types : types<char_type> {
+        using floating_type = raw_number;
+    };
+
+    // Arrays of only integers or only doubles are stored packed, see packed_array
+    template<typename char_type>
+    struct packed_types : types<char_type> {
         template<typename... Args>
-        using object_type = std::map<Args...>;
+        using array_type = packed_array<Args...>;
     };
 
 
     template<typename T, typename types, typename array_type, typename object_type>
-    std::enable_if_t<std::is_integral_v<std::decay_t<T>>, typename types::integral_type>
+    std::enable_if_t<std::is_same_v<std::decay_t<T>, bool>, typename types::bool_type>
+    to_compatible_value(T&& t) {
+        return t;
+    }
+
+    template<typename T, typename types, typename array_type, typename object_type>
+    std::enable_if_t<std::is_integral_v<std::decay_t<T>> && !std::is_same_v<std::decay_t<T>, bool>,
+                     typename types::integral_type>
     to_compatible_value(T&& t) {
         static_assert(sizeof(typename types::integral_type) >= sizeof(T));
         return t;
     }
 
     template<typename T, typename types, typename array_type, typename object_type>
-    std::enable_if_t<std::is_floating_point_v<std::decay_t<T>>, typename types::floating_type>
+    std::enable_if_t<std::is_floating_point_v<std::decay_t<T>> ||
+                         std::is_same_v<std::decay_t<T>, typename types::floating_type>,
+                     typename types::floating_type>
     to_compatible_value(T&& t) {
         static_assert(sizeof(typename types::floating_type) >= sizeof(T));
         return std::forward<T>(t);
@@ -82,6 +130,7 @@ public:
     using floating_t = typename types::floating_type;
     using string_t = typename types::string_type;
     using key_t = typename types::key_type;
+    using key_view_t = std::basic_string_view<typename key_t::value_type>;
     using array_t = typename types::template array_type<this_t>;
     using object_t = typename types::template object_type<key_t, this_t>;
 
@@ -224,8 +273,18 @@ public:
         return std::get<array_t>(value)[idx];
     }
 
-    const basic_property<types>& operator[](const key_t& key) const {
-        return std::get<object_t>(value)[key];
+    // Returns a null property if key is not a member
+    const basic_property<types>& operator[](key_view_t key) const {
+        const auto* p = find(key);
+        return p ? *p : null_property();
+    }
+    // Returns nullptr if this is not an object or key is not a member
+    const basic_property<types>* find(key_view_t key) const {
+        if(!is_object())
+            return nullptr;
+        const auto& object = std::get<object_t>(value);
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &it->second;
     }
     basic_property<types>& operator[](const key_t& key) {
         if(!is_object())
@@ -286,11 +345,8 @@ public:
         if(oi == i) {    // same type
             if(is_null())
                 return true;
-            if(is_number() || is_boolean() || is_string()) {
-                return t.value == value;
-            }
-            // Todo compare array
-            return false;
+            // Arrays and objects compare element wise (and members in key order)
+            return t.value == value;
 
         } else if((is_number() || is_boolean()) && (t.is_number() || t.is_boolean())) {
             return t.value == value;
@@ -319,6 +375,12 @@ public:
         return value;
     }
 
+private:
+    static const this_t& null_property() noexcept {
+        static const this_t null_value;
+        return null_value;
+    }
+
 public:
     basic_property(dict&& d) : value(std::move(d.obj)) {}
     basic_property(list&& d) : value(std::move(d.array)) {}
@@ -358,7 +420,7 @@ public:
         template<typename... Args>
         list(Args&&... args) {
             array.reserve(sizeof...(Args));
-            array.emplace_back(args...);
+            (array.emplace_back(std::forward<Args>(args)), ...);
         }
 
     private:
@@ -409,5 +471,13 @@ std::ostream& operator<<(std::ostream& os, const basic_property<types>& p) {
 }
 
 using property = basic_property<detail::types<char>>;
+// A property whose lookups in large objects are O(1), see detail::indexed_map
+using indexed_property = basic_property<detail::indexed_types<char>>;
+// A property whose copies are O(1), see detail::cow
+using shared_property = basic_property<detail::cow_types<char>>;
+// A property whose numbers are converted on first access and written back verbatim
+using raw_property = basic_property<detail::raw_number_types<char>>;
+// A property whose numeric arrays take 8 bytes per element
+using packed_property = basic_property<detail::packed_types<char>>;
 
 }    // namespace banshee
@@ -0,0 +1,323 @@
+#pragma once
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <banshee/detail/charconv.hpp>
+
+namespace banshee {
+
+// A json number kept as its source text.
+// Parsing a number only checks its syntax; it is converted to an integer or a double the
+// first time it is read and the result is cached. The text is kept, so the exact value is
+// never lost: large ids and decimal amounts can be read digit by digit through to_decimal,
+// and writers emit the text verbatim.
+// Texts of up to 24 characters, which covers 64 bits integers and doubles, are stored inline
+// so that copying a number does not allocate. The cache is atomic: a raw_number shared
+// between threads (see snapshot) can be read from all of them.
+class raw_number {
+public:
+    // The exact value, digits * 10^exponent. digits has neither leading nor trailing zeros,
+    // it is empty for zero.
+    struct decimal {
+        bool negative = false;
+        std::string digits;
+        long long exponent = 0;
+
+        friend bool operator==(const decimal& a, const decimal& b) {
+            return a.negative == b.negative && a.exponent == b.exponent && a.digits == b.digits;
+        }
+        friend bool operator!=(const decimal& a, const decimal& b) {
+            return !(a == b);
+        }
+    };
+
+    raw_number() : m_integral(true) {
+        assign("0");
+    }
+
+    // Non finite doubles have no text, writers reject them
+    raw_number(double d) : m_integral(false) {
+        if(std::isfinite(d)) {
+            char digits[32];
+            assign(std::string_view(digits, detail::format_double(d, digits)));
+        }
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        store_cache(bits);
+    }
+
+    raw_number(const raw_number& other) : m_integral(other.m_integral) {
+        copy_text(other);
+        copy_cache(other);
+    }
+    raw_number(raw_number&& other) noexcept : m_integral(other.m_integral) {
+        move_text(other);
+        copy_cache(other);
+    }
+    raw_number& operator=(const raw_number& other) {
+        if(this != &other) {
+            copy_text(other);
+            m_integral = other.m_integral;
+            copy_cache(other);
+        }
+        return *this;
+    }
+    raw_number& operator=(raw_number&& other) noexcept {
+        if(this != &other) {
+            move_text(other);
+            m_integral = other.m_integral;
+            copy_cache(other);
+        }
+        return *this;
+    }
+
+    // Returns nothing unless text is exactly one json number
+    static std::optional<raw_number> parse(std::string_view text) {
+        const char* first = text.data();
+        const char* last = first + text.size();
+        if(first == last || detail::match_number(first, last) != last)
+            return std::nullopt;
+        return raw_number(text, fits_int64(first, last));
+    }
+
+    std::string_view text() const noexcept {
+        return std::string_view(m_heap ? m_heap.get() : m_inline, m_size);
+    }
+
+    // Whether the text is an integer which fits in 64 bits, the numbers which a property
+    // would hold as an integral_t
+    bool is_integral() const noexcept {
+        return m_integral;
+    }
+
+    // Same conversions as a double: integers are exact, other numbers are truncated
+    template<typename T,
+             std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    operator T() const {
+        if constexpr(std::is_integral_v<T>) {
+            if(is_integral())
+                return T(to_int64());
+        }
+        return T(to_double());
+    }
+
+    // The value if the number is a whole number which fits in 64 bits, whatever its spelling
+    // (10, 1e1 or 10.0)
+    std::optional<std::int64_t> exact_integral() const {
+        if(is_integral())
+            return to_int64();
+        const auto d = to_decimal();
+        if(d.exponent < 0)
+            return std::nullopt;
+        std::uint64_t magnitude = 0;
+        constexpr auto max = std::numeric_limits<std::uint64_t>::max();
+        auto push = [&](unsigned digit) {
+            if(magnitude > (max - digit) / 10)
+                return false;
+            magnitude = magnitude * 10 + digit;
+            return true;
+        };
+        for(char c : d.digits) {
+            if(!push(unsigned(c - '0')))
+                return std::nullopt;
+        }
+        for(long long i = 0; i < d.exponent; i++) {
+            if(!push(0))
+                return std::nullopt;
+        }
+        constexpr auto limit = std::uint64_t(std::numeric_limits<std::int64_t>::max());
+        if(magnitude > limit + (d.negative ? 1 : 0))
+            return std::nullopt;
+        return d.negative ? -std::int64_t(magnitude - 1) - 1 : std::int64_t(magnitude);
+    }
+
+    decimal to_decimal() const {
+        decimal d;
+        const std::string_view text = this->text();
+        const char* p = text.data();
+        const char* last = p + text.size();
+        d.negative = p != last && *p == '-';
+        if(d.negative)
+            ++p;
+        for(; p != last && *p >= '0' && *p <= '9'; ++p)
+            d.digits += *p;
+        if(p != last && *p == '.') {
+            for(++p; p != last && *p >= '0' && *p <= '9'; ++p) {
+                d.digits += *p;
+                --d.exponent;
+            }
+        }
+        if(p != last && (*p == 'e' || *p == 'E')) {
+            ++p;
+            const bool negative = p != last && *p == '-';
+            if(p != last && (*p == '+' || *p == '-'))
+                ++p;
+            // Far beyond any double, keeps the exponent from overflowing
+            long long e = 0;
+            for(; p != last && *p >= '0' && *p <= '9'; ++p) {
+                if(e < 1000000000)
+                    e = e * 10 + (*p - '0');
+            }
+            d.exponent += negative ? -e : e;
+        }
+        const auto leading = d.digits.find_first_not_of('0');
+        if(leading == std::string::npos)
+            return decimal{};
+        const auto trailing = d.digits.find_last_not_of('0');
+        d.exponent += (long long)(d.digits.size() - trailing - 1);
+        d.digits = d.digits.substr(leading, trailing - leading + 1);
+        return d;
+    }
+
+    // Numbers are equal when they have the same exact value, however they are spelled
+    friend bool operator==(const raw_number& a, const raw_number& b) {
+        if(a.text() == b.text() && a.m_size)
+            return true;
+        if(a.is_integral() && b.is_integral())
+            return a.to_int64() == b.to_int64();
+        if(!a.m_size || !b.m_size)
+            return a.to_double() == b.to_double();
+        return a.to_decimal() == b.to_decimal();
+    }
+    friend bool operator!=(const raw_number& a, const raw_number& b) {
+        return !(a == b);
+    }
+
+    template<typename T,
+             std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    friend bool operator==(const raw_number& n, const T& t) {
+        if constexpr(std::is_integral_v<T>) {
+            if(n.is_integral())
+                return n.to_int64() == t;
+        }
+        return n.to_double() == t;
+    }
+    template<typename T,
+             std::enable_if_t<std::is_arithmetic_v<T> && !std::is_same_v<T, bool>, int> = 0>
+    friend bool operator!=(const raw_number& n, const T& t) {
+        return !(n == t);
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const raw_number& n) {
+        if(!n.m_size)
+            return os << n.to_double();
+        return os << n.text();
+    }
+
+private:
+    static constexpr std::size_t inline_capacity = 24;
+
+    raw_number(std::string_view text, bool integral) : m_integral(integral) {
+        assign(text);
+    }
+
+    void assign(std::string_view text) {
+        if(text.size() > inline_capacity) {
+            auto heap = std::make_unique<char[]>(text.size());
+            std::memcpy(heap.get(), text.data(), text.size());
+            m_heap = std::move(heap);
+        } else {
+            m_heap.reset();
+            std::memcpy(m_inline, text.data(), text.size());
+        }
+        m_size = std::uint32_t(text.size());
+    }
+    // Inline texts are copied whole, a fixed size copy is cheaper
+    void copy_text(const raw_number& other) {
+        if(other.m_heap)
+            return assign(other.text());
+        m_heap.reset();
+        std::memcpy(m_inline, other.m_inline, inline_capacity);
+        m_size = other.m_size;
+    }
+    // A moved from number which had a long text is left empty
+    void move_text(raw_number& other) noexcept {
+        m_heap = std::move(other.m_heap);
+        std::memcpy(m_inline, other.m_inline, inline_capacity);
+        m_size = other.m_size;
+        if(m_heap)
+            other.m_size = 0;
+    }
+
+    // [first, last) is a valid json number. Integers which do not fit in 64 bits are not
+    // integral, as with detail::parse_number, and neither is -0.
+    static bool fits_int64(const char* first, const char* last) noexcept {
+        const bool negative = *first == '-';
+        const char* digits = first + (negative ? 1 : 0);
+        for(const char* p = digits; p != last; ++p) {
+            if(*p < '0' || *p > '9')
+                return false;
+        }
+        const auto size = std::size_t(last - digits);
+        if(size < 19)
+            return !(negative && *digits == '0');
+        return size == 19 &&
+               std::memcmp(digits, negative ? "9223372036854775808" : "9223372036854775807",
+                           size) <= 0;
+    }
+
+    // Integers cache their int64_t value, other numbers their double
+    double to_double() const noexcept {
+        if(m_integral)
+            return double(to_int64());
+        if(m_cached.load(std::memory_order_acquire)) {
+            const std::uint64_t bits = m_cache.load(std::memory_order_relaxed);
+            double d;
+            std::memcpy(&d, &bits, sizeof(d));
+            return d;
+        }
+        std::int64_t i;
+        double d;
+        const std::string_view text = this->text();
+        detail::parse_number(text.data(), text.data() + text.size(), i, d);
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        store_cache(bits);
+        return d;
+    }
+
+    std::int64_t to_int64() const noexcept {
+        if(!m_integral)
+            return std::int64_t(to_double());
+        if(m_cached.load(std::memory_order_acquire))
+            return std::int64_t(m_cache.load(std::memory_order_relaxed));
+        std::int64_t i = 0;
+        double d;
+        const std::string_view text = this->text();
+        detail::parse_number(text.data(), text.data() + text.size(), i, d);
+        store_cache(std::uint64_t(i));
+        return i;
+    }
+
+    void store_cache(std::uint64_t bits) const noexcept {
+        m_cache.store(bits, std::memory_order_relaxed);
+        m_cached.store(true, std::memory_order_release);
+    }
+    void copy_cache(const raw_number& other) noexcept {
+        const bool cached = other.m_cached.load(std::memory_order_acquire);
+        m_cache.store(other.m_cache.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        m_cached.store(cached, std::memory_order_relaxed);
+    }
+
+    char m_inline[inline_capacity] = {};
+    std::unique_ptr<char[]> m_heap;
+    std::uint32_t m_size = 0;
+    bool m_integral;
+    mutable std::atomic<bool> m_cached{false};
+    mutable std::atomic<std::uint64_t> m_cache{0};
+};
+
+namespace detail {
+    template<typename T>
+    constexpr bool is_raw_number_v = std::is_same_v<T, raw_number>;
+}    // namespace detail
+
+}    // namespace banshee
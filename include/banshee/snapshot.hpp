@@ -0,0 +1,192 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <banshee/property.hpp>
+
+namespace banshee {
+
+// An immutable view of a property tree.
+// The tree is owned by a shared, const root: a frozen property can be copied and read from
+// any number of threads, and none of its lookups can modify the tree.
+// Missing members and out of range elements are null.
+template<typename Property>
+class basic_frozen_property {
+public:
+    using property_t = Property;
+    using key_t = typename Property::key_t;
+    using key_view_t = typename Property::key_view_t;
+    using size_type = typename Property::array_t::size_type;
+
+    basic_frozen_property() = default;
+    explicit basic_frozen_property(Property&& p) :
+        m_root(std::make_shared<const Property>(std::move(p))),
+        m_node(m_root.get()) {}
+    explicit basic_frozen_property(std::shared_ptr<const Property> root) :
+        m_root(std::move(root)),
+        m_node(m_root.get()) {}
+
+    bool is_null() const noexcept {
+        return !m_node || m_node->is_null();
+    }
+    bool is_boolean() const noexcept {
+        return m_node && m_node->is_boolean();
+    }
+    bool is_integral() const noexcept {
+        return m_node && m_node->is_integral();
+    }
+    bool is_double() const noexcept {
+        return m_node && m_node->is_double();
+    }
+    bool is_number() const noexcept {
+        return m_node && m_node->is_number();
+    }
+    bool is_string() const noexcept {
+        return m_node && m_node->is_string();
+    }
+    bool is_array() const noexcept {
+        return m_node && m_node->is_array();
+    }
+    bool is_object() const noexcept {
+        return m_node && m_node->is_object();
+    }
+
+    std::size_t size() const {
+        return m_node ? m_node->size() : 0;
+    }
+
+    basic_frozen_property operator[](size_type idx) const {
+        if(!is_array() || idx >= size())
+            return child(nullptr);
+        return child(&(*m_node)[idx]);
+    }
+    basic_frozen_property operator[](key_view_t key) const {
+        return child(m_node ? m_node->find(key) : nullptr);
+    }
+    std::optional<basic_frozen_property> find(key_view_t key) const {
+        const Property* p = m_node ? m_node->find(key) : nullptr;
+        if(!p)
+            return {};
+        return child(p);
+    }
+
+    explicit operator bool() const {
+        return m_node && bool(*m_node);
+    }
+    template<typename T, typename = decltype(T(std::declval<const Property&>()))>
+    explicit operator T() const {
+        return T(get());
+    }
+
+    // The underlying value, valid as long as a frozen property of the same tree is alive
+    const Property& get() const noexcept {
+        static const Property null_value;
+        return m_node ? *m_node : null_value;
+    }
+
+private:
+    basic_frozen_property child(const Property* node) const {
+        basic_frozen_property p;
+        p.m_root = m_root;
+        p.m_node = node;
+        return p;
+    }
+
+    std::shared_ptr<const Property> m_root;
+    const Property* m_node = nullptr;
+};
+
+// Publishes successive versions of a document to concurrent readers.
+// Readers get the current snapshot and keep it alive for as long as they hold it, while a
+// writer prepares and publishes the next version. Publishing only swaps a pointer, so readers
+// never wait for a version to be built, and neither current() nor publish() takes a lock.
+// The current version is held by a node whose address shares one atomic word with the number
+// of readers copying it (a split reference count). A reader increments the word, copies the
+// version and decrements the word again; if a writer swapped the node out in between, the
+// writer has moved that number to the node's own count, which the reader decrements instead.
+// Whoever releases the last reference to a node deletes it.
+// The number takes the 16 high bits of the word, above the 48 bits of user space addresses on
+// x86-64 and aarch64, which allows 65535 calls to current() at the same time.
+template<typename Property>
+class snapshot_publisher {
+public:
+    using snapshot_t = basic_frozen_property<Property>;
+
+    snapshot_publisher() : m_current(pack(new node)) {}
+    explicit snapshot_publisher(Property&& p) : snapshot_publisher() {
+        publish(std::move(p));
+    }
+    snapshot_publisher(const snapshot_publisher&) = delete;
+    snapshot_publisher& operator=(const snapshot_publisher&) = delete;
+    ~snapshot_publisher() {
+        delete unpack(m_current.load(std::memory_order_acquire));
+    }
+
+    snapshot_t current() const {
+        const std::uint64_t word = m_current.fetch_add(one_reader, std::memory_order_acquire);
+        node* const n = unpack(word);
+        // The count in the word keeps n alive
+        snapshot_t snapshot(n->value);
+        std::uint64_t expected = word + one_reader;
+        while(!m_current.compare_exchange_weak(expected, expected - one_reader,
+                                               std::memory_order_release,
+                                               std::memory_order_relaxed)) {
+            if(unpack(expected) != n) {
+                release(n, -1);
+                break;
+            }
+        }
+        return snapshot;
+    }
+
+    void publish(Property&& p) {
+        auto* next = new node;
+        next->value = std::make_shared<const Property>(std::move(p));
+        const std::uint64_t word = m_current.exchange(pack(next), std::memory_order_acq_rel);
+        // Readers still copying the previous version release it themselves
+        release(unpack(word), long(word >> pointer_bits));
+    }
+
+    // Publishes the result of parse(), which returns an optional property,
+    // and keeps the current snapshot if it fails.
+    template<typename F>
+    bool publish_from(F&& parse) {
+        auto p = std::forward<F>(parse)();
+        if(!p)
+            return false;
+        publish(std::move(*p));
+        return true;
+    }
+
+private:
+    static_assert(sizeof(void*) == sizeof(std::uint64_t), "pointers must fit in 48 bits");
+    static constexpr unsigned pointer_bits = 48;
+    static constexpr std::uint64_t pointer_mask = (std::uint64_t(1) << pointer_bits) - 1;
+    static constexpr std::uint64_t one_reader = std::uint64_t(1) << pointer_bits;
+
+    struct node {
+        std::shared_ptr<const Property> value;
+        // References to the node which are not counted in m_current. It goes below 0 when
+        // readers release it before the writer which swapped it out adds their number.
+        std::atomic<long> refs{0};
+    };
+
+    static std::uint64_t pack(node* n) noexcept {
+        return std::uint64_t(reinterpret_cast<std::uintptr_t>(n));
+    }
+    static node* unpack(std::uint64_t word) noexcept {
+        return reinterpret_cast<node*>(std::uintptr_t(word & pointer_mask));
+    }
+    static void release(node* n, long count) noexcept {
+        if(n->refs.fetch_add(count, std::memory_order_acq_rel) + count == 0)
+            delete n;
+    }
+
+    mutable std::atomic<std::uint64_t> m_current;
+};
+
+using frozen_property = basic_frozen_property<property>;
+
+}    // namespace banshee
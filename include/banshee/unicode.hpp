@@ -1,35 +1,110 @@
 #pragma once
 #include <experimental/text_view>
+#include <cstdint>
+#include <cstring>
+#include <string>
 
 namespace banshee {
 using codepoint = std::experimental::text::unicode_character_set::code_point_type;
 
-inline void push_back(std::string& string, codepoint c) {
+// Writes the utf-8 encoding of c at out, which must have room for 4 code units.
+// Returns the number of code units written.
+inline std::size_t encode_utf8(char* out, codepoint c) noexcept {
     if(c <= 0x7F) {
-        string.push_back(c);
-        return;
+        out[0] = char(c);
+        return 1;
     }
     if(c <= 0x7FF) {
-        string.reserve(2);
-        string.push_back(0xC0 | (c >> 6));
-        string.push_back(0x80 | (c & 0x3F));
-        return;
+        out[0] = char(0xC0 | (c >> 6));
+        out[1] = char(0x80 | (c & 0x3F));
+        return 2;
     }
     if(c <= 0xFFFF) {
-        string.reserve(3);
-        string.push_back(0xE0 | c >> 12);
-        string.push_back(0x80 | ((c >> 6) & 0x3F));
-        string.push_back(0x80 | (c & 0x3F));
-        return;
+        out[0] = char(0xE0 | (c >> 12));
+        out[1] = char(0x80 | ((c >> 6) & 0x3F));
+        out[2] = char(0x80 | (c & 0x3F));
+        return 3;
     }
     if(c <= 0x10FFFF) {
-        string.reserve(4);
-        string.push_back(0xF0 | (c >> 18));
-        string.push_back(0xE0 | ((c >> 12) & 0x3F));
-        string.push_back(0x80 | ((c >> 6) & 0x3F));
-        string.push_back(0x80 | (c & 0x3F));
+        out[0] = char(0xF0 | (c >> 18));
+        out[1] = char(0x80 | ((c >> 12) & 0x3F));
+        out[2] = char(0x80 | ((c >> 6) & 0x3F));
+        out[3] = char(0x80 | (c & 0x3F));
+        return 4;
+    }
+    return 0;
+}
+
+// Decodes the utf-8 sequence starting at first, advancing first past it.
+// Returns false on malformed input: truncated or overlong sequences, surrogates and code
+// points past 0x10FFFF.
+inline bool next_utf8(const char*& first, const char* last, codepoint& c) noexcept {
+    const auto lead = static_cast<unsigned char>(*first++);
+    if(lead < 0x80) {
+        c = lead;
+        return true;
+    }
+    std::size_t size;
+    codepoint min;
+    if((lead & 0xE0) == 0xC0) {
+        size = 1, c = lead & 0x1F, min = 0x80;
+    } else if((lead & 0xF0) == 0xE0) {
+        size = 2, c = lead & 0x0F, min = 0x800;
+    } else if((lead & 0xF8) == 0xF0) {
+        size = 3, c = lead & 0x07, min = 0x10000;
+    } else {
+        return false;
+    }
+    if(std::size_t(last - first) < size)
+        return false;
+    for(std::size_t i = 0; i < size; i++) {
+        const auto trail = static_cast<unsigned char>(*first++);
+        if((trail & 0xC0) != 0x80)
+            return false;
+        c = (c << 6) | (trail & 0x3F);
+    }
+    return c >= min && c <= 0x10FFFF && (c < 0xD800 || c > 0xDFFF);
+}
+
+// Appends the code points of the utf-8 text [first, last) to out.
+// Returns false on malformed input, see next_utf8.
+inline bool decode_utf8(const char* first, const char* last, std::u32string& out) {
+    codepoint c;
+    while(first != last) {
+        if(!next_utf8(first, last, c))
+            return false;
+        out.push_back(c);
+    }
+    return true;
+}
+
+// Returns the start of the first malformed sequence of [first, last), or last.
+// Ascii text is skipped 8 bytes at a time.
+inline const char* find_invalid_utf8(const char* first, const char* last) noexcept {
+    while(first != last) {
+        if(last - first >= 8) {
+            std::uint64_t word;
+            std::memcpy(&word, first, 8);
+            if(!(word & 0x8080808080808080)) {
+                first += 8;
+                continue;
+            }
+        }
+        const char* sequence = first;
+        codepoint c;
+        if(!next_utf8(first, last, c))
+            return sequence;
+    }
+    return last;
+}
+
+inline void push_back(std::string& string, codepoint c) {
+    if(c <= 0x7F) {
+        string.push_back(char(c));
         return;
     }
+    char buffer[4];
+    string.append(buffer, encode_utf8(buffer, c));
 }
 
 inline void push_back(std::u16string& string, codepoint c) {
@@ -41,7 +116,6 @@ inline void push_back(std::u16string& string, codepoint c) {
     char16_t low = uint16_t((c & 0x3FF) | 0xDC00);
     c >>= 10;
     char16_t high = uint16_t((c & 0x3FF) | 0xD800);
-    string.reserve(2);
     string.push_back(high);
     string.push_back(low);
     return;
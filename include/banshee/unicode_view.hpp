@@ -2,6 +2,8 @@
 #include <memory>
 #include <experimental/filesystem>
 #include <banshee/detail/unicode_file.hpp>
+#include <banshee/detail/decompress_streambuf.hpp>
+#include <banshee/detail/prefetch_reader.hpp>
 #include <cedilla/detail/unicode_base_view.hpp>
 #include <fstream>
 #include <iostream>
@@ -63,6 +65,10 @@ namespace detail {
         virtual cursor do_begin_cursor() const {
             return cursor{};
         }
+        // Files read through a peekable_streambuf can fail, see unicode_view::failed
+        virtual bool failed() const {
+            return false;
+        }
     };
 
 
@@ -142,6 +148,36 @@ namespace detail {
         return std::make_unique<unicode_file_impl<TE>>(std::move(fh));
     }
 
+    // Decodes a file read through a stream buffer, which reads it ahead on a background thread
+    // (prefetch_streambuf) or decompresses it (decompress_streambuf)
+    template<class TE>
+    class unicode_streambuf_file_impl
+        : public unicode_view_impl<typename detail::tv_type<TE>::type> {
+        using file_view =
+            ranges::iterator_range<std::istreambuf_iterator<char>, std::istreambuf_iterator<char>>;
+
+    public:
+        unicode_streambuf_file_impl(std::unique_ptr<peekable_streambuf>&& buf) :
+            m_buf(std::move(buf)) {
+            m_memory = ranges::iterator_range(std::istreambuf_iterator<char>(m_buf.get()),
+                                              std::istreambuf_iterator<char>());
+            this->m_text_view = std::experimental::make_text_view<TE>(m_memory);
+        }
+        bool failed() const override {
+            return m_buf->failed();
+        }
+
+    private:
+        std::unique_ptr<peekable_streambuf> m_buf;
+        file_view m_memory;
+    };
+
+    template<typename TE>
+    auto make_unicode_file(std::unique_ptr<peekable_streambuf>&& buf)
+        -> std::unique_ptr<unicode_view_impl_base> {
+        return std::make_unique<unicode_streambuf_file_impl<TE>>(std::move(buf));
+    }
+
     template<typename Rng, typename Encoding,
              CONCEPT_REQUIRES_(cedilla::detail::concepts::UtfInputRange<Rng>())>
     auto make_unicode_view_impl(Rng&& rng) {
@@ -197,29 +233,74 @@ public:
 
     unicode_view(std::unique_ptr<detail::unicode_view_impl_base>&& impl) :
         m_impl(std::move(impl)) {}
-};
 
-auto open_unicode_file(std::string path) {
-    std::fstream fh(path, std::ios::binary | std::ios::in);
-    std::array<char, 4> bom = {0, 0, 0, 0};
-    fh.read(bom.data(), 4);
+    // Whether the file could not be read, or was corrupt or truncated compressed data. Only
+    // final once the end of the view is reached, the lexers then emit tok_invalid.
+    bool failed() const {
+        return m_impl->failed();
+    }
+};
 
-    if(detail::test_bom<detail::codec_name::utf8>(bom)) {
-        return unicode_view(
-            detail::make_unicode_file<std::experimental::utf8bom_encoding>(std::move(fh)));
+namespace detail {
+    // The encoding is chosen from the first 4 bytes of the file, which are still to be read
+    template<typename File>
+    unicode_view open_unicode_file(File&& f, const std::array<char, 4>& bom) {
+        if(test_bom<codec_name::utf8>(bom)) {
+            return unicode_view(
+                make_unicode_file<std::experimental::utf8bom_encoding>(std::move(f)));
+        }
+        if(test_bom<codec_name::utf16LE>(bom) || test_bom<codec_name::utf16BE>(bom)) {
+            return unicode_view(
+                make_unicode_file<std::experimental::utf16bom_encoding>(std::move(f)));
+        }
+        if(test_bom<codec_name::utf32LE>(bom) || test_bom<codec_name::utf32BE>(bom)) {
+            return unicode_view(
+                make_unicode_file<std::experimental::utf32bom_encoding>(std::move(f)));
+        }
+        return unicode_view(make_unicode_file<std::experimental::utf8_encoding>(std::move(f)));
     }
-    if(detail::test_bom<detail::codec_name::utf16LE>(bom) ||
-       detail::test_bom<detail::codec_name::utf16BE>(bom)) {
-        return unicode_view(
-            detail::make_unicode_file<std::experimental::utf16bom_encoding>(std::move(fh)));
+}    // namespace detail
+
+enum class file_read_mode {
+    // Read through a std::fstream as the text is decoded
+    buffered,
+    // Read ahead in large buffers by a background thread, so that decoding and parsing overlap
+    // with the reads. Meant for files that cannot be mapped, on network file systems or pipes.
+    // Compressed files are decompressed by a second thread.
+    prefetch,
+};
+
+// gzip and zstd files are detected from their magic bytes and decompressed as they are read,
+// when banshee is built with BANSHEE_ZLIB or BANSHEE_ZSTD; the encoding is then chosen from
+// the decompressed text.
+inline unicode_view open_unicode_file(std::string path,
+                                      file_read_mode mode = file_read_mode::buffered) {
+    std::array<char, 4> bom = {0, 0, 0, 0};
+    const auto decompress = [&](std::unique_ptr<std::streambuf> source,
+                                detail::compression c) {
+        auto decoded = detail::make_decompress_streambuf(
+            std::move(source), c, mode == file_read_mode::prefetch);
+        bom = {0, 0, 0, 0};
+        decoded->peek_prefix(bom.data(), bom.size());
+        return detail::open_unicode_file(std::move(decoded), bom);
+    };
+    if(mode == file_read_mode::prefetch) {
+        auto buf = std::make_unique<detail::prefetch_streambuf>(path);
+        buf->peek_prefix(bom.data(), bom.size());
+        const auto c = detail::detect_compression(bom);
+        if(detail::can_decompress(c))
+            return decompress(std::move(buf), c);
+        return detail::open_unicode_file(std::move(buf), bom);
     }
-    if(detail::test_bom<detail::codec_name::utf32LE>(bom) ||
-       detail::test_bom<detail::codec_name::utf32BE>(bom)) {
-        return unicode_view(
-            detail::make_unicode_file<std::experimental::utf32bom_encoding>(std::move(fh)));
+    std::fstream fh(path, std::ios::binary | std::ios::in);
+    fh.read(bom.data(), 4);
+    const auto c = detail::detect_compression(bom);
+    if(detail::can_decompress(c)) {
+        auto buf = std::make_unique<std::filebuf>();
+        buf->open(path, std::ios::binary | std::ios::in);
+        return decompress(std::move(buf), c);
     }
-    return unicode_view(detail::make_unicode_file<std::experimental::utf8_encoding>(std::move(fh)));
+    return detail::open_unicode_file(std::move(fh), bom);
 }
 
-
 }    // namespace banshee
@@ -0,0 +1,212 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <banshee/property.hpp>
+#include <banshee/detail/subtree_hash.hpp>
+
+namespace banshee {
+
+namespace detail {
+    // Whether the arrays and objects of Property are shared between copies (see detail::cow)
+    template<typename Property>
+    constexpr bool is_shared_property_v =
+        has_cached_hash<typename Property::array_t>::value &&
+        has_cached_hash<typename Property::object_t>::value;
+}    // namespace detail
+
+// Hash consing of property trees.
+// intern() returns a value sharing the containers and strings of an equal, previously interned
+// value when there is one, so identical subtrees and strings are stored once. Interned
+// containers carry their structural hash, which makes comparing and diffing them cheap: equal
+// subtrees are the same container, different ones most likely have different hashes.
+// The pool keeps the values it interned alive, up to max_size of them. collect() drops the
+// ones nothing else references anymore; a full pool collects, then returns new values
+// without remembering them until it collects again.
+// Interned values stay shared and are never modified in place; writing to an interned value
+// clones the containers along the modified path.
+// The pool itself is not thread safe, the values it returns are.
+template<typename Property>
+class basic_value_pool {
+    static_assert(detail::is_shared_property_v<Property>,
+                  "hash consing requires shared containers, see shared_property");
+
+public:
+    using property_t = Property;
+    using string_t = typename property_t::string_t;
+    using array_t = typename property_t::array_t;
+    using object_t = typename property_t::object_t;
+
+    explicit basic_value_pool(std::size_t max_size = std::size_t(-1)) : m_max_size(max_size) {}
+
+    // Other scalars are returned as is. The children of a container are interned first, unless
+    // the container already carries a hash; this is O(1) per child when they are already
+    // interned. Containers shared with other values are only cloned if a child is replaced.
+    property_t intern(property_t&& p) {
+        if(auto* s = std::get_if<string_t>(&p.value)) {
+            *s = intern(std::move(*s));
+            return std::move(p);
+        }
+        if(!p.is_array() && !p.is_object())
+            return std::move(p);
+        std::uint64_t hash = detail::cached_hash(p);
+        if(!hash) {
+            intern_children(p);
+            hash = detail::hash_container(
+                p, [](const property_t& child) { return detail::hash_value(child); });
+        }
+        auto range = m_values.equal_range(hash);
+        for(auto it = range.first; it != range.second; ++it) {
+            if(it->second == p)
+                return it->second;
+        }
+        cache_hash(p, hash);
+        if(has_room())
+            m_values.emplace(hash, p);
+        return std::move(p);
+    }
+    property_t intern(const property_t& p) {
+        return intern(property_t(p));
+    }
+    string_t intern(string_t&& s) {
+        if(s.empty())
+            return std::move(s);
+        auto it = m_strings.find(s);
+        if(it != m_strings.end())
+            return *it;
+        if(has_room())
+            m_strings.insert(s);
+        return std::move(s);
+    }
+
+    // Drops the containers and strings referenced by the pool only, returns how many
+    std::size_t collect() {
+        std::size_t dropped = 0;
+        // Dropping a container can release its children
+        for(std::size_t n = 1; n;) {
+            n = 0;
+            for(auto it = m_values.begin(); it != m_values.end();) {
+                if(is_shared(it->second)) {
+                    ++it;
+                } else {
+                    it = m_values.erase(it);
+                    n++;
+                }
+            }
+            dropped += n;
+        }
+        for(auto it = m_strings.begin(); it != m_strings.end();) {
+            if(it->is_shared()) {
+                ++it;
+            } else {
+                it = m_strings.erase(it);
+                dropped++;
+            }
+        }
+        m_refused = 0;
+        return dropped;
+    }
+
+    // Number of distinct containers and strings in the pool
+    std::size_t size() const noexcept {
+        return m_values.size() + m_strings.size();
+    }
+    std::size_t max_size() const noexcept {
+        return m_max_size;
+    }
+    void clear() noexcept {
+        m_values.clear();
+        m_strings.clear();
+        m_refused = 0;
+    }
+
+private:
+    struct string_hash {
+        std::size_t operator()(const string_t& s) const noexcept {
+            return std::size_t(detail::hash_string(s.view()));
+        }
+    };
+
+    // A full pool collects, then refuses as many values as it holds before collecting again
+    bool has_room() {
+        if(size() < m_max_size)
+            return true;
+        if(m_refused == 0) {
+            collect();
+            if(size() < m_max_size)
+                return true;
+            m_refused = size();
+        }
+        m_refused--;
+        return false;
+    }
+
+    // The children are read without detaching p, which is only modified when a child is
+    // replaced by an interned value with a different storage
+    void intern_children(property_t& p) {
+        if(p.is_array()) {
+            auto& array = std::get<array_t>(p.value);
+            for(std::size_t i = 0; i < array.size(); i++) {
+                const property_t& child = std::as_const(array)[i];
+                if(!storage(child))
+                    continue;
+                property_t interned = intern(child);
+                if(storage(interned) != storage(std::as_const(array)[i]))
+                    array.modify([&](auto& a) { a[i] = std::move(interned); });
+            }
+            return;
+        }
+        auto& object = std::get<object_t>(p.value);
+        for(auto it = object.begin(); it != object.end(); ++it) {
+            string_t key = intern(string_t(it->first));
+            property_t value = storage(it->second) ? intern(it->second) : property_t{};
+            const bool new_key = key.identity() != it->first.identity();
+            const bool new_value = storage(value) && storage(value) != storage(it->second);
+            if(!new_key && !new_value)
+                continue;
+            // Replacing a key keeps the position of the member: it is equal to the old one
+            const string_t name = it->first;
+            object.modify([&](auto& o) {
+                auto node = o.extract(o.find(name));
+                if(new_key)
+                    node.key() = std::move(key);
+                if(new_value)
+                    node.mapped() = std::move(value);
+                o.insert(std::move(node));
+            });
+            it = object.find(name);
+        }
+    }
+
+    // The shared storage of a string, an array or an object, nullptr for other values
+    static const void* storage(const property_t& p) noexcept {
+        if(const auto* s = std::get_if<string_t>(&p.value))
+            return s->identity();
+        if(const auto* array = std::get_if<array_t>(&p.value))
+            return array->identity();
+        if(const auto* object = std::get_if<object_t>(&p.value))
+            return object->identity();
+        return nullptr;
+    }
+    static bool is_shared(const property_t& p) noexcept {
+        if(const auto* array = std::get_if<array_t>(&p.value))
+            return array->is_shared();
+        return std::get<object_t>(p.value).is_shared();
+    }
+    static void cache_hash(property_t& p, std::uint64_t hash) noexcept {
+        if(auto* array = std::get_if<array_t>(&p.value))
+            array->cache_hash(hash);
+        else if(auto* object = std::get_if<object_t>(&p.value))
+            object->cache_hash(hash);
+    }
+
+    std::unordered_multimap<std::uint64_t, property_t> m_values;
+    std::unordered_set<string_t, string_hash> m_strings;
+    std::size_t m_max_size;
+    std::size_t m_refused = 0;
+};
+
+using value_pool = basic_value_pool<shared_property>;
+
+}    // namespace banshee
@@ -1 +1 @@
-#include "iciparser.h"
+#include <banshee/ici/ici_loader.hpp>
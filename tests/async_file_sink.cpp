@@ -0,0 +1,184 @@
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+// Writes documents through async_file_sink to a file and to a pipe, and compares the bytes
+// with those of a synchronous writer: with 2 and 4 buffers, with values larger than the
+// buffer, with writev writing only part of the chunks, and to a file descriptor which fails
+namespace {
+
+// writev as called by async_file_sink, which can be made to write at most short_writes bytes
+// per call, and to stall on its first call so that the next batch has several chunks
+std::atomic<std::size_t> short_writes{std::numeric_limits<std::size_t>::max()};
+std::atomic<bool> stall{false};
+std::atomic<int> partial_writes{0};
+std::atomic<int> crossed_chunks{0};
+
+}    // namespace
+
+extern "C" ssize_t writev(int fd, const iovec* iov, int count) {
+    if(stall.exchange(false))
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::string data;
+    std::size_t total = 0;
+    for(int i = 0; i < count; i++) {
+        total += iov[i].iov_len;
+        data.append(static_cast<const char*>(iov[i].iov_base), iov[i].iov_len);
+    }
+    data.resize(std::min(data.size(), short_writes.load()));
+    const ssize_t written = ::write(fd, data.data(), data.size());
+    if(written >= 0 && std::size_t(written) < total)
+        partial_writes++;
+    if(written > 0 && count > 1 && std::size_t(written) > iov[0].iov_len)
+        crossed_chunks++;
+    return written;
+}
+
+namespace {
+
+constexpr std::size_t buffer_size = 256;
+
+// Values smaller and larger than the buffer of the writer
+template<typename Writer>
+bool write_document(Writer& writer) {
+    bool ok = writer.begin_array();
+    for(int i = 0; i < 300 && ok; i++) {
+        ok = writer.begin_object() && writer.key("index") && writer.value(i) &&
+             writer.key("text") && writer.value(std::string(std::size_t(i % 7) * 10, 'x'));
+        if(ok && i % 50 == 0) {
+            const std::string large(buffer_size * 3, char('a' + i % 26));
+            ok = writer.key("large") && writer.value(large);
+        }
+        ok = ok && writer.end_object();
+    }
+    return ok && writer.end_array() && writer.finish();
+}
+
+std::string expected() {
+    std::string out;
+    banshee::basic_json_writer writer{
+        banshee::function_sink([&](const char* data, std::size_t size) {
+            out.append(data, size);
+            return true;
+        }),
+        buffer_size};
+    write_document(writer);
+    return out;
+}
+
+std::string read_all(int fd) {
+    std::string out;
+    char buffer[4096];
+    ssize_t n;
+    while((n = ::read(fd, buffer, sizeof(buffer))) != 0) {
+        if(n < 0 && errno == EINTR)
+            continue;
+        if(n < 0)
+            break;
+        out.append(buffer, std::size_t(n));
+    }
+    return out;
+}
+
+bool to_file(std::size_t buffer_count, std::string& out) {
+    char path[] = "/tmp/banshee-async-XXXXXX";
+    const int fd = ::mkstemp(path);
+    if(fd < 0)
+        return false;
+    ::unlink(path);
+    bool ok;
+    {
+        banshee::basic_json_writer writer{banshee::async_file_sink(fd, buffer_count), buffer_size};
+        ok = write_document(writer);
+    }
+    ok = ok && ::lseek(fd, 0, SEEK_SET) == 0;
+    out = read_all(fd);
+    ::close(fd);
+    return ok;
+}
+
+bool to_pipe(std::size_t buffer_count, std::string& out) {
+    int fds[2];
+    if(::pipe(fds) != 0)
+        return false;
+    std::thread reader([&] { out = read_all(fds[0]); });
+    bool ok;
+    {
+        banshee::basic_json_writer writer{banshee::async_file_sink(fds[1], buffer_count),
+                                          buffer_size};
+        ok = write_document(writer);
+    }
+    ::close(fds[1]);
+    reader.join();
+    ::close(fds[0]);
+    return ok;
+}
+
+bool check_output(const std::string& reference) {
+    for(std::size_t buffer_count : {2, 4}) {
+        std::string out;
+        CHECK(to_file(buffer_count, out) && out == reference);
+        CHECK(to_pipe(buffer_count, out) && out == reference);
+    }
+    return true;
+}
+
+bool check_partial_writes(const std::string& reference) {
+    // Odd sizes, so that writes end in the middle of chunks and span several
+    short_writes = 100;
+    for(std::size_t buffer_count : {2, 4}) {
+        std::string out;
+        stall = true;
+        CHECK(to_file(buffer_count, out) && out == reference);
+        stall = true;
+        CHECK(to_pipe(buffer_count, out) && out == reference);
+    }
+    short_writes = std::numeric_limits<std::size_t>::max();
+    CHECK(partial_writes > 0 && crossed_chunks > 0);
+    return true;
+}
+
+bool check_failure() {
+    char path[] = "/tmp/banshee-async-XXXXXX";
+    const int fd = ::mkstemp(path);
+    CHECK(fd >= 0);
+    const int read_only = ::open(path, O_RDONLY);
+    ::unlink(path);
+    ::close(fd);
+    CHECK(read_only >= 0);
+    for(std::size_t buffer_count : {2, 4}) {
+        // Failing while writing the queued buffers
+        {
+            banshee::basic_json_writer writer{banshee::async_file_sink(read_only, buffer_count),
+                                              buffer_size};
+            CHECK(!write_document(writer) && !writer.good());
+        }
+        // And while writing a value larger than the buffer
+        {
+            banshee::basic_json_writer writer{banshee::async_file_sink(read_only, buffer_count),
+                                              buffer_size};
+            CHECK(!writer.value(std::string(buffer_size * 2, 'x')) && !writer.finish());
+        }
+    }
+    ::close(read_only);
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const std::string reference = expected();
+    const bool ok = !reference.empty() && check_output(reference) &&
+                    check_partial_writes(reference) && check_failure();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Round trips json through the binary snapshot format, and reads truncated and corrupt
+// snapshots, which must not be read out of bounds
+namespace {
+
+using banshee::test::parse_json;
+
+bool round_trip(const banshee::property& value) {
+    banshee::binary_writer writer;
+    if(!writer.write(value))
+        return false;
+    auto root = banshee::read_binary(writer.buffer());
+    if(!root)
+        return false;
+
+    std::ostringstream expected, actual;
+    expected << value;
+    actual << root->to_property<banshee::property>();
+    return expected.str() == actual.str();
+}
+
+// Visits every value through all the accessors.
+// The snapshot is copied to a buffer of its exact size, so that reading past its end is
+// caught by address sanitizers.
+void read_all(const std::string& snapshot) {
+    const std::vector<char> buffer(snapshot.begin(), snapshot.end());
+    auto root = banshee::read_binary(buffer.data(), buffer.size());
+    if(!root)
+        return;
+    std::ostringstream os;
+    os << root->to_property<banshee::property>();
+    banshee::document_view view(*root);
+    for(auto&& [key, value] : view.members())
+        os << key << value.size() << value["a"].is_null() << value[0].is_null();
+    for(auto&& value : view)
+        os << std::string_view(value) << double(value);
+}
+
+// Number of values of a tree, and depth of its first elements
+std::size_t count_values(const banshee::property& p) {
+    std::size_t count = 1;
+    if(p.is_array()) {
+        for(const auto& e : std::get<banshee::property::array_t>(p.value))
+            count += count_values(e);
+    }
+    return count;
+}
+std::size_t first_depth(const banshee::property& p) {
+    std::size_t depth = 0;
+    for(const auto* e = &p; e->is_array() && e->size(); e = &(*e)[0])
+        depth++;
+    return depth;
+}
+
+banshee::property nested_arrays(std::size_t depth) {
+    banshee::property p;
+    for(std::size_t i = 0; i < depth; i++)
+        p = banshee::property::array_t{std::move(p)};
+    return p;
+}
+
+std::string header() {
+    namespace bin = banshee::detail::binary;
+    std::string s(bin::magic.begin(), bin::magic.end());
+    s.push_back(char(bin::version));
+    s.append(bin::header_size - s.size(), '\0');
+    return s;
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    if(argc > 1) {
+        auto view = banshee::json_token_view(banshee::open_unicode_file(argv[1]));
+        auto parser = banshee::json_parser(view);
+        auto value = parser.parse();
+        if(!value || !round_trip(*value))
+            return 1;
+    }
+
+    const auto value = parse_json(R"({"a": [1, -2, 3.5, "four", true, false, null],
+                                 "b": {"c": {"d": []}, "e": "f"}, "g": ""})");
+    if(!value || !round_trip(*value))
+        return 1;
+    banshee::binary_writer writer;
+    writer.write(*value);
+    const std::string snapshot = writer.buffer();
+
+    // Every prefix of the snapshot
+    for(std::size_t size = 0; size < snapshot.size(); size++)
+        read_all(snapshot.substr(0, size));
+
+    // Every byte replaced by a few values, which corrupts tags, lengths, counts and offsets
+    for(std::size_t i = banshee::detail::binary::header_size; i < snapshot.size(); i++) {
+        for(int c : {0x00, 0x01, 0x07, 0x08, 0x7F, 0x80, 0xFF, snapshot[i] ^ 1}) {
+            std::string corrupt = snapshot;
+            corrupt[i] = char(c);
+            read_all(corrupt);
+        }
+    }
+
+    // Handcrafted snapshots
+    const std::string h = header();
+    auto root = [](const std::string& s) {
+        return *banshee::read_binary(s);
+    };
+    // A string longer than the buffer
+    if(!root(h + "\x05\x64"
+                 "abc")
+            .is_null())
+        return 1;
+    // An unterminated varint
+    if(!root(h + "\x03\x80\x80").is_null())
+        return 1;
+    // A truncated double
+    if(!root(h + "\x04\x00\x00\x00\x00").is_null())
+        return 1;
+    // An unknown tag
+    if(!root(h + "\x09").is_null())
+        return 1;
+    // An offset table larger than the buffer
+    if(!root(h + "\x06\xFF\xFF\xFF\xFF\x0F").is_null())
+        return 1;
+    // An array whose element points to the array itself, then past the end of the buffer
+    const std::string cyclic = h + std::string("\x06\x01\x00\x00\x00\x00", 6);
+    if(!root(cyclic).is_array() || !root(cyclic)[0].is_null())
+        return 1;
+    const std::string past_end = h + std::string("\x06\x01\x40\x00\x00\x00", 6);
+    if(!root(past_end)[0].is_null())
+        return 1;
+    // An object whose key is longer than the buffer
+    const std::string long_key = h + std::string("\x07\x01\x05\x00\x00\x00\x7F", 7) + "k";
+    if(!root(long_key).key(0).empty() || !root(long_key).value(0).is_null() ||
+       !root(long_key)["k"].is_null())
+        return 1;
+    read_all(cyclic);
+    read_all(past_end);
+    read_all(long_key);
+
+    // A chain of arrays whose two elements both point to the next array: decoding every
+    // element would make 2^64 values
+    std::string dag = h;
+    for(int level = 0; level < 64; level++)
+        dag += std::string("\x06\x02\x0A\x00\x00\x00\x0A\x00\x00\x00", 10);
+    dag.push_back('\0');
+    if(!root(dag)[1][0][1].is_array() ||
+       count_values(root(dag).to_property<banshee::property>()) > dag.size())
+        return 1;
+
+    // Containers nested deeper than max_depth are read as null, without recursing further
+    namespace bin = banshee::detail::binary;
+    std::string deep = h;
+    for(int level = 0; level < 1000000; level++)
+        deep += std::string("\x06\x01\x06\x00\x00\x00", 6);
+    deep.push_back('\0');
+    if(first_depth(root(deep).to_property<banshee::property>()) != bin::max_depth)
+        return 1;
+
+    // and are not written
+    const auto deepest = nested_arrays(bin::max_depth);
+    if(!round_trip(deepest) || first_depth(deepest) != bin::max_depth)
+        return 1;
+    if(writer.write(nested_arrays(bin::max_depth + 1)))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+
+// Reads arrays of records into columns, with and without a schema
+namespace {
+
+using banshee::column_spec;
+using banshee::column_type;
+
+std::optional<banshee::json_column_table> parse(const std::string& json,
+                                                const std::vector<column_spec>* schema = nullptr) {
+    auto view = banshee::json_token_view<std::u32string>(banshee::test::codepoints(json));
+    if(schema)
+        return banshee::json_column_parser(view, *schema).parse();
+    return banshee::json_column_parser(view).parse();
+}
+
+bool check_inferred() {
+    const auto table = parse(R"([
+        {"ts": 1, "host": "a", "ok": true},
+        {"ts": 2.5, "host": "b"},
+        {"host": "a", "ts": null, "extra": "x"}
+    ])");
+    CHECK(table && table->rows() == 3 && table->columns().size() == 4);
+    const auto* ts = table->find("ts");
+    CHECK(ts && ts->type() == column_type::floating);
+    CHECK(ts->doubles()[0] == 1 && ts->doubles()[1] == 2.5 && ts->is_null(2));
+    const auto* host = table->find("host");
+    CHECK(host && host->type() == column_type::string && host->dictionary().size() == 2);
+    CHECK(host->string(0) == "a" && host->string(1) == "b" && host->string(2) == "a");
+    const auto* ok = table->find("ok");
+    CHECK(ok && ok->type() == column_type::boolean && ok->null_count() == 2);
+    const auto* extra = table->find("extra");
+    CHECK(extra && extra->is_null(0) && extra->is_null(1) && extra->string(2) == "x");
+    return true;
+}
+
+bool check_schema() {
+    const std::vector<column_spec> schema = {{"id", column_type::integral},
+                                             {"v", column_type::null}};
+    const auto table = parse(R"([
+        {"id": 1, "skip": {"a": [1, {"b": null}], "c": []}, "v": "x"},
+        {"skip": [[], {}], "id": 2}
+    ])", &schema);
+    CHECK(table && table->rows() == 2 && table->columns().size() == 2);
+    CHECK(table->find("id")->integers() == std::vector<std::int64_t>({1, 2}));
+    CHECK(table->find("v")->is_null(1) && !table->find("skip"));
+
+    // A schema column keeps its type
+    CHECK(!parse(R"([{"id": 1.5}])", &schema));
+
+    // A name listed twice is rejected
+    const std::vector<column_spec> duplicated = {{"id"}, {"v"}, {"id"}};
+    CHECK(!parse(R"([{"id": 1}])", &duplicated));
+    return true;
+}
+
+bool check_malformed() {
+    const std::vector<column_spec> schema = {{"id"}};
+    for(const char* json : {
+            R"([{"id": 1, "skip":,}])",
+            R"([{"id": 1, "skip": [1 2]}])",
+            R"([{"id": 1, "skip": [1,]}])",
+            R"([{"id": 1, "skip": {"a" 1}}])",
+            R"([{"id": 1, "skip": {"a": 1,}}])",
+            R"([{"id": 1, "skip": {1: 2}}])",
+            R"([{"id": 1, "skip": [}]}])",
+            R"([{"id": 1, "skip": {"a": }}])",
+            R"([{"id": 1, "skip": ]}])",
+            R"([{"id": 1, "skip": [1})",
+        }) {
+        if(parse(json, &schema)) {
+            std::cerr << "accepted " << json << '\n';
+            return false;
+        }
+    }
+    CHECK(parse(R"([{"id": 1, "skip": [1, {"a": [2, 3]}, "s", null, true]}])", &schema));
+    CHECK(!parse(R"([{"id": 1, "id": 2}])"));
+    CHECK(!parse(R"([{"id": [1]}])"));
+    CHECK(!parse(R"([{"id": 1}, 2])"));
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_inferred() && check_schema() && check_malformed();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Parses compressed documents, which must fail when the compressed data is truncated or
+// corrupt, even though the decompressed text looks like a complete document
+// usage: banshee-test-compressed tests/data/compressed
+namespace {
+
+std::string directory;
+
+// Copies its input. The input ends in the middle of a stream unless Complete.
+template<bool Complete>
+struct copy_decoder {
+    bool decode(const char*& in, const char* in_end, char*& out, char* out_end) {
+        const auto n = std::min(in_end - in, out_end - out);
+        std::memcpy(out, in, std::size_t(n));
+        in += n;
+        out += n;
+        return true;
+    }
+    bool at_boundary() const noexcept {
+        return Complete;
+    }
+};
+
+std::optional<banshee::property> parse(banshee::unicode_view&& text) {
+    auto view = banshee::json_token_view(std::move(text));
+    return banshee::json_parser(view).parse();
+}
+
+template<bool Complete>
+bool check_stream(bool pipelined) {
+    auto source = std::make_unique<std::stringbuf>(std::string("[1, 2]"), std::ios::in);
+    auto decoded = banshee::detail::make_decompress_streambuf<copy_decoder<Complete>>(
+        std::move(source), pipelined);
+    std::array<char, 4> bom = {0, 0, 0, 0};
+    decoded->peek_prefix(bom.data(), bom.size());
+    auto value = parse(banshee::detail::open_unicode_file(std::move(decoded), bom));
+    CHECK(value.has_value() == Complete);
+    return true;
+}
+
+bool check_file(const std::string& name, bool valid) {
+    for(auto mode : {banshee::file_read_mode::buffered, banshee::file_read_mode::prefetch}) {
+        auto value = parse(banshee::open_unicode_file(directory + "/" + name, mode));
+        if(value.has_value() != valid) {
+            std::cerr << name << (valid ? ": rejected\n" : ": accepted\n");
+            return false;
+        }
+        CHECK(!valid || std::string((*value)["name"]) == "banshee");
+    }
+    return true;
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    if(argc < 2)
+        return 2;
+    directory = argv[1];
+    bool ok = true;
+    for(bool pipelined : {false, true})
+        ok = check_stream<true>(pipelined) && check_stream<false>(pipelined) && ok;
+#ifdef BANSHEE_USE_ZLIB
+    // gzip -n doc.json, without its trailer, and with a wrong crc
+    ok = check_file("doc.json.gz", true) && ok;
+    ok = check_file("truncated.json.gz", false) && ok;
+    ok = check_file("bad_crc.json.gz", false) && ok;
+#endif
+#ifdef BANSHEE_USE_ZSTD
+    // zstd doc.json, without its checksum, and with a wrong checksum
+    ok = check_file("doc.json.zst", true) && ok;
+    ok = check_file("truncated.json.zst", false) && ok;
+    ok = check_file("bad_checksum.json.zst", false) && ok;
+#endif
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+
+// Copies of shared properties must stay independent, whatever references were taken into them
+namespace {
+
+using banshee::test::parse_json;
+using banshee::shared_property;
+using array_t = shared_property::array_t;
+using object_t = shared_property::object_t;
+
+const void* identity(const shared_property& p) {
+    if(p.is_array())
+        return std::get<array_t>(p.value).identity();
+    return std::get<object_t>(p.value).identity();
+}
+
+bool check_copies() {
+    auto doc = parse_json<shared_property>(R"({"a": {"b": [1, 2, 3]}, "c": {"d": "e"}})");
+    CHECK(doc);
+    const shared_property original = *doc;
+    shared_property copy = original;
+    CHECK(identity(copy) == identity(original));
+
+    // Writing a nested value clones the containers along its path only
+    copy["a"]["b"][1] = 20;
+    CHECK(int(original["a"]["b"][1]) == 2 && int(copy["a"]["b"][1]) == 20);
+    CHECK(identity(copy) != identity(original));
+    CHECK(identity(copy["c"]) == identity(original["c"]));
+    return true;
+}
+
+bool check_escaped_references() {
+    shared_property p;
+    p["k"] = 1;
+    shared_property& member = p["k"];
+    // p handed out a reference: copies must not share its storage
+    const shared_property copy = p;
+    member = 2;
+    CHECK(int(copy["k"]) == 1 && int(p["k"]) == 2);
+
+    auto doc = parse_json<shared_property>("[[1], [2]]");
+    CHECK(doc);
+    auto& array = std::get<array_t>(doc->value).get_mutable();
+    const shared_property before = *doc;
+    array[0] = 3;
+    CHECK(before == *parse_json<shared_property>("[[1], [2]]"));
+
+    // p is copied by cloning, the clone is shareable
+    CHECK(identity(shared_property(p)) != identity(p));
+    const shared_property second = copy;
+    CHECK(identity(second) == identity(copy));
+    return true;
+}
+
+bool check_reads() {
+    auto doc = parse_json<shared_property>(R"({"a": [1, 2], "b": {"c": null}})");
+    CHECK(doc);
+    shared_property copy = *doc;
+    // Reading through non const copies does not detach them
+    int sum = 0;
+    for(const auto& e : std::get<array_t>(std::get<object_t>(copy.value).find("a")->second.value))
+        sum += int(e);
+    for(auto& member : std::get<object_t>(copy.value))
+        sum += int(member.second.size());
+    CHECK(sum == 3 + 3);
+    CHECK(copy.find("b") && identity(copy) == identity(*doc));
+    CHECK(std::get<object_t>(doc->value).is_shared());
+    return true;
+}
+
+bool check_patches() {
+    auto from = parse_json<shared_property>(R"({"a": [1, 2], "b": {"c": true}})");
+    auto to = parse_json<shared_property>(R"({"a": [1, 3, 2], "b": {"d": "e"}})");
+    CHECK(from && to);
+    const shared_property original = *from;
+    shared_property patched = *from;
+    CHECK(banshee::apply_patch(patched, banshee::diff(*from, *to)));
+    CHECK(patched == *to && original == *from);
+
+    shared_property merged = *from;
+    banshee::merge_patch(merged, banshee::create_merge_patch(*from, *to));
+    CHECK(merged == *to && original == *from);
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_copies() && check_escaped_references() && check_reads() &&
+                    check_patches();
+    return ok ? 0 : 1;
+}
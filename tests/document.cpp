@@ -0,0 +1,95 @@
+#include "test_helpers.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// Saves snapshots with save_document, and queries them through mapped_document and
+// document_view
+namespace {
+
+using banshee::test::parse_json;
+
+bool exists(const std::string& path) {
+    return ::access(path.c_str(), F_OK) == 0;
+}
+
+bool check_queries(const std::string& path) {
+    const auto value = parse_json(R"({"name": "banshee", "version": 3, "ratio": 0.5,
+                                 "tags": ["json", "ici"], "empty": {}, "none": null,
+                                 "nested": {"enabled": true, "level": -2}})");
+    CHECK(value);
+    CHECK(banshee::save_document(path, *value));
+    CHECK(!exists(path + ".tmp"));
+
+    auto doc = banshee::mapped_document::open(path);
+    CHECK(doc);
+    const banshee::document_view root = doc->root();
+    CHECK(root.is_object() && root.size() == 7);
+    CHECK(std::string_view(root["name"]) == "banshee");
+    CHECK(int(root["version"]) == 3 && root["version"].is_integral());
+    CHECK(double(root["ratio"]) == 0.5 && root["ratio"].is_double());
+    CHECK(root["tags"].is_array() && root["tags"].size() == 2);
+    CHECK(std::string_view(root["tags"][1]) == "ici");
+    CHECK(root["tags"][2].is_null());
+    CHECK(root["empty"].is_empty() && root["none"].is_empty() && !root["tags"].is_empty());
+    CHECK(bool(root["nested"]["enabled"]) && int(root["nested"]["level"]) == -2);
+    CHECK(root["missing"].is_null() && !root.find("missing") && root.find("none"));
+    CHECK(root.find("none")->is_null());
+
+    // Members are sorted by key
+    std::string keys;
+    for(auto&& [key, member] : root.members())
+        keys += std::string(key) + ' ';
+    CHECK(keys == "empty name nested none ratio tags version ");
+    std::size_t count = 0;
+    for(auto&& element : root["tags"]) {
+        CHECK(element.is_string());
+        count++;
+    }
+    CHECK(count == 2);
+    CHECK(root.to_property<banshee::property>() == *value);
+    return true;
+}
+
+// Readers of the previous snapshot keep reading it after it is replaced
+bool check_replace(const std::string& path) {
+    CHECK(banshee::save_document(path, banshee::property("old")));
+    auto old_doc = banshee::mapped_document::open(path);
+    CHECK(old_doc);
+    CHECK(banshee::save_document(path, banshee::property("new")));
+    auto new_doc = banshee::mapped_document::open(path);
+    CHECK(new_doc);
+    CHECK(std::string_view(old_doc->root()) == "old");
+    CHECK(std::string_view(new_doc->root()) == "new");
+    return true;
+}
+
+// A failed save leaves neither the snapshot nor the temporary file behind
+bool check_failure(const std::string& dir) {
+    const std::string path = dir + "/missing/doc.bnsh";
+    CHECK(!banshee::save_document(path, banshee::property(1)));
+    CHECK(!exists(path) && !exists(path + ".tmp"));
+    CHECK(!banshee::mapped_document::open(path));
+
+    // Files which are not snapshots are not opened
+    const std::string text = dir + "/text";
+    const std::string content = "not a snapshot";
+    CHECK(banshee::detail::replace_file(text, content.data(), content.size()));
+    CHECK(!banshee::mapped_document::open(text));
+    ::unlink(text.c_str());
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    char dir[] = "/tmp/banshee-test-document-XXXXXX";
+    if(!::mkdtemp(dir))
+        return 1;
+    const std::string path = std::string(dir) + "/doc.bnsh";
+    const bool ok = check_queries(path) && check_replace(path) && check_failure(dir);
+    ::unlink(path.c_str());
+    ::rmdir(dir);
+    return ok ? 0 : 1;
+}
@@ -1,33 +1,99 @@
-#include <banshee/banshee.hpp>
+#include "test_helpers.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unistd.h>
 
-void dump(banshee::unicode_view& v) {
-    for(auto&& c : v) {
-        std::cout << char(c);
-    }
+// Reads files through prefetch_streambuf, which must deliver the same bytes as a buffered
+// read and report the files it cannot open or read, and parses them in both read modes
+// usage: banshee-test-file tests/data
+namespace {
+
+using banshee::detail::prefetch_streambuf;
+
+std::string read_buffered(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Reads in chunks which do not line up with the buffers of the streambuf
+std::string read_prefetched(prefetch_streambuf& buf) {
+    std::string out;
+    char chunk[1000];
+    std::streamsize n;
+    while((n = buf.sgetn(chunk, sizeof(chunk))) > 0)
+        out.append(chunk, std::size_t(n));
+    return out;
 }
 
-int main() {
-    auto f = banshee::open_unicode_file("test.json");
+bool check_read(const std::string& path, std::size_t buffer_size, std::size_t buffer_count) {
+    const std::string expected = read_buffered(path);
+    prefetch_streambuf buf(path, buffer_size, buffer_count);
+    char prefix[4] = {};
+    CHECK(buf.peek_prefix(prefix, sizeof(prefix)) == std::min<std::size_t>(4, expected.size()));
+    CHECK(expected.compare(0, 4, prefix, std::min<std::size_t>(4, expected.size())) == 0);
+    CHECK(read_prefetched(buf) == expected);
+    CHECK(!buf.failed());
+    // The end of the stream stays the end
+    CHECK(buf.sgetc() == std::char_traits<char>::eof());
+    return true;
+}
 
+// A file spanning many buffers, so that the ring of buffers wraps around
+bool check_large_file() {
+    char path[] = "/tmp/banshee-file-XXXXXX";
+    const int fd = ::mkstemp(path);
+    CHECK(fd >= 0);
+    std::ostringstream text;
+    for(int i = 0; i < 20000; i++)
+        text << i << (i % 16 == 15 ? '\n' : ' ');
+    const std::string data = text.str();
+    const bool written = ::write(fd, data.data(), data.size()) == ssize_t(data.size());
+    ::close(fd);
+    const bool ok = written && check_read(path, 4096, 2) && check_read(path, 4096, 5) &&
+                    check_read(path, 100000, 4);
+    ::unlink(path);
+    return ok;
+}
 
-    const std::string s1 = "Hello";
-    const std::u16string s2 = u"Hello";
-    const std::u32string s3 = U"Hello";
+bool check_errors(const std::string& directory) {
+    // A missing file
+    prefetch_streambuf missing(directory + "/missing.json");
+    CHECK(missing.failed());
+    char prefix[4];
+    CHECK(missing.peek_prefix(prefix, sizeof(prefix)) == 0);
+    CHECK(missing.sgetc() == std::char_traits<char>::eof() && missing.failed());
 
-    auto v1 = banshee::unicode_view(s1);
-    auto v2 = banshee::unicode_view(s2);
-    auto v3 = banshee::unicode_view(s3);
+    // A directory opens, but cannot be read
+    prefetch_streambuf unreadable(directory);
+    CHECK(unreadable.sgetc() == std::char_traits<char>::eof() && unreadable.failed());
+    return true;
+}
 
-    auto view = banshee::json_token_view(banshee::open_unicode_file("test.json"));
-    auto parser = banshee::json_parser(view);
-    auto res = parser.parse();
+bool check_parse(const std::string& path) {
+    auto buffered = banshee::json_token_view(banshee::open_unicode_file(path));
+    const auto value = banshee::json_parser(buffered).parse();
+    CHECK(value && std::string((*value)["name"]) == "banshee");
+    auto prefetched = banshee::json_token_view(
+        banshee::open_unicode_file(path, banshee::file_read_mode::prefetch));
+    const auto prefetched_value = banshee::json_parser(prefetched).parse();
+    CHECK(prefetched_value && *prefetched_value == *value);
+    return true;
+}
 
-    /*
-        for(auto tok :)) {
-                std::cout << tok << '\n';
-            }
-    */
+}    // namespace
 
-    // for(auto it = l.begin(); it != l.end(); ++it) {
-    //}
+int main(int argc, char** argv) {
+    if(argc < 2)
+        return 2;
+    const std::string directory = argv[1];
+    const std::string path = directory + "/file.json";
+    const bool ok = check_read(path, prefetch_streambuf::default_buffer_size, 4) &&
+                    check_read(path, 64, 2) && check_large_file() && check_errors(directory) &&
+                    check_parse(path);
+    return ok ? 0 : 1;
 }
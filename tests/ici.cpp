@@ -0,0 +1,19 @@
+#include <banshee/banshee.hpp>
+#include <iostream>
+
+// Loads an ici file and its includes, then prints the resulting object
+// usage: banshee-test-ici file
+int main(int argc, char** argv) {
+    if(argc != 2) {
+        std::cerr << "usage: banshee-test-ici file\n";
+        return 2;
+    }
+    banshee::ici_loader loader;
+    auto value = loader.load(argv[1]);
+    if(!value) {
+        std::cerr << loader.error() << '\n';
+        return 1;
+    }
+    std::cout << *value << '\n';
+    return 0;
+}
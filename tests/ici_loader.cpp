@@ -0,0 +1,115 @@
+#include "test_helpers.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+
+// Loads files including each other in a temporary directory, with several numbers of threads
+namespace {
+
+std::string directory;
+
+// Written to a new file then renamed, so that the file always looks modified
+void write_file(const std::string& name, const std::string& content) {
+    const std::string path = directory + "/" + name;
+    {
+        std::ofstream out(path + ".tmp", std::ios::binary | std::ios::trunc);
+        out << content;
+    }
+    std::rename((path + ".tmp").c_str(), path.c_str());
+}
+
+std::string path(const std::string& name) {
+    return directory + "/" + name;
+}
+
+// main includes b and c, which both include d
+bool check_diamond(std::size_t threads) {
+    write_file("e.ici", "e = 1\n");
+    write_file("d.ici", "include \"e.ici\"\nd = 2\n");
+    write_file("b.ici", "include \"d.ici\"\nb = 3\n");
+    write_file("c.ici", "include \"d.ici\"\nc = 4\n");
+    write_file("main.ici", "include \"b.ici\"\ninclude \"c.ici\"\nmain = 5\n");
+    for(int i = 0; i < 20; i++) {
+        banshee::ici_loader loader(threads);
+        auto value = loader.load(path("main.ici"));
+        CHECK(value);
+        CHECK(value->size() == 5 && int((*value)["e"]) == 1 && int((*value)["c"]) == 4);
+    }
+    return true;
+}
+
+// Each file of a level includes both files of the next one
+bool check_ladder(std::size_t threads) {
+    const int levels = 8;
+    for(int level = 0; level < levels; level++) {
+        for(const char* side : {"a", "b"}) {
+            std::string content;
+            if(level + 1 < levels) {
+                for(const char* next : {"a", "b"})
+                    content += "include \"l" + std::to_string(level + 1) + next + ".ici\"\n";
+            }
+            content += "l" + std::to_string(level) + side + " = " + std::to_string(level) + "\n";
+            write_file("l" + std::to_string(level) + side + ".ici", content);
+        }
+    }
+    for(int i = 0; i < 10; i++) {
+        banshee::ici_loader loader(threads);
+        auto value = loader.load(path("l0a.ici"));
+        CHECK(value && value->size() == std::size_t(2 * levels - 1));
+    }
+    return true;
+}
+
+bool check_reloads(std::size_t threads) {
+    banshee::ici_loader loader(threads);
+    write_file("e.ici", "e = 1\n");
+    write_file("d.ici", "include \"e.ici\"\nd = 2\n");
+    write_file("top.ici", "include \"d.ici\"\n");
+    auto value = loader.load(path("top.ici"));
+    CHECK(value && int((*value)["e"]) == 1);
+
+    // A file included indirectly was modified
+    write_file("e.ici", "e = 10\n");
+    value = loader.load(path("top.ici"));
+    CHECK(value && int((*value)["e"]) == 10);
+
+    // Failed loads are tried again
+    std::remove(path("missing.ici").c_str());
+    write_file("broken.ici", "include \"missing.ici\"\n");
+    CHECK(!loader.load(path("broken.ici")));
+    CHECK(loader.error().find("missing.ici") != std::string::npos);
+    write_file("missing.ici", "m = 1\n");
+    value = loader.load(path("broken.ici"));
+    CHECK(value && int((*value)["m"]) == 1);
+
+    write_file("x.ici", "include \"y.ici\"\n");
+    write_file("y.ici", "include \"x.ici\"\n");
+    CHECK(!loader.load(path("x.ici")));
+    CHECK(loader.error().find("include cycle") != std::string::npos);
+
+    // Syntax errors point at the token the parser failed on
+    write_file("syntax.ici", "a = 1\nb = [1 2]\n");
+    CHECK(!loader.load(path("syntax.ici")));
+    CHECK(loader.error().find("syntax.ici:2:8: syntax error") != std::string::npos);
+    write_file("syntax.ici", "a = 1\nb = \"unterminated\nc = 2\n");
+    CHECK(!loader.load(path("syntax.ici")));
+    CHECK(loader.error().find("syntax.ici:2:5: syntax error") != std::string::npos);
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    char name[] = "/tmp/banshee-ici-XXXXXX";
+    if(!::mkdtemp(name))
+        return 1;
+    directory = name;
+    bool ok = true;
+    for(std::size_t threads : {0, 1, 4})
+        ok = check_diamond(threads) && check_ladder(threads) && check_reloads(threads) && ok;
+    std::system(("rm -rf " + directory).c_str());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+
+// Evaluates compiled ICI documents against environments
+namespace {
+
+using banshee::property;
+using plan_t = banshee::ici_plan<property>;
+
+std::optional<banshee::ici_document<property>> parse(const std::string& text) {
+    auto tokens =
+        banshee::ici_token_view<std::u32string, property>(banshee::test::codepoints(text));
+    return banshee::ici_parser<decltype(tokens)>(tokens).parse();
+}
+
+std::optional<property> evaluate(const std::string& text, const property& environment = {}) {
+    const auto document = parse(text);
+    if(!document) {
+        std::cerr << "invalid test document: " << text << '\n';
+        return {};
+    }
+    return banshee::evaluate(*document, environment);
+}
+
+property json(const std::string& text) {
+    auto p = banshee::test::parse_json(text);
+    if(!p)
+        std::cerr << "invalid test json: " << text << '\n';
+    return p ? *p : property();
+}
+
+bool check_conditions() {
+    const std::string text = R"(
+        if a { r = 1 } else if b { r = 2 } else { r = 3 }
+        if a { s = 1 }
+    )";
+    CHECK(evaluate(text, json(R"({"a": true, "b": true})")) == json(R"({"r": 1, "s": 1})"));
+    CHECK(evaluate(text, json(R"({"a": false, "b": 0})")) == json(R"({"r": 2})"));
+    CHECK(evaluate(text, json(R"({"a": null, "b": false})")) == json(R"({"r": 3})"));
+    // Conditions must be defined
+    CHECK(!evaluate(text, json(R"({"b": true})")));
+    return true;
+}
+
+bool check_loops() {
+    CHECK(evaluate(R"(
+        sum = 0
+        foreach v : [1, 2, 3] { sum += v }
+        copy = []
+        foreach v : values { copy += [v] }
+    )", json(R"({"values": [4, 5]})")) == json(R"({"sum": 6, "copy": [4, 5]})"));
+    CHECK(evaluate(R"(
+        names = []
+        foreach k : { b = 1, a = 2 } { names += k }
+        foreach k : [] { never = true }
+    )") == json(R"({"names": ["a", "b"]})"));
+    // Nested loops see both variables
+    CHECK(evaluate(R"(
+        pairs = []
+        foreach x : [1, 2] { foreach y : ["a"] { pairs += [[x, y]] } }
+    )") == json(R"({"pairs": [[1, "a"], [2, "a"]]})"));
+    CHECK(!evaluate("foreach v : 1 { }"));
+    return true;
+}
+
+bool check_and_or() {
+    // Like in python, the operand deciding the result is the value
+    CHECK(evaluate(R"(
+        a = null or "default"
+        b = 0 or "default"
+        c = false and 1
+        d = 1 and 2
+        e = null or false
+        f = (false or 1) and "x"
+    )") == json(R"({"a": "default", "b": 0, "c": false, "d": 2, "e": false, "f": "x"})"));
+    // The operands after the deciding one are not evaluated
+    CHECK(evaluate("a = true or undefined\nb = false and undefined") ==
+          json(R"({"a": true, "b": false})"));
+    CHECK(!evaluate("a = false or undefined"));
+    CHECK(!evaluate("a = true and undefined"));
+    return true;
+}
+
+bool check_unset() {
+    CHECK(evaluate(R"(
+        a { b = 1, c = 2 }
+        d = 3
+        unset a.b
+        unset d
+        unset missing.member
+    )") == json(R"({"a": {"c": 2}})"));
+    return true;
+}
+
+bool check_arithmetic() {
+    CHECK(evaluate(R"(
+        i = 9223372036854775806
+        i += 1
+        n = -9223372036854775807
+        n -= 1
+        m = 3037000499
+        m *= 3037000499
+        f = 9223372036854775807
+        f += 1.0
+        d = 1.5
+        d *= 2
+    )") == json(R"({"i": 9223372036854775807, "n": -9223372036854775808,
+                    "m": 9223372030926249001, "f": 9223372036854775808.0, "d": 3.0})"));
+    // Integers which overflow fail
+    CHECK(!evaluate("x = 9223372036854775807\nx += 1"));
+    CHECK(!evaluate("x = -9223372036854775807\nx -= 2"));
+    CHECK(!evaluate("x = 9223372036854775807\nx -= -1"));
+    CHECK(!evaluate("x = 4294967296\nx *= 4294967296"));
+    CHECK(!evaluate("x = -9223372036854775807\nx *= 2"));
+    CHECK(!evaluate("x = \"a\"\nx *= 2"));
+    return true;
+}
+
+// Each plan includes the previous one twice: without memoization, evaluating the last one
+// would evaluate the first one 2^levels times
+bool check_shared_includes() {
+    const auto leaf = parse("leaf = name");
+    const auto twice = parse(R"(include "x", include "y", count += 1)");
+    CHECK(leaf && twice);
+    auto plan = std::make_shared<const plan_t>(*plan_t::compile(*leaf));
+    for(int level = 0; level < 64; level++) {
+        auto next = plan_t::compile(*twice, {plan, plan});
+        CHECK(next);
+        plan = std::make_shared<const plan_t>(std::move(*next));
+    }
+    property result;
+    CHECK(plan->evaluate(json(R"({"name": "n"})"), result));
+    CHECK(result == json(R"({"leaf": "n", "count": 64})"));
+    // Failures of included plans are remembered too
+    CHECK(!plan->evaluate(property{}, result));
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_conditions() && check_loops() && check_and_or() && check_unset() &&
+                    check_arithmetic() && check_shared_includes();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+#include "test_helpers.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checks indexed_map against std::map, below and above the size at which it builds its index
+
+namespace {
+std::atomic<std::size_t> allocations{0};
+}    // namespace
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if(void* p = std::malloc(size ? size : 1))
+        return p;
+    std::abort();
+}
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+using map_t = banshee::detail::indexed_map<std::string, int>;
+
+// Long enough not to fit in the small string buffer
+std::string key(int i) {
+    return "a rather long member name " + std::to_string(i);
+}
+
+bool check_against_std_map(int size) {
+    map_t map;
+    std::map<std::string, int> expected;
+    for(int i = size - 1; i >= 0; i--) {
+        map[key(i)] = i;
+        expected[key(i)] = i;
+    }
+    CHECK(map.size() == expected.size());
+    // Same iteration order as std::map
+    auto it = map.begin();
+    for(const auto& member : expected) {
+        CHECK(it->first == member.first && it->second == member.second);
+        ++it;
+    }
+    for(int i = 0; i < size; i++) {
+        const std::string k = key(i);
+        CHECK(map.find(std::string_view(k)) != map.end() && map.count(k) == 1);
+        CHECK(map.find(k.c_str())->second == i);
+    }
+    CHECK(map.find(std::string_view("missing")) == map.end());
+
+    // Insertions after the index is built, then erasures
+    map[key(size)] = size;
+    CHECK(map.count(key(size)) == 1);
+    CHECK(map.erase(std::string_view(key(0))) == 1 && map.count(key(0)) == 0);
+    CHECK(map.erase(std::string_view("missing")) == 0);
+    for(int i = 1; i <= size; i++)
+        CHECK(map.find(key(i))->second == i);
+    return true;
+}
+
+// Looking up an existing member through a string view does not allocate a key
+bool check_heterogeneous_subscript() {
+    map_t map;
+    for(int i = 0; i < 64; i++)
+        map[key(i)] = i;
+    const std::string k = key(10);
+    const std::string_view view = k;
+    // The first lookup builds the index
+    map.find(view);
+    const std::size_t before = allocations;
+    map[view] += 1;
+    CHECK(allocations == before);
+    CHECK(map[view] == 11);
+    // Missing members are inserted
+    map[std::string_view("new member which is not short")] = 1;
+    CHECK(map.size() == 65 && map.count("new member which is not short") == 1);
+    return true;
+}
+
+// Concurrent const lookups build the index once
+bool check_concurrent_lookups() {
+    map_t map;
+    for(int i = 0; i < 256; i++)
+        map[key(i)] = i;
+    const map_t& frozen = map;
+    std::atomic<bool> ok{true};
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for(int i = 0; i < 256; i++) {
+                auto it = frozen.find(key(i));
+                if(it == frozen.end() || it->second != i)
+                    ok = false;
+            }
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+    CHECK(ok);
+    return true;
+}
+
+bool check_property() {
+    static_assert(std::is_same_v<banshee::property::object_t,
+                                 std::map<std::string, banshee::property, std::less<>>>,
+                  "the default property keeps std::map");
+    banshee::indexed_property indexed;
+    banshee::property plain;
+    for(int i = 40; i >= 0; i--) {
+        indexed[key(i)] = i;
+        plain[key(i)] = i;
+    }
+    std::vector<std::string> a, b;
+    for(const auto& member : std::get<banshee::indexed_property::object_t>(indexed.value))
+        a.push_back(member.first);
+    for(const auto& member : std::get<banshee::property::object_t>(plain.value))
+        b.push_back(member.first);
+    CHECK(a == b);
+    CHECK(int(indexed[std::string_view(key(7))]) == 7);
+    CHECK(indexed.find("missing") == nullptr);
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    bool ok = true;
+    for(int size : {0, 1, 5, int(map_t::index_threshold) - 1, int(map_t::index_threshold), 500})
+        ok = check_against_std_map(size) && ok;
+    ok = check_heterogeneous_subscript() && ok;
+    ok = check_concurrent_lookups() && ok;
+    ok = check_property() && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,126 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checks which layout packed arrays pick, that they unpack when needed, and that const
+// operator[] can be called from several threads
+namespace {
+
+using banshee::test::parse_json;
+using banshee::packed_property;
+using array_t = packed_property::array_t;
+using layout = array_t::layout;
+
+const array_t& array(const packed_property& p) {
+    return std::get<array_t>(p.value);
+}
+
+bool check_layouts() {
+    array_t empty;
+    CHECK(empty.packing() == layout::generic && empty.integers().empty());
+
+    // The first element picks the layout
+    array_t integers{1, 2, 3};
+    CHECK(integers.packing() == layout::integers && integers.integers().size() == 3);
+    CHECK(integers.doubles().empty() && integers.integers()[2] == 3);
+    array_t doubles{0.5, -1.0};
+    CHECK(doubles.packing() == layout::doubles && doubles.doubles()[1] == -1.0);
+    array_t strings{"a", 1};
+    CHECK(strings.packing() == layout::generic && strings.size() == 2);
+
+    // The reserved capacity is kept by the packed storage
+    array_t reserved;
+    reserved.reserve(64);
+    reserved.push_back(packed_property(7));
+    CHECK(reserved.packing() == layout::integers);
+    const auto* data = reserved.integers().data();
+    for(int i = 0; i < 63; i++)
+        reserved.push_back(packed_property(i));
+    CHECK(reserved.integers().data() == data && reserved.size() == 64);
+
+    // Parsed arrays are packed, nested ones too
+    const auto p =
+        parse_json<packed_property>(R"({"i": [1, -2], "d": [1.5, 2.0], "m": [[3], ["x"], []]})");
+    CHECK(p);
+    CHECK(array((*p)["i"]).packing() == layout::integers);
+    CHECK(array((*p)["d"]).packing() == layout::doubles);
+    const auto& m = array((*p)["m"]);
+    CHECK(m.packing() == layout::generic);
+    CHECK(array(m[0]).packing() == layout::integers);
+    CHECK(array(m[1]).packing() == layout::generic && array(m[2]).empty());
+    return true;
+}
+
+bool check_unpacking() {
+    // An element of another type unpacks the array, keeping the elements and their types
+    array_t a{1, 2};
+    a.push_back(packed_property(2.5));
+    CHECK(a.packing() == layout::generic && a.integers().empty() && a.size() == 3);
+    CHECK(a[0].is_integral() && int(a[1]) == 2 && a[2].is_double() && double(a[2]) == 2.5);
+    // An empty array picks a layout again
+    a.clear();
+    a.push_back(packed_property(1));
+    CHECK(a.packing() == layout::integers);
+
+    array_t d{1.5};
+    d.push_back(packed_property(1));
+    CHECK(d.packing() == layout::generic && d[1].is_integral());
+
+    array_t s{1, 2};
+    s.push_back(packed_property("x"));
+    CHECK(s.packing() == layout::generic && std::string(s[2]) == "x");
+
+    // So does mutable access
+    array_t m{1, 2};
+    m[1] = "two";
+    CHECK(m.packing() == layout::generic && std::string(m[1]) == "two" && int(m[0]) == 1);
+
+    // Arrays with different layouts compare by elements
+    CHECK(array_t({1, 2}) == array_t({packed_property(1), packed_property(2)}));
+    array_t unpacked{"x", 1};
+    unpacked.erase(unpacked.begin());
+    CHECK(unpacked.packing() == layout::generic);
+    CHECK(unpacked == array_t{1} && unpacked != array_t{2});
+    return true;
+}
+
+bool check_concurrent_reads() {
+    array_t packed;
+    for(int i = 0; i < 1000; i++)
+        packed.push_back(packed_property(i));
+    for(int round = 0; round < 20; round++) {
+        // Modifying the array forgets the properties built by operator[]
+        packed.push_back(packed_property(round));
+        const array_t& a = packed;
+        std::vector<const packed_property*> first(8);
+        std::vector<char> ok(8);
+        std::vector<std::thread> threads;
+        for(std::size_t t = 0; t < first.size(); t++) {
+            threads.emplace_back([&, t] {
+                first[t] = &a[0];
+                bool same = true;
+                for(std::size_t i = 0; i < a.size(); i++) {
+                    const int expected = i < 1000 ? int(i) : int(i - 1000);
+                    same = same && a[i].is_integral() && int(a[i]) == expected;
+                }
+                ok[t] = same;
+            });
+        }
+        for(auto& t : threads)
+            t.join();
+        for(std::size_t t = 0; t < first.size(); t++)
+            CHECK(ok[t] && first[t] == first[0]);
+        // The array itself stays packed
+        CHECK(a.packing() == layout::integers && &a[0] == first[0]);
+    }
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_layouts() && check_unpacking() && check_concurrent_reads();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,139 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+
+// Runs the examples of RFC 6902 (JSON Patch) and RFC 7396 (JSON Merge Patch), and checks that
+// the patches created between their documents transform one into the other
+namespace {
+
+banshee::property parse(const std::string& json) {
+    auto p = banshee::test::parse_json(json);
+    if(!p)
+        std::cerr << "invalid test json: " << json << '\n';
+    return p ? *p : banshee::property();
+}
+
+struct patch_case {
+    const char* document;
+    const char* patch;
+    const char* result;    // nullptr when the patch fails
+};
+
+// RFC 6902, appendix A, but for A.13 which is about duplicate keys in the patch
+constexpr patch_case json_patches[] = {
+    // A.1 - A.5
+    {R"({"foo": "bar"})", R"([{"op": "add", "path": "/baz", "value": "qux"}])",
+     R"({"baz": "qux", "foo": "bar"})"},
+    {R"({"foo": ["bar", "baz"]})", R"([{"op": "add", "path": "/foo/1", "value": "qux"}])",
+     R"({"foo": ["bar", "qux", "baz"]})"},
+    {R"({"baz": "qux", "foo": "bar"})", R"([{"op": "remove", "path": "/baz"}])",
+     R"({"foo": "bar"})"},
+    {R"({"foo": ["bar", "qux", "baz"]})", R"([{"op": "remove", "path": "/foo/1"}])",
+     R"({"foo": ["bar", "baz"]})"},
+    {R"({"baz": "qux", "foo": "bar"})", R"([{"op": "replace", "path": "/baz", "value": "boo"}])",
+     R"({"baz": "boo", "foo": "bar"})"},
+    // A.6, A.7
+    {R"({"foo": {"bar": "baz", "waldo": "fred"}, "qux": {"corge": "grault"}})",
+     R"([{"op": "move", "from": "/foo/waldo", "path": "/qux/thud"}])",
+     R"({"foo": {"bar": "baz"}, "qux": {"corge": "grault", "thud": "fred"}})"},
+    {R"({"foo": ["all", "grass", "cows", "eat"]})",
+     R"([{"op": "move", "from": "/foo/1", "path": "/foo/3"}])",
+     R"({"foo": ["all", "cows", "eat", "grass"]})"},
+    // A.8, A.9
+    {R"({"baz": "qux", "foo": ["a", 2, "c"]})",
+     R"([{"op": "test", "path": "/baz", "value": "qux"},
+         {"op": "test", "path": "/foo/1", "value": 2}])",
+     R"({"baz": "qux", "foo": ["a", 2, "c"]})"},
+    {R"({"baz": "qux"})", R"([{"op": "test", "path": "/baz", "value": "bar"}])", nullptr},
+    // A.10 - A.12
+    {R"({"foo": "bar"})", R"([{"op": "add", "path": "/child", "value": {"grandchild": {}}}])",
+     R"({"foo": "bar", "child": {"grandchild": {}}})"},
+    {R"({"foo": "bar"})", R"([{"op": "add", "path": "/baz", "value": "qux", "xyz": 123}])",
+     R"({"foo": "bar", "baz": "qux"})"},
+    {R"({"foo": "bar"})", R"([{"op": "add", "path": "/baz/bat", "value": "qux"}])", nullptr},
+    // A.14 - A.16
+    {R"({"/": 9, "~1": 10})", R"([{"op": "test", "path": "/~01", "value": 10}])",
+     R"({"/": 9, "~1": 10})"},
+    {R"({"/": 9, "~1": 10})", R"([{"op": "test", "path": "/~01", "value": "10"}])", nullptr},
+    {R"({"foo": ["bar"]})", R"([{"op": "add", "path": "/foo/-", "value": ["abc", "def"]}])",
+     R"({"foo": ["bar", ["abc", "def"]]})"},
+    // Numbers are compared by value
+    {R"({"a": 1})", R"([{"op": "test", "path": "/a", "value": 1.0}])", R"({"a": 1})"},
+    {R"({"a": [1.0, {"b": 2}]})", R"([{"op": "test", "path": "/a", "value": [1, {"b": 2.0}]}])",
+     R"({"a": [1.0, {"b": 2}]})"},
+    {R"({"a": 1})", R"([{"op": "test", "path": "/a", "value": 1.5}])", nullptr},
+    {R"({"a": 9007199254740993})",
+     R"([{"op": "test", "path": "/a", "value": 9007199254740992.0}])", nullptr},
+    // A failed operation leaves the document untouched
+    {R"({"a": 1})",
+     R"([{"op": "add", "path": "/b", "value": 2}, {"op": "remove", "path": "/c"}])", nullptr},
+};
+
+// RFC 7396, appendix A
+constexpr patch_case merge_patches[] = {
+    {R"({"a": "b"})", R"({"a": "c"})", R"({"a": "c"})"},
+    {R"({"a": "b"})", R"({"b": "c"})", R"({"a": "b", "b": "c"})"},
+    {R"({"a": "b"})", R"({"a": null})", R"({})"},
+    {R"({"a": "b", "b": "c"})", R"({"a": null})", R"({"b": "c"})"},
+    {R"({"a": ["b"]})", R"({"a": "c"})", R"({"a": "c"})"},
+    {R"({"a": "c"})", R"({"a": ["b"]})", R"({"a": ["b"]})"},
+    {R"({"a": {"b": "c"}})", R"({"a": {"b": "d", "c": null}})", R"({"a": {"b": "d"}})"},
+    {R"({"a": [{"b": "c"}]})", R"({"a": [1]})", R"({"a": [1]})"},
+    {R"(["a", "b"])", R"(["c", "d"])", R"(["c", "d"])"},
+    {R"({"a": "b"})", R"(["c"])", R"(["c"])"},
+    {R"({"a": "foo"})", R"(null)", R"(null)"},
+    {R"({"a": "foo"})", R"("bar")", R"("bar")"},
+    {R"({"e": null})", R"({"a": 1})", R"({"e": null, "a": 1})"},
+    {R"([1, 2])", R"({"a": "b", "c": null})", R"({"a": "b"})"},
+    {R"({})", R"({"a": {"bb": {"ccc": null}}})", R"({"a": {"bb": {}}})"},
+};
+
+bool check_json_patch(const patch_case& c) {
+    const banshee::property original = parse(c.document);
+    banshee::property document = original;
+    const bool applied = banshee::apply_patch(document, parse(c.patch));
+    if(applied != (c.result != nullptr) || document != (applied ? parse(c.result) : original)) {
+        std::cerr << c.patch << ": applied to " << c.document << " gives " << document << '\n';
+        return false;
+    }
+    if(!applied)
+        return true;
+    // The patch created between the documents transforms one into the other
+    banshee::property patched = original;
+    const auto diff = banshee::diff(original, document);
+    if(!banshee::apply_patch(patched, diff) || patched != document) {
+        std::cerr << c.document << ": diff " << diff << " gives " << patched << '\n';
+        return false;
+    }
+    return true;
+}
+
+bool check_merge_patch(const patch_case& c) {
+    const banshee::property original = parse(c.document);
+    const banshee::property result = parse(c.result);
+    banshee::property document = original;
+    banshee::merge_patch(document, parse(c.patch));
+    if(document != result) {
+        std::cerr << c.patch << ": merged into " << c.document << " gives " << document << '\n';
+        return false;
+    }
+    banshee::property patched = original;
+    const auto patch = banshee::create_merge_patch(original, result);
+    banshee::merge_patch(patched, patch);
+    if(patched != result) {
+        std::cerr << c.document << ": merge patch " << patch << " gives " << patched << '\n';
+        return false;
+    }
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    bool ok = true;
+    for(const auto& c : json_patches)
+        ok = check_json_patch(c) && ok;
+    for(const auto& c : merge_patches)
+        ok = check_merge_patch(c) && ok;
+    return ok ? 0 : 1;
+}
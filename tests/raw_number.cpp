@@ -0,0 +1,146 @@
+#include "test_helpers.hpp"
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+
+// Checks that raw numbers keep their text, compare and convert by exact value, and that
+// raw_property documents are written back verbatim
+namespace {
+
+using banshee::raw_number;
+using banshee::raw_property;
+using banshee::test::parse_json;
+using decimal = raw_number::decimal;
+
+raw_number number(const char* text) {
+    return *raw_number::parse(text);
+}
+
+struct string_sink {
+    std::string* out;
+    bool write(const char* data, std::size_t size) {
+        out->append(data, size);
+        return true;
+    }
+};
+
+template<typename Property>
+std::string write(const Property& p) {
+    std::string out;
+    banshee::basic_json_writer<string_sink> writer{string_sink{&out}};
+    if(!writer.value(p) || !writer.finish())
+        return "<failed>";
+    return out;
+}
+
+bool check_parse() {
+    for(const char* text : {"", "01", "1.", ".5", "+1", "1e", "1 ", "-", "0x1", "1e+"})
+        CHECK(!raw_number::parse(text));
+    CHECK(number("-0.5e-3").text() == "-0.5e-3");
+    // Long texts are kept whole, and survive copies and moves
+    const std::string digits(40, '7');
+    const raw_number long_number = number(digits.c_str());
+    raw_number copy = long_number;
+    CHECK(copy.text() == digits && long_number.text() == digits);
+    raw_number moved = std::move(copy);
+    CHECK(moved.text() == digits && !moved.is_integral());
+    return true;
+}
+
+bool check_integral() {
+    constexpr auto max = std::numeric_limits<std::int64_t>::max();
+    constexpr auto min = std::numeric_limits<std::int64_t>::min();
+    CHECK(number("9223372036854775807").is_integral());
+    CHECK(std::int64_t(number("9223372036854775807")) == max);
+    CHECK(number("-9223372036854775808").is_integral());
+    CHECK(std::int64_t(number("-9223372036854775808")) == min);
+    CHECK(!number("9223372036854775808").is_integral());
+    CHECK(!number("-9223372036854775809").is_integral());
+    CHECK(!number("10000000000000000000").is_integral());
+    // -0 is a double, as with property
+    CHECK(!number("-0").is_integral() && number("0").is_integral());
+    CHECK(!number("1.0").is_integral() && !number("1e2").is_integral());
+    CHECK(double(number("-0")) == 0.0 && double(number("0.25")) == 0.25);
+    return true;
+}
+
+bool check_decimal() {
+    CHECK((number("1.50e1").to_decimal() == decimal{false, "15", 0}));
+    CHECK((number("15").to_decimal() == decimal{false, "15", 0}));
+    CHECK((number("-0.0120").to_decimal() == decimal{true, "12", -3}));
+    CHECK((number("1200").to_decimal() == decimal{false, "12", 2}));
+    // Zero has no digits and no sign, however it is spelled
+    for(const char* zero : {"0", "-0", "0e5", "0.000", "-0.0e-7"})
+        CHECK((number(zero).to_decimal() == decimal{}));
+    CHECK((number("1e400").to_decimal() == decimal{false, "1", 400}));
+    CHECK((number("10e399").to_decimal() == decimal{false, "1", 400}));
+    CHECK((number("1E-400").to_decimal() == decimal{false, "1", -400}));
+    // Exponents beyond any double are clamped rather than overflowing
+    const auto huge = number("1e99999999999999999999999").to_decimal();
+    CHECK(huge.digits == "1" && huge.exponent > 1000000000);
+    const auto tiny = number("-5e-99999999999999999999999").to_decimal();
+    CHECK(tiny.negative && tiny.digits == "5" && tiny.exponent < -1000000000);
+    return true;
+}
+
+bool check_exact_integral() {
+    for(const char* ten : {"10", "1e1", "10.0", "1.0e1", "100e-1", "0.1e2"})
+        CHECK(number(ten).exact_integral() == 10);
+    CHECK(number("-0").exact_integral() == 0 && number("0e9").exact_integral() == 0);
+    constexpr auto max = std::numeric_limits<std::int64_t>::max();
+    constexpr auto min = std::numeric_limits<std::int64_t>::min();
+    CHECK(number("9223372036854775807.0").exact_integral() == max);
+    CHECK(number("-9223372036854775808e0").exact_integral() == min);
+    CHECK(!number("9223372036854775808.0").exact_integral());
+    CHECK(!number("-9223372036854775809.0").exact_integral());
+    CHECK(!number("1e19").exact_integral() && !number("1e400").exact_integral());
+    CHECK(!number("1.5").exact_integral() && !number("1e-1").exact_integral());
+    return true;
+}
+
+bool check_equality() {
+    CHECK(number("10") == number("1e1") && number("1e1") == number("10.0"));
+    CHECK(number("1.50e1") == number("15") && number("0.10") == number("1e-1"));
+    CHECK(number("0") == number("-0") && number("0e5") == number("0.0"));
+    CHECK(number("10") != number("10.5") && number("-1") != number("1"));
+    // Which doubles could not tell apart
+    CHECK(number("12345678901234567890") != number("12345678901234567891"));
+    CHECK(number("0.10000000000000000001") != number("0.1"));
+    CHECK(number("1e400") == number("10e399") && number("1e400") != number("1e401"));
+    // Numbers made from doubles compare by value
+    CHECK(raw_number(2.5) == number("2.5") && raw_number(10.0) == number("1e1"));
+    CHECK(number("42") == 42 && number("4.2e1") == 42.0 && number("0.5") != 1);
+    return true;
+}
+
+bool check_round_trip() {
+    // No whitespace and sorted keys, the writer's own layout
+    const std::string text = R"({"big":18446744073709551617,"huge":1e400,"id":9007199254740993,)"
+                             R"("ids":[12345678901234567891,-9223372036854775809,1E+2],)"
+                             R"("price":1.50e1,"small":0.10000000000000000001,"zero":-0})";
+    const auto value = parse_json<raw_property>(text);
+    CHECK(value);
+    CHECK(write(*value) == text);
+    CHECK(std::int64_t((*value)["id"]) == 9007199254740993);
+    CHECK(std::get<raw_number>((*value)["big"].value).text() == "18446744073709551617");
+    const auto again = parse_json<raw_property>(write(*value));
+    CHECK(again && *again == *value);
+
+    // A property converts the same ids to doubles, and loses them
+    const auto converted = parse_json(text);
+    CHECK(converted && write(*converted).find("18446744073709551617") == std::string::npos);
+
+    // Numbers made from doubles are written as the writer writes doubles
+    CHECK(write(raw_property(raw_number(0.5))) == "0.5");
+    CHECK(write(raw_property(raw_number(1.0))) == "1.0");
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_parse() && check_integral() && check_decimal() &&
+                    check_exact_integral() && check_equality() && check_round_trip();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,37 @@
+#include <banshee/banshee.hpp>
+
+// Checks a json file against a schema while parsing it, with the parse context and with the
+// token view and parser, which must agree
+// usage: banshee-test-schema schema.json document.json [--invalid]
+// With --invalid, succeeds when the document does not match the schema
+int main(int argc, char** argv) {
+    if(argc < 3)
+        return 2;
+    const bool expected = argc < 4 || std::string_view(argv[3]) != "--invalid";
+    banshee::detail::mapped_file schema_file, document_file;
+    if(!schema_file.open(argv[1]) || !document_file.open(argv[2]))
+        return 2;
+    banshee::parse_context context;
+    if(!context.parse(std::string_view(schema_file.data(), schema_file.size())))
+        return 2;
+    auto schema = banshee::json_schema::compile(context.to_property());
+    if(!schema) {
+        std::cerr << argv[1] << ": unsupported schema\n";
+        return 2;
+    }
+
+    banshee::schema_validator validator(*schema);
+    const bool valid =
+        context.parse(std::string_view(document_file.data(), document_file.size()), validator);
+    if(!valid)
+        std::cerr << argv[2] << ": " << (validator.error() ? validator.error() : "invalid json")
+                  << '\n';
+
+    validator.reset();
+    auto view = banshee::json_token_view(banshee::open_unicode_file(argv[2]));
+    banshee::schema_checked_view checked(view, validator);
+    auto parser = banshee::json_parser(checked);
+    if(parser.parse().has_value() != valid)
+        return 3;
+    return valid == expected ? 0 : 1;
+}
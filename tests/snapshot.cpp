@@ -0,0 +1,74 @@
+#include <banshee/banshee.hpp>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Publishes versions of a document while readers take snapshots: every snapshot must be a
+// complete version, and versions must never go backwards for a given reader
+namespace {
+
+constexpr long versions = 20000;
+constexpr int readers = 16;
+
+banshee::property make_version(long v) {
+    banshee::property p;
+    p["version"] = v;
+    p["items"] = banshee::property::array_t(8, banshee::property(v));
+    return p;
+}
+
+bool consistent(const banshee::frozen_property& snapshot, long& last) {
+    const long v = long(snapshot["version"]);
+    if(v < last || snapshot["items"].size() != 8)
+        return false;
+    for(std::size_t i = 0; i < 8; i++) {
+        if(long(snapshot["items"][i]) != v)
+            return false;
+    }
+    last = v;
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    // Nothing published yet
+    if(!banshee::snapshot_publisher<banshee::property>().current().is_null())
+        return 1;
+
+    banshee::snapshot_publisher<banshee::property> publisher(make_version(0));
+    std::atomic<bool> done{false};
+    std::atomic<bool> ok{true};
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < readers; i++) {
+        threads.emplace_back([&] {
+            long last = 0;
+            // Snapshots stay valid after newer versions are published
+            auto held = publisher.current();
+            while(!done.load(std::memory_order_acquire)) {
+                auto snapshot = publisher.current();
+                if(!consistent(snapshot, last))
+                    ok = false;
+            }
+            long held_version = 0;
+            if(!consistent(held, held_version))
+                ok = false;
+        });
+    }
+    for(long v = 1; v <= versions; v++)
+        publisher.publish(make_version(v));
+
+    // publish_from keeps the current version when parsing fails
+    if(publisher.publish_from([] { return std::optional<banshee::property>(); }))
+        ok = false;
+    done.store(true, std::memory_order_release);
+    for(auto& t : threads)
+        t.join();
+
+    long last = 0;
+    if(!consistent(publisher.current(), last) || last != versions)
+        return 1;
+    return ok ? 0 : 1;
+}
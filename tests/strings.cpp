@@ -0,0 +1,86 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+
+// Decodes json strings with the token view, with the parse context and with the validator,
+// which must accept the same strings and decode them alike
+namespace {
+
+struct string_case {
+    const char* json;
+    const char* decoded;    // nullptr when the string is invalid
+};
+
+constexpr string_case cases[] = {
+    {R"("plain")", "plain"},
+    {R"("aéb")", "a\xC3\xA9"
+                      "b"},
+    {R"("€")", "\xE2\x82\xAC"},
+    {R"("😀")", "\xF0\x9F\x98\x80"},
+    {R"("\n\t\"\\\/")", "\n\t\"\\/"},
+    // Lone or misordered surrogates
+    {R"("\ud83d")", nullptr},
+    {R"("\ud83dx")", nullptr},
+    {R"("\ud83d\n")", nullptr},
+    {R"("\ude00")", nullptr},
+    {R"("\ude00\ud83d")", nullptr},
+    {R"("\ud83d\ud83d")", nullptr},
+    // Invalid hexadecimal digits
+    {R"("\u00zz")", nullptr},
+    {R"("\u-001")", nullptr},
+    {R"("\u12")", nullptr},
+    {R"("\u)", nullptr},
+    // Escapes which are not json
+    {R"("\v")", nullptr},
+    {R"("\'")", nullptr},
+    {R"("\0")", nullptr},
+    {R"("\x41")", nullptr},
+    {R"("\a")", nullptr},
+};
+
+bool check(const string_case& c) {
+    const std::string json = c.json;
+    const bool valid = c.decoded != nullptr;
+    bool ok = true;
+    auto fail = [&](const char* engine) {
+        std::cerr << json << ": " << engine << " disagrees\n";
+        ok = false;
+    };
+
+    const auto parsed = banshee::test::parse_json(json);
+    if(parsed.has_value() != valid || (valid && *parsed != banshee::property(c.decoded)))
+        fail("json_token_view");
+
+    banshee::parse_context context;
+    const bool decoded = context.parse(json);
+    if(decoded != valid || (valid && context.to_property() != banshee::property(c.decoded)))
+        fail("parse_context");
+
+    banshee::json_validator validator;
+    if(validator.validate(json) != valid)
+        fail("json_validator");
+    return ok;
+}
+
+// ICI strings accept more escapes than json
+bool check_ici() {
+    const std::u32string text = UR"(s = "\v\'\0\n")";
+    auto tokens = banshee::ici_token_view<std::u32string>(std::u32string(text));
+    const auto document = banshee::ici_parser<decltype(tokens)>(tokens).parse();
+    const auto value = document ? banshee::evaluate(*document) : std::nullopt;
+    if(!value || (*value)["s"] != banshee::property(std::string("\v'\0\n", 4))) {
+        std::cerr << "ici escapes are not decoded\n";
+        return false;
+    }
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    bool ok = true;
+    for(const auto& c : cases)
+        ok = check(c) && ok;
+    ok = check_ici() && ok;
+    return ok ? 0 : 1;
+}
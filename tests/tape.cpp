@@ -0,0 +1,82 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Fills tapes from tokens, replays them as tokens and checks the element counts of containers
+namespace {
+
+banshee::json_token_view<std::u32string> lex(const std::string& json) {
+    return banshee::json_token_view<std::u32string>(banshee::test::codepoints(json));
+}
+
+using banshee::test::parse_json;
+
+bool check(const std::string& json) {
+    const auto expected = parse_json(json);
+    banshee::json_tape tape;
+    if(!expected || !tape.assign(lex(json)) || tape.to_property() != *expected) {
+        std::cerr << json << ": assign\n";
+        return false;
+    }
+    // Replaying the tape must give back the same document
+    banshee::json_tape replayed;
+    if(!replayed.assign(tape.tokens()) || replayed.to_property() != *expected ||
+       replayed.size() != tape.size()) {
+        std::cerr << json << ": token replay\n";
+        return false;
+    }
+    auto tokens = tape.tokens();
+    auto parser = banshee::json_parser(tokens);
+    const auto reparsed = parser.parse();
+    if(!reparsed || *reparsed != *expected) {
+        std::cerr << json << ": parsing the replayed tokens\n";
+        return false;
+    }
+    return true;
+}
+
+// Expected length of each container of the tape, in order of their opening brackets
+bool check_lengths(const std::string& json, const std::vector<std::uint32_t>& lengths) {
+    banshee::json_tape tape;
+    if(!tape.assign(lex(json)))
+        return false;
+    std::vector<std::uint32_t> actual;
+    for(std::size_t i = 0; i < tape.size(); i++) {
+        const auto k = tape.kind(i);
+        if(k == banshee::json_tape::TokenKind::tok_lbrace ||
+           k == banshee::json_tape::TokenKind::tok_lsquare)
+            actual.push_back(tape[i].length);
+    }
+    if(actual != lengths) {
+        std::cerr << json << ": container lengths\n";
+        return false;
+    }
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    bool ok = true;
+    for(const char* json : {"42", "-1.5", R"("s")", "true", "null", "[]", "{}", "[[]]",
+                            R"([1, "two", 3.0, true, false, null])",
+                            R"({"a": [{"b": "c"}, [1, [2, [3]]]], "d": {"e": {}}, "f": "g"})",
+                            R"([{"k": [1, 2]}, {}, [[], {"x": null}]])"})
+        ok = check(json) && ok;
+
+    ok = check_lengths("[]", {0}) && ok;
+    ok = check_lengths("[1, 2, 3]", {3}) && ok;
+    ok = check_lengths(R"({"a": 1, "b": [1, 2], "c": {"d": null}})", {3, 2, 1}) && ok;
+    ok = check_lengths(R"([[1, [2, 3, 4]], {"k": "v"}, []])", {3, 2, 3, 1, 0}) && ok;
+
+    // Invalid structures are rejected
+    banshee::json_tape tape;
+    for(const char* json : {"[1, 2", "[1 2]", R"({"a" 1})", R"({"a": 1,})", "[,]", "1 2", "]"}) {
+        if(tape.assign(lex(json))) {
+            std::cerr << json << ": accepted\n";
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <banshee/banshee.hpp>
+#include <iostream>
+#include <optional>
+#include <string>
+
+// Helpers shared by the tests
+
+// In a function returning bool: reports the line of a condition which does not hold, and
+// returns false
+#define CHECK(cond)                                                                          \
+    do {                                                                                     \
+        if(!(cond)) {                                                                        \
+            std::cerr << __LINE__ << ": " #cond "\n";                                        \
+            return false;                                                                    \
+        }                                                                                    \
+    } while(0)
+
+namespace banshee::test {
+
+// The code points of utf-8 text, as read by the token views
+inline std::u32string codepoints(const std::string& text) {
+    std::u32string out;
+    decode_utf8(text.data(), text.data() + text.size(), out);
+    return out;
+}
+
+// Parses json text with json_token_view and json_parser
+template<typename Property = banshee::property>
+std::optional<Property> parse_json(const std::string& json) {
+    auto view = json_token_view<std::u32string, Property>(codepoints(json));
+    return json_parser(view).parse();
+}
+
+}    // namespace banshee::test
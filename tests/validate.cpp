@@ -1,9 +1,55 @@
 #include <banshee/banshee.hpp>
+#include <cstring>
+#include <iostream>
+#include <sys/stat.h>
 
-int main(int, char** argv) {
+// usage: banshee-test-validate [--parse] file
+// Exits with 0 if the file holds valid json, 1 if it does not, and 2 if it cannot be read. By
+// default the file is only validated, and the offset of the first error is reported; --parse
+// builds the document instead. utf-16 and utf-32 files are always parsed.
+namespace {
 
-    auto view = banshee::json_token_view(banshee::open_unicode_file(argv[1]));
+int parse(const char* path) {
+    auto view = banshee::json_token_view(banshee::open_unicode_file(path));
     auto parser = banshee::json_parser(view);
-    auto value = parser.parse();
-    return value.has_value() ? 0 : 1;
+    if(!parser.parse()) {
+        std::cerr << path << ": invalid json\n";
+        return 1;
+    }
+    return 0;
+}
+
+}    // namespace
+
+int main(int argc, char** argv) {
+    const bool parse_flag = argc > 1 && std::strcmp(argv[1], "--parse") == 0;
+    if(argc != (parse_flag ? 3 : 2)) {
+        std::cerr << "usage: banshee-test-validate [--parse] file\n";
+        return 2;
+    }
+    const char* path = argv[argc - 1];
+    if(parse_flag)
+        return parse(path);
+
+    // mapped_file does not map empty files, which are validated as empty text
+    banshee::detail::mapped_file file;
+    struct stat st;
+    if(!file.open(path) && (::stat(path, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size != 0)) {
+        std::cerr << path << ": cannot open file\n";
+        return 2;
+    }
+    std::string_view text(file.data(), file.size());
+    // The validator reads utf-8 only: a utf-8 byte order mark is skipped, utf-16 and utf-32 are
+    // decoded by the full parse
+    if(text.substr(0, 2) == "\xFF\xFE" || text.substr(0, 2) == "\xFE\xFF" ||
+       (text.size() >= 2 && (text[0] == 0 || text[1] == 0)))
+        return parse(path);
+    const std::size_t bom = text.substr(0, 3) == "\xEF\xBB\xBF" ? 3 : 0;
+    text.remove_prefix(bom);
+    banshee::json_validator validator;
+    if(!validator.validate(text)) {
+        std::cerr << path << ": invalid json at byte " << bom + validator.error_offset() << "\n";
+        return 1;
+    }
+    return 0;
 }
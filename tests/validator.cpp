@@ -0,0 +1,68 @@
+#include <banshee/banshee.hpp>
+#include <iostream>
+#include <string>
+
+// Documents json_validator must accept or reject, in agreement with parse_context
+namespace {
+
+struct document_case {
+    const char* json;
+    bool valid;
+    // Offset of the first error of invalid documents
+    std::size_t error_offset;
+};
+
+constexpr document_case cases[] = {
+    {"0", true, 0},
+    {"-1.5e+3", true, 0},
+    {R"( {"a": [1, true, null, "x", {}], "b": {"c": []}} )", true, 0},
+    {R"(["\b\f\n\r\t\"\\\/", "é😀"])", true, 0},
+    {"\"\xC3\xA9\"", true, 0},
+    {"", false, 0},
+    {"[1, 2", false, 5},
+    {"[1 2]", false, 3},
+    {"[1,]", false, 3},
+    {R"({"a" 1})", false, 5},
+    {R"({"a": 1,})", false, 8},
+    {R"({1: 2})", false, 1},
+    {"[1] 2", false, 4},
+    {"01", false, 1},
+    {"1.", false, 1},
+    {"tru", false, 3},
+    {"[nul]", false, 4},
+    // Escapes which are not json, and control characters
+    {R"(["\v"])", false, 2},
+    {R"(["\'"])", false, 2},
+    {R"(["\0"])", false, 2},
+    {R"(["\x41"])", false, 2},
+    {"[\"\t\"]", false, 2},
+    // Invalid utf-8 and unpaired surrogates
+    {"\"\xC3\"", false, 1},
+    {"\"\xED\xA0\x80\"", false, 1},
+    {R"("\ud83d")", false, 1},
+};
+
+bool check(const document_case& c) {
+    banshee::json_validator validator;
+    const bool valid = validator.validate(c.json);
+    banshee::parse_context context;
+    const bool parsed = context.parse(c.json);
+    if(valid != c.valid || parsed != c.valid) {
+        std::cerr << c.json << ": validator " << valid << ", parse_context " << parsed << '\n';
+        return false;
+    }
+    if(!valid && validator.error_offset() != c.error_offset) {
+        std::cerr << c.json << ": error at " << validator.error_offset() << '\n';
+        return false;
+    }
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    bool ok = true;
+    for(const auto& c : cases)
+        ok = check(c) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,112 @@
+#include "test_helpers.hpp"
+#include <iostream>
+#include <string>
+
+// Interned values share the storage of equal subtrees and strings, and the pool only grows
+// up to its size
+namespace {
+
+using banshee::shared_property;
+using array_t = shared_property::array_t;
+using object_t = shared_property::object_t;
+using string_t = shared_property::string_t;
+
+std::optional<shared_property> parse(const std::string& json, banshee::value_pool* pool = nullptr) {
+    auto view =
+        banshee::json_token_view<std::u32string, shared_property>(banshee::test::codepoints(json));
+    if(pool)
+        return banshee::json_parser(view, *pool).parse();
+    return banshee::json_parser(view).parse();
+}
+
+const void* identity(const shared_property& p) {
+    if(p.is_string())
+        return std::get<string_t>(p.value).identity();
+    if(p.is_array())
+        return std::get<array_t>(p.value).identity();
+    return std::get<object_t>(p.value).identity();
+}
+
+const void* key_identity(const shared_property& p, const char* key) {
+    return std::get<object_t>(p.value).find(key)->first.identity();
+}
+
+constexpr const char* document = R"([
+    {"name": "first", "tags": ["a", "b"], "point": {"x": 1, "y": 2}},
+    {"name": "second", "tags": ["a", "b"], "point": {"x": 1, "y": 2}},
+    "first"
+])";
+
+bool check_sharing() {
+    banshee::value_pool pool;
+    auto doc = parse(document, &pool);
+    CHECK(doc && *doc == *parse(document));
+    // Through a const reference: non const operator[] would detach the document from the pool
+    const shared_property& d = *doc;
+    const shared_property& a = d[0];
+    const shared_property& b = d[1];
+    CHECK(identity(a["tags"]) == identity(b["tags"]));
+    CHECK(identity(a["point"]) == identity(b["point"]));
+    CHECK(identity(a["tags"][0]) == identity(b["tags"][0]));
+    CHECK(identity(a["name"]) == identity(d[2]));
+    CHECK(key_identity(a, "point") == key_identity(b, "point"));
+    CHECK(identity(a) != identity(b));
+
+    // A second document shares the values of the first
+    auto again = parse(document, &pool);
+    CHECK(again && identity(*again) == identity(d));
+    return true;
+}
+
+bool check_shared_input() {
+    auto doc = parse(document);
+    CHECK(doc);
+    const shared_property original = *doc;
+    banshee::value_pool pool;
+    // Interning reads the children without detaching the containers of the input
+    const shared_property first = pool.intern(original[0]["point"]);
+    CHECK(identity(first) == identity(original[0]["point"]));
+    const shared_property second = pool.intern(original[1]["point"]);
+    CHECK(identity(second) == identity(first));
+
+    // Containers whose children change are cloned, the input is left untouched
+    const shared_property interned = pool.intern(original);
+    CHECK(interned == original && identity(interned) != identity(original));
+    CHECK(identity(interned[1]["tags"]) == identity(interned[0]["tags"]));
+    CHECK(identity(original[1]["tags"]) != identity(original[0]["tags"]));
+    return true;
+}
+
+bool check_collect() {
+    banshee::value_pool pool;
+    {
+        auto doc = parse(document, &pool);
+        CHECK(doc);
+        CHECK(pool.size() > 0);
+        CHECK(pool.collect() == 0);
+    }
+    // The document is gone, nothing else references the pool's values
+    CHECK(pool.collect() > 0 && pool.size() == 0);
+
+    // A full pool keeps returning interned values, without remembering new ones
+    banshee::value_pool small(4);
+    std::vector<shared_property> kept;
+    for(int i = 0; i < 16; i++) {
+        kept.push_back(small.intern(*parse("[" + std::to_string(i) + "]")));
+        CHECK(small.size() <= small.max_size());
+    }
+    CHECK(small.size() == 4);
+    CHECK(identity(small.intern(kept[0])) == identity(kept[0]));
+    const shared_property refused = small.intern(*parse("[16]"));
+    CHECK(identity(small.intern(*parse("[16]"))) != identity(refused));
+    kept.clear();
+    CHECK(small.collect() == 4 && small.size() == 0);
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_sharing() && check_shared_input() && check_collect();
+    return ok ? 0 : 1;
+}
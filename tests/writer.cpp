@@ -0,0 +1,137 @@
+#include "test_helpers.hpp"
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+
+// Checks the output of json_writer, and that misplaced calls put it in a failed state
+namespace {
+
+struct string_sink {
+    std::string* out;
+    bool write(const char* data, std::size_t size) {
+        out->append(data, size);
+        return true;
+    }
+};
+using writer_t = banshee::basic_json_writer<string_sink>;
+
+template<typename T>
+std::string write_value(const T& v) {
+    std::string out;
+    writer_t writer{string_sink{&out}};
+    if(!writer.value(v) || !writer.finish())
+        return "<failed>";
+    return out;
+}
+
+double read_double(const std::string& text) {
+    return std::strtod(text.c_str(), nullptr);
+}
+
+bool check_escaping() {
+    CHECK(write_value("plain") == R"("plain")");
+    CHECK(write_value("") == R"("")");
+    CHECK(write_value("\"quoted\" \\ back") == R"("\"quoted\" \\ back")");
+    CHECK(write_value("\b\f\n\r\t") == R"("\b\f\n\r\t")");
+    CHECK(write_value(std::string_view("\x00\x01\x1f", 3)) == R"("\u0000\u0001\u001f")");
+    // Non ascii characters and the other ascii ones are written as is
+    CHECK(write_value("é ü / \x7f") == "\"é ü / \x7f\"");
+    return true;
+}
+
+bool check_numbers() {
+    CHECK(write_value(0) == "0");
+    CHECK(write_value(-42) == "-42");
+    CHECK(write_value(std::numeric_limits<std::int64_t>::min()) == "-9223372036854775808");
+    CHECK(write_value(std::numeric_limits<std::uint64_t>::max()) == "18446744073709551615");
+    // Doubles read back as doubles, to the same value
+    CHECK(write_value(1.0) == "1.0");
+    CHECK(write_value(-0.0) == "-0.0");
+    CHECK(write_value(1.5) == "1.5");
+    CHECK(write_value(0.1) == "0.1");
+    for(double d : {1e300, -2.5e-300, 123456789012345678.0, 0.1 + 0.2, 4.9e-324,
+                    std::numeric_limits<double>::max()}) {
+        const std::string text = write_value(d);
+        CHECK(text.find_first_of(".eE") != std::string::npos);
+        CHECK(read_double(text) == d);
+    }
+    CHECK(write_value(std::nan("")) == "<failed>");
+    CHECK(write_value(std::numeric_limits<double>::infinity()) == "<failed>");
+    return true;
+}
+
+bool check_nesting() {
+    std::string out;
+    {
+        writer_t writer{string_sink{&out}, 8};
+        CHECK(writer.begin_object() && writer.key("a") && writer.begin_array());
+        CHECK(writer.value(1) && writer.value("two") && writer.begin_object());
+        CHECK(writer.end_object() && writer.end_array() && writer.depth() == 1);
+        CHECK(writer.key("b\n") && writer.value(nullptr) && writer.key("c") && writer.value(true));
+        CHECK(writer.end_object() && writer.finish());
+    }
+    CHECK(out == R"({"a":[1,"two",{}],"b\n":null,"c":true})");
+
+    // Each misplaced call fails, and so does every call after it
+    const auto fails = [](auto&& misuse) {
+        std::string text;
+        writer_t writer{string_sink{&text}};
+        if(misuse(writer) || writer.good() || writer.value(1) || writer.finish())
+            return false;
+        return true;
+    };
+    CHECK(fails([](writer_t& w) { return w.key("a"); }));
+    CHECK(fails([](writer_t& w) { return w.end_array(); }));
+    CHECK(fails([](writer_t& w) { return w.value(1) && w.value(2); }));
+    CHECK(fails([](writer_t& w) { return w.begin_object() && w.value(1); }));
+    CHECK(fails([](writer_t& w) { return w.begin_object() && w.key("a") && w.key("b"); }));
+    CHECK(fails([](writer_t& w) { return w.begin_object() && w.key("a") && w.end_object(); }));
+    CHECK(fails([](writer_t& w) { return w.begin_array() && w.end_object(); }));
+    CHECK(fails([](writer_t& w) { return w.begin_array() && w.key("a"); }));
+    CHECK(fails([](writer_t& w) { return w.begin_array() && w.value(NAN); }));
+    CHECK(fails([](writer_t& w) { return w.begin_array() && w.value(1) && w.finish(); }));
+    return true;
+}
+
+bool check_incomplete_output() {
+    // Destroying a writer in the middle of a document does not flush the buffered part
+    std::string out;
+    {
+        writer_t writer{string_sink{&out}};
+        CHECK(writer.begin_array() && writer.value(1));
+    }
+    CHECK(out.empty());
+    {
+        writer_t writer{string_sink{&out}};
+        CHECK(writer.begin_array() && !writer.value(INFINITY) && !writer.end_array());
+    }
+    CHECK(out.empty());
+    // A complete document is flushed
+    {
+        writer_t writer{string_sink{&out}};
+        CHECK(writer.begin_array() && writer.value(1) && writer.end_array());
+    }
+    CHECK(out == "[1]");
+    return true;
+}
+
+bool check_property() {
+    banshee::property p;
+    p["list"] = banshee::property::array_t{1, 2.5, "x", banshee::property(), false};
+    p["nested"]["k"] = "v";
+    std::string out;
+    writer_t writer{string_sink{&out}, 4};
+    CHECK(writer.value(p) && writer.finish());
+    CHECK(out == R"({"list":[1,2.5,"x",null,false],"nested":{"k":"v"}})");
+    return true;
+}
+
+}    // namespace
+
+int main() {
+    const bool ok = check_escaping() && check_numbers() && check_nesting() &&
+                    check_incomplete_output() && check_property();
+    return ok ? 0 : 1;
+}